@@ -0,0 +1,44 @@
+#!/bin/sh
+# 每个目录项的内存分配次数与遍历耗时。
+#
+# 用法：bench/bench_alloc.sh [目录树路径] [对比的 myfind 可执行文件]
+# 默认使用 bench/gen_tree.py 生成的 /tmp/myfind_bench_tree。分配次数由预加载的
+# bench/malloc_count.so 统计，计时时不预加载，取三次中的最好成绩。
+
+set -e
+cd "$(dirname "$0")/.."
+
+TREE=${1:-/tmp/myfind_bench_tree}
+OTHER=$2
+
+[ -x ./myfind ] || make >/dev/null
+make bench/malloc_count.so >/dev/null
+[ -d "$TREE" ] || python3 bench/gen_tree.py "$TREE" --depth 4 --fanout 8 --files 20
+
+entries=$(./myfind "$TREE" | wc -l)
+echo "$entries entries"
+
+run() {
+    bin=$1
+    shift
+    allocs=$(LD_PRELOAD=./bench/malloc_count.so "$bin" "$@" "$TREE" >/dev/null 2>/tmp/bench_alloc.$$; \
+        sed -n 's/^allocations: //p' /tmp/bench_alloc.$$)
+    rm -f /tmp/bench_alloc.$$
+    best=""
+    for i in 1 2 3; do
+        start=$(date +%s.%N)
+        "$bin" "$@" "$TREE" >/dev/null
+        end=$(date +%s.%N)
+        t=$(awk "BEGIN { print $end - $start }")
+        best=$(awk "BEGIN { b = \"$best\"; print (b == \"\" || $t < b) ? $t : b }")
+    done
+    printf '%-24s %-8s %10s allocs  %6.3f/entry  best of 3: %.3fs\n' "$bin" "${*:-sync}" "$allocs" \
+        "$(awk "BEGIN { print $allocs / $entries }")" "$best"
+}
+
+for mode in "" "-j 2" "--uring"; do
+    # shellcheck disable=SC2086
+    run ./myfind $mode
+    # shellcheck disable=SC2086
+    [ -z "$OTHER" ] || run "$OTHER" $mode
+done
@@ -0,0 +1,72 @@
+#!/bin/sh
+# -contains 的基准：比较进程内查找文件内容与 -exec grep -l ... {} + 的耗时，并检查两者的结果一致。
+#
+# 用法：bench/bench_contains.sh [目录树路径] [文件数] [最大线程数]
+# 目录树包含大小不一的文本文件（大多数不超过 16 KiB，少数为几 MiB），其中约 1/8 含有 NEEDLE_42，
+# 另有少量含有 '\0' 的二进制文件，用于比较 --skip-binary 与 grep -I。
+
+set -e
+cd "$(dirname "$0")/.."
+
+TREE=${1:-/tmp/myfind_contains_tree}
+FILES=${2:-20000}
+JOBS=${3:-4}
+
+[ -x ./myfind ] || make >/dev/null
+if [ ! -d "$TREE" ]; then
+    python3 - "$TREE" "$FILES" <<'EOF'
+import os, random, sys
+root, files = sys.argv[1], int(sys.argv[2])
+random.seed(42)
+words = [b"alpha", b"beta", b"gamma", b"delta", b"lorem", b"ipsum", b"return", b"static", b"int", b"char"]
+for i in range(files):
+    d = os.path.join(root, f"d{i % 64}", f"e{i % 7}")
+    os.makedirs(d, exist_ok=True)
+    size = random.choice((512, 2048, 8192, 16384)) if i % 200 else 4 << 20
+    line = b" ".join(random.choice(words) for _ in range(12)) + b"\n"
+    data = bytearray(line * (size // len(line) + 1))[:size]
+    if i % 8 == 0:
+        pos = random.randrange(len(data))
+        data[pos:pos] = b"NEEDLE_42"
+    if i % 97 == 0:
+        data[:4] = b"\0\1\2\3"
+    with open(os.path.join(d, f"f{i}.txt"), "wb") as f:
+        f.write(data)
+EOF
+fi
+
+echo "$(./myfind "$TREE" -type f | wc -l) files, $(du -sh "$TREE" | cut -f1)"
+
+# 取三次中的最好成绩
+run() {
+    label=$1
+    shift
+    best=""
+    for i in 1 2 3; do
+        start=$(date +%s.%N)
+        "$@" >/dev/null
+        end=$(date +%s.%N)
+        t=$(awk "BEGIN { print $end - $start }")
+        best=$(awk "BEGIN { b = \"$best\"; print (b == \"\" || $t < b) ? $t : b }")
+    done
+    printf '%-44s %8d lines  best of 3: %.3fs\n' "$label" "$("$@" | wc -l)" "$best"
+}
+
+check() {
+    if [ "$(eval "$1" | sort)" != "$(eval "$2" | sort)" ]; then
+        echo "MISMATCH: $1 vs $2"
+        exit 1
+    fi
+}
+
+check "./myfind $TREE -type f -contains NEEDLE_42" "./myfind $TREE -type f -exec grep -l NEEDLE_42 {} +"
+check "./myfind $TREE -type f -contains-regex 'NEEDLE_[0-9]+'" "./myfind $TREE -type f -exec grep -lE 'NEEDLE_[0-9]+' {} +"
+check "./myfind --skip-binary $TREE -type f -contains NEEDLE_42" "./myfind $TREE -type f -exec grep -lI NEEDLE_42 {} +"
+
+run "myfind -exec grep -l {} +" ./myfind "$TREE" -type f -exec grep -l NEEDLE_42 {} +
+run "myfind --exec-jobs $JOBS -exec grep -l {} +" ./myfind --exec-jobs "$JOBS" "$TREE" -type f -exec grep -l NEEDLE_42 {} +
+run "myfind -contains" ./myfind "$TREE" -type f -contains NEEDLE_42
+run "myfind -j $JOBS -contains" ./myfind -j "$JOBS" "$TREE" -type f -contains NEEDLE_42
+run "myfind -contains-regex" ./myfind "$TREE" -type f -contains-regex 'NEEDLE_[0-9]+'
+run "myfind -exec grep -lE {} +" ./myfind "$TREE" -type f -exec grep -lE 'NEEDLE_[0-9]+' {} +
+run "myfind --skip-binary -contains" ./myfind --skip-binary "$TREE" -type f -contains NEEDLE_42
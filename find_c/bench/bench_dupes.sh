@@ -0,0 +1,90 @@
+#!/bin/sh
+# --dupes 的基准：比较分阶段查找重复文件与对所有文件执行 md5sum 后按散列分组的耗时，并检查两者找到的组相同。
+#
+# 用法：bench/bench_dupes.sh [目录树路径] [文件数] [最大线程数]
+# 文件大小从 1 KiB 到 1 MiB 不等，约 1/10 是其他文件的副本，另有一些大小相同、只有中间的一个字节不同的文件
+# 和一些硬链接，分别用于检验第三阶段和 (dev, ino) 的处理。
+
+set -e
+cd "$(dirname "$0")/.."
+
+TREE=${1:-/tmp/myfind_dupes_tree}
+FILES=${2:-20000}
+JOBS=${3:-4}
+
+[ -x ./myfind ] || make >/dev/null
+if [ ! -d "$TREE" ]; then
+    python3 - "$TREE" "$FILES" <<'EOF'
+import os, random, sys
+root, files = sys.argv[1], int(sys.argv[2])
+random.seed(42)
+made = []
+for i in range(files):
+    d = os.path.join(root, f"d{i % 64}")
+    os.makedirs(d, exist_ok=True)
+    path = os.path.join(d, f"f{i}")
+    if made and i % 10 == 0:
+        with open(random.choice(made), "rb") as f:
+            data = f.read()
+    else:
+        data = bytearray(random.randbytes(random.choice((1024, 8192, 65536, 1 << 20))))
+        if made and i % 13 == 0:
+            # 与某个文件大小相同、开头和结尾相同，只有中间不同
+            with open(random.choice(made), "rb") as f:
+                data = bytearray(f.read())
+            data[len(data) // 2] ^= 1
+    with open(path, "wb") as f:
+        f.write(data)
+    if i % 50 == 0:
+        os.link(path, path + ".link")
+    made.append(path)
+EOF
+fi
+
+echo "$(./myfind "$TREE" -type f | wc -l) files, $(du -sh "$TREE" | cut -f1)"
+
+# 把输出整理成每组一行、组内和组间都排序的形式
+groups() {
+    python3 -c '
+import sys
+blocks = [b.split("\n") for b in sys.stdin.read().split("\n\n") if b.strip()]
+for g in sorted(" ".join(sorted(b)) for b in blocks):
+    print(g)'
+}
+
+# md5sum 的结果按散列分组；硬链接只有一个 inode，与 --dupes 一样不单独成组
+md5_groups() {
+    ./myfind "$TREE" -type f -exec md5sum {} + | sort | awk '
+        { n[$1]++; g[$1] = g[$1] (g[$1] == "" ? "" : "\n") $2 }
+        END { for (h in g) if (n[h] > 1) print g[h] "\n" }' | python3 -c '
+import os, sys
+for b in sys.stdin.read().split("\n\n"):
+    paths = [p for p in b.split("\n") if p]
+    if len({(os.stat(p).st_dev, os.stat(p).st_ino) for p in paths}) > 1:
+        print("\n".join(paths) + "\n")'
+}
+
+if [ "$(./myfind --dupes "$TREE" | groups)" != "$(md5_groups | groups)" ]; then
+    echo "MISMATCH between --dupes and md5sum"
+    exit 1
+fi
+
+# 取三次中的最好成绩
+run() {
+    label=$1
+    shift
+    best=""
+    for i in 1 2 3; do
+        start=$(date +%s.%N)
+        "$@" >/dev/null
+        end=$(date +%s.%N)
+        t=$(awk "BEGIN { print $end - $start }")
+        best=$(awk "BEGIN { b = \"$best\"; print (b == \"\" || $t < b) ? $t : b }")
+    done
+    printf '%-40s best of 3: %.3fs\n' "$label" "$best"
+}
+
+run "myfind -exec md5sum {} + | sort" sh -c "./myfind '$TREE' -type f -exec md5sum {} + | sort"
+run "myfind --dupes" ./myfind --dupes "$TREE"
+run "myfind --dupes -j $JOBS" ./myfind --dupes -j "$JOBS" "$TREE"
+./myfind --stats --dupes "$TREE" 2>&1 >/dev/null | grep -E "content bytes|^dupes"
@@ -0,0 +1,65 @@
+#!/bin/sh
+# -exec 的基准：统计 -exec ... + 每批的参数个数，并比较同步执行与 --exec-jobs N 的耗时。
+#
+# 用法：bench/bench_exec.sh [文件数] [目录路径] [最大并发数] [对比用的 myfind 可执行文件]
+# 默认在 /tmp/myfind_exec_dir 中创建 20 万个带有较长文件名的日志文件，每个约 4 KiB，
+# 批处理命令用 gzip 压缩整批文件（输出丢弃），模拟日志压缩任务。
+# 之后对其中一半（10 万个）文件执行 -exec true {} \;，测量每个子进程的创建开销；
+# 给出第四个参数时（例如用旧版本源码编译的 myfind）同时计时。
+
+set -e
+cd "$(dirname "$0")/.."
+
+COUNT=${1:-200000}
+DIR=${2:-/tmp/myfind_exec_dir}
+MAXJOBS=${3:-4}
+OTHER=$4
+
+[ -x ./myfind ] || make >/dev/null
+if [ ! -d "$DIR" ]; then
+    echo "creating $COUNT files in $DIR ..."
+    python3 -c "
+import os, sys
+d, n = sys.argv[1], int(sys.argv[2])
+line = b'2024-01-01T00:00:00 INFO request served in 12ms path=/api/v1/items\n'
+for i in range(n):
+    sub = os.path.join(d, 'host%03d' % (i % 100))
+    os.makedirs(sub, exist_ok=True)
+    with open(os.path.join(sub, 'service-access-%08d.log' % i), 'wb') as f:
+        f.write(line * 60)
+" "$DIR" "$COUNT"
+fi
+
+# 预热目录项缓存
+./myfind "$DIR" >/dev/null
+
+echo "arguments per batch:"
+./myfind "$DIR" -name '*.log' -exec sh -c 'echo $#' sh {} + | sort -n | uniq -c
+
+elapsed() {
+    start=$(date +%s.%N)
+    "$@"
+    end=$(date +%s.%N)
+    awk "BEGIN { print $end - $start }"
+}
+
+batch() {
+    # shellcheck disable=SC2086
+    elapsed "$1" $2 "$DIR" -name '*.log' -exec sh -c 'cat "$@" | gzip -1 >/dev/null' sh {} +
+}
+
+single() {
+    # shellcheck disable=SC2086
+    elapsed "$1" $2 "$DIR" -name '*[02468].log' -exec true {} \;
+}
+
+for bench in batch single; do
+    echo "$bench:"
+    [ -n "$OTHER" ] && printf '  %-16s %.3fs\n' "$(basename "$OTHER")" "$($bench "$OTHER" "")"
+    printf '  %-16s %.3fs\n' "sync" "$($bench ./myfind "")"
+    jobs=1
+    while [ "$jobs" -le "$MAXJOBS" ]; do
+        printf '  %-16s %.3fs\n' "--exec-jobs $jobs" "$($bench ./myfind "--exec-jobs $jobs")"
+        jobs=$((jobs * 2))
+    done
+done
@@ -0,0 +1,140 @@
+// -name 匹配的基准和自检：先用随机模式和随机名称检查编译后的匹配器与 fnmatch 的结果一致，
+// 再比较 fnmatch、单个编译模式以及 40 个后缀组成的模式集合的耗时。
+//
+// 用法：make bench_glob && ./bench_glob [求值次数]
+
+#include "bench_nodes.h"
+#include "globmatch.h"
+
+#include <fnmatch.h>
+#include <string.h>
+
+static const char *atoms[] = {"a", "b", ".", "*", "?", "[ab]", "[!a]", "[a-c]", "\\*", "[[:digit:]]",
+                              "1", "[]a]", "[^.]", "-", "[", "\\", "[[=a=]]", "\xe9"};
+static const char name_chars[] = "abc.1*-]\\[";
+
+static unsigned int seed = 12345;
+
+static unsigned int next_rand(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+static void random_pattern(char *buf, size_t size)
+{
+    size_t n = next_rand() % 6;
+    buf[0] = '\0';
+    for (size_t i = 0; i < n; i++)
+    {
+        const char *a = atoms[next_rand() % (sizeof(atoms) / sizeof(atoms[0]))];
+        if (strlen(buf) + strlen(a) + 1 < size)
+            strcat(buf, a);
+    }
+}
+
+static void random_name(char *buf)
+{
+    size_t n = 1 + next_rand() % 7;
+    for (size_t i = 0; i < n; i++)
+        buf[i] = next_rand() % 16 == 0 ? (char)0xe9 : name_chars[next_rand() % (sizeof(name_chars) - 1)];
+    buf[n] = '\0';
+}
+
+// 编译后的匹配器必须与 fnmatch 完全一致
+static int self_check(void)
+{
+    char pats[4][64], name[16];
+    char *pp[4];
+    int errors = 0;
+    for (int i = 0; i < 20000; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            random_pattern(pats[j], sizeof(pats[j]));
+            pp[j] = pats[j];
+        }
+        struct glob *g = glob_compile(pats[0]);
+        struct globset *s = globset_compile(pp, 4);
+        for (int k = 0; k < 50; k++)
+        {
+            int want_one, want_any = 0;
+            random_name(name);
+            for (int j = 0; j < 4; j++)
+                want_any |= !fnmatch(pats[j], name, 0);
+            want_one = !fnmatch(pats[0], name, 0);
+            if (glob_match(g, name) != want_one || globset_match(s, name) != want_any)
+            {
+                if (errors++ < 10)
+                    fprintf(stderr, "mismatch: pattern '%s' name '%s' (kind %d)\n", pats[0], name, g->kind);
+            }
+        }
+        glob_free(g);
+        globset_free(s);
+    }
+    return errors;
+}
+
+static char *suffixes[] = {
+    "*.c", "*.h", "*.cc", "*.cpp", "*.hpp", "*.py", "*.pyc", "*.rs", "*.go", "*.java",
+    "*.class", "*.jar", "*.js", "*.ts", "*.tsx", "*.css", "*.scss", "*.html", "*.xml", "*.yml",
+    "*.yaml", "*.toml", "*.ini", "*.cfg", "*.sh", "*.bash", "*.zsh", "*.pl", "*.pm", "*.rb",
+    "*.php", "*.swift", "*.kt", "*.scala", "*.lua", "*.sql", "*.proto", "*.tmp", "*.bak", "*.swp"};
+
+int main(int argc, char *argv[])
+{
+    long count = argc > 1 ? atol(argv[1]) : 10000000;
+    size_t nsuffix = sizeof(suffixes) / sizeof(suffixes[0]);
+    struct node *pool = pool_create();
+    struct timespec start, end;
+    long hits;
+    int errors = self_check();
+    printf("self-check: %s\n", errors ? "FAILED" : "ok");
+    if (errors)
+        return 1;
+
+    const char *single[] = {"*.c", "main*", "core12.py", "*12*", "*[0-9]*", "[a-m]*.?"};
+    for (size_t i = 0; i < sizeof(single) / sizeof(single[0]); i++)
+    {
+        struct glob *g = glob_compile(single[i]);
+        double t_fn, t_glob;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        hits = 0;
+        for (long j = 0; j < count; j++)
+            hits += !fnmatch(single[i], pool[j & (POOL_SIZE - 1)].name_wp, 0);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        t_fn = elapsed(&start, &end) * 1e9 / count;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (long j = 0; j < count; j++)
+            hits -= glob_match(g, pool[j & (POOL_SIZE - 1)].name_wp);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        t_glob = elapsed(&start, &end) * 1e9 / count;
+        printf("%-12s kind %d  fnmatch %6.1f ns  compiled %6.1f ns%s\n", single[i], g->kind, t_fn, t_glob, hits ? "  MISMATCH" : "");
+        glob_free(g);
+    }
+
+    // 40 个后缀：逐个 fnmatch 与合并的 DFA
+    struct globset *s = globset_compile(suffixes, nsuffix);
+    double t_fn, t_set;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    hits = 0;
+    for (long j = 0; j < count; j++)
+        for (size_t k = 0; k < nsuffix; k++)
+            if (!fnmatch(suffixes[k], pool[j & (POOL_SIZE - 1)].name_wp, 0))
+            {
+                hits++;
+                break;
+            }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    t_fn = elapsed(&start, &end) * 1e9 / count;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long j = 0; j < count; j++)
+        hits -= globset_match(s, pool[j & (POOL_SIZE - 1)].name_wp);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    t_set = elapsed(&start, &end) * 1e9 / count;
+    printf("%zu suffixes  fnmatch %6.1f ns  globset %6.1f ns (%d DFA states)%s\n", nsuffix, t_fn, t_set,
+           s->dfa ? s->dfa->nstates : 0, hits ? "  MISMATCH" : "");
+    globset_free(s);
+    pool_free(pool);
+    return 0;
+}
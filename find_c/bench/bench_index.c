@@ -0,0 +1,87 @@
+// 生成一个模拟的大索引，用于测试 --use-index 在上千万条记录上的查询速度，不需要真的创建这么多文件。
+// 目录树为 /data/dNNN/dNNN/fNNNN：第一层和第二层各有若干目录，每个第二层目录中有相同数量的文件，
+// 按名称顺序生成，因此记录已经是索引要求的顺序。
+//
+// 用法：make bench_index && ./bench_index 索引文件 [记录数]
+
+#include "index.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double elapsed(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static int add(struct index_writer *w, char *path, int depth, mode_t mode, long i)
+{
+    struct index_rec rec;
+    rec.path = path;
+    rec.len = strlen(path);
+    rec.depth = depth;
+    rec.mode = mode;
+    rec.size = S_ISDIR(mode) ? 4096 : (uint64_t)(i * 7919 % 100000);
+    rec.mtime = (int64_t)(1700000000 + i % 86400) * 1000000000;
+    rec.ctime = rec.mtime;
+    rec.dev = 1;
+    rec.ino = i + 2;
+    return index_writer_add(w, &rec);
+}
+
+int main(int argc, char *argv[])
+{
+    long count = argc > 2 ? atol(argv[2]) : 20000000;
+    // 每个第二层目录 1000 个文件，第一层目录数为第二层的两倍
+    long files = 1000, top = 1, mid;
+    struct index_writer w;
+    struct timespec start, end;
+    char path[64];
+    long i = 0;
+    int rv = 0;
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s index-file [records]\n", argv[0]);
+        return 1;
+    }
+    while (2 * top * top * files < count)
+        top++;
+    mid = (count / files + 2 * top - 1) / (2 * top);
+    if (index_writer_open(&w, argv[1]) == -1)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    rv |= add(&w, "/data", 0, S_IFDIR | 0755, i++);
+    for (long a = 0; a < 2 * top && !rv; a++)
+    {
+        snprintf(path, sizeof(path), "/data/d%03ld", a);
+        rv |= add(&w, path, 1, S_IFDIR | 0755, i++);
+        for (long b = 0; b < mid && !rv; b++)
+        {
+            snprintf(path, sizeof(path), "/data/d%03ld/d%03ld", a, b);
+            rv |= add(&w, path, 2, S_IFDIR | 0755, i++);
+            for (long f = 0; f < files && !rv; f++)
+            {
+                snprintf(path, sizeof(path), "/data/d%03ld/d%03ld/f%04ld.%s", a, b, f, f % 10 ? "txt" : "log");
+                rv |= add(&w, path, 3, S_IFREG | (f % 3 ? 0644 : 0600), i++);
+            }
+        }
+    }
+    if (rv)
+    {
+        perror(argv[1]);
+        index_writer_close(&w, 0);
+        return 1;
+    }
+    if (index_writer_close(&w, 1))
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fprintf(stderr, "%ld records written to %s in %.2fs\n", i, argv[1], elapsed(&start, &end));
+    return 0;
+}
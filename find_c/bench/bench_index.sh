@@ -0,0 +1,56 @@
+#!/bin/sh
+# 索引的基准：在真实的目录树上比较建立索引、查询索引与直接遍历的耗时和结果，
+# 再用 bench_index 生成一个模拟的大索引（默认 2000 万条记录），测试查询整个索引和一棵子树的耗时。
+#
+# 用法：bench/bench_index.sh [目录树路径] [模拟索引的记录数] [索引文件目录]
+
+set -e
+cd "$(dirname "$0")/.."
+
+TREE=${1:-/tmp/myfind_rss_tree}
+COUNT=${2:-20000000}
+DIR=${3:-/tmp}
+
+[ -x ./myfind ] || make >/dev/null
+[ -x ./bench_index ] || make bench_index >/dev/null
+[ -d "$TREE" ] || python3 bench/gen_tree.py "$TREE" --depth 4 --fanout 10 --files 90 >/dev/null
+
+# 取三次中的最好成绩
+run() {
+    label=$1
+    shift
+    best=""
+    for i in 1 2 3; do
+        start=$(date +%s.%N)
+        "$@" >/dev/null
+        end=$(date +%s.%N)
+        t=$(awk "BEGIN { print $end - $start }")
+        best=$(awk "BEGIN { b = \"$best\"; print (b == \"\" || $t < b) ? $t : b }")
+    done
+    printf '%-44s %9d lines  best of 3: %.3fs\n' "$label" "$("$@" | wc -l)" "$best"
+}
+
+start=$(date +%s.%N)
+./myfind --build-index "$DIR/myfind_tree.idx" "$TREE"
+end=$(date +%s.%N)
+printf 'build index of %s: %.3fs, %d bytes\n' "$TREE" "$(awk "BEGIN { print $end - $start }")" "$(wc -c <"$DIR/myfind_tree.idx")"
+
+for expr in "-name *7*" "-type d" "-type f -perm 644"; do
+    # shellcheck disable=SC2086
+    set -f
+    run "walk $expr" ./myfind "$TREE" $expr
+    run "index $expr" ./myfind --use-index "$DIR/myfind_tree.idx" "$TREE" $expr
+    if [ "$(./myfind "$TREE" $expr | sort)" != "$(./myfind --use-index "$DIR/myfind_tree.idx" "$TREE" $expr | sort)" ]; then
+        echo "index and walk differ for: $expr"
+        exit 1
+    fi
+    set +f
+done
+
+./bench_index "$DIR/myfind_big.idx" "$COUNT"
+printf 'index size: %d bytes\n' "$(wc -c <"$DIR/myfind_big.idx")"
+run "index -name *.log" ./myfind --use-index "$DIR/myfind_big.idx" -name '*.log'
+run "index -type d" ./myfind --use-index "$DIR/myfind_big.idx" -type d
+run "index -perm 600 -name f00*" ./myfind --use-index "$DIR/myfind_big.idx" -perm 600 -name 'f00*'
+run "index /data/d007 -name *.log" ./myfind --use-index "$DIR/myfind_big.idx" /data/d007 -name '*.log'
+rm -f "$DIR/myfind_tree.idx" "$DIR/myfind_big.idx"
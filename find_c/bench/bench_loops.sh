@@ -0,0 +1,39 @@
+#!/bin/sh
+# -L 模式下循环检测的基准：遍历一棵只包含目录的大树，并在最深处放置指回根目录的符号链接。
+#
+# 用法：bench/bench_loops.sh [目录树路径] [对比用的 myfind 可执行文件]
+# 默认在 /tmp/myfind_loop_tree 中生成 6 层、每层 10 个子目录的树（约 111 万个目录）。
+# 给出第二个参数时（例如用旧版本源码编译的 myfind）同时计时并比较两者的输出。
+
+set -e
+cd "$(dirname "$0")/.."
+
+TREE=${1:-/tmp/myfind_loop_tree}
+OTHER=$2
+
+[ -x ./myfind ] || make >/dev/null
+if [ ! -d "$TREE" ]; then
+    echo "creating directory tree in $TREE ..."
+    python3 bench/gen_tree.py "$TREE" --depth 6 --fanout 10 --files 0
+    # 同一棵树中放置几个循环，确保检测路径被实际执行
+    ln -s ../../../../../.. "$TREE/d0/d0/d0/d0/d0/d0/loop"
+    ln -s ../.. "$TREE/d9/d9/loop"
+fi
+
+# 预热目录项缓存
+./myfind "$TREE" >/dev/null
+
+run() {
+    start=$(date +%s.%N)
+    "$@" -L "$TREE" -name loop >/tmp/myfind_loop_out 2>/dev/null || true
+    end=$(date +%s.%N)
+    awk "BEGIN { print $end - $start }"
+}
+
+printf '%-10s %.3fs\n' "myfind" "$(run ./myfind)"
+sort /tmp/myfind_loop_out >/tmp/myfind_loop_new
+if [ -n "$OTHER" ]; then
+    printf '%-10s %.3fs\n' "$(basename "$OTHER")" "$(run "$OTHER")"
+    sort /tmp/myfind_loop_out | cmp -s - /tmp/myfind_loop_new && echo "output: same" || echo "output: DIFFERENT"
+fi
+rm -f /tmp/myfind_loop_out /tmp/myfind_loop_new
@@ -0,0 +1,51 @@
+// 基准测试程序共用的合成节点：名称、类型和权限预先填好，求值时不会触发任何系统调用。
+
+#ifndef BENCH_NODES_H
+#define BENCH_NODES_H
+
+#include "myfind.h"
+#include "lib/lib_str.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// 合成节点的数量（2 的幂），节点循环使用
+#define POOL_SIZE 4096
+
+static const char *exts[] = {"c", "h", "cpp", "hpp", "py", "rs", "go", "java", "txt", "md", "o", "json"};
+static const char *prefixes[] = {"main", "test_util", "alpha", "beta", "core", "zeta", "io", "net_old"};
+static const mode_t types[] = {S_IFREG, S_IFREG, S_IFREG, S_IFDIR, S_IFLNK, S_IFREG};
+static const mode_t perms[] = {0644, 0664, 0600, 0755, 0644, 0700};
+
+static struct node *pool_create(void)
+{
+    struct node *pool = calloc(POOL_SIZE, sizeof(struct node));
+    char buf[64];
+    for (size_t i = 0; i < POOL_SIZE; i++)
+    {
+        snprintf(buf, sizeof(buf), "%s%zu.%s", prefixes[i % 8], i, exts[i % 12]);
+        pool[i].name_wp = my_strcp(buf);
+        pool[i].name = pool[i].name_wp;
+        pool[i].type = types[i % 6] | perms[i % 6];
+        pool[i].r_type = pool[i].type;
+        pool[i].dirfd = AT_FDCWD;
+        pool[i].flags = NODE_FTYPE | NODE_LSTAT | NODE_STAT;
+    }
+    return pool;
+}
+
+static void pool_free(struct node *pool)
+{
+    for (size_t i = 0; i < POOL_SIZE; i++)
+        free(pool[i].name_wp);
+    free(pool);
+}
+
+static double elapsed(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+#endif
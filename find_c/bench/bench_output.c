@@ -0,0 +1,75 @@
+// 输出路径的微基准：比较逐条 printf 与 out_record（每个线程一个缓冲区，writev 写出）。
+// 路径写入标准输出，耗时输出到标准错误，应将标准输出重定向到管道或 /dev/null。
+//
+// 用法：make bench_output && ./bench_output [记录数] [线程数] | cat >/dev/null
+
+#include "bench_nodes.h"
+#include "output.h"
+
+#include <pthread.h>
+#include <string.h>
+
+struct job
+{
+    char **paths;
+    long count;
+    int buffered;
+};
+
+static void *run_job(void *arg)
+{
+    struct job *j = arg;
+    char *path;
+    struct out_buf *o = j->buffered ? out_create(OUT_BUF_SIZE) : NULL;
+    for (long i = 0; i < j->count; i++)
+    {
+        path = j->paths[i & (POOL_SIZE - 1)];
+        if (o)
+            out_record(o, path, strlen(path), '\n');
+        else
+            printf("%s\n", path);
+    }
+    if (o)
+        out_destroy(o);
+    else
+        fflush(stdout);
+    return NULL;
+}
+
+static double run(char **paths, long count, int threads, int buffered)
+{
+    pthread_t tid[64];
+    struct job job = {paths, count / threads, buffered};
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < threads; i++)
+        pthread_create(&tid[i], NULL, run_job, &job);
+    for (int i = 0; i < threads; i++)
+        pthread_join(tid[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return elapsed(&start, &end) * 1e9 / count;
+}
+
+int main(int argc, char *argv[])
+{
+    long count = argc > 1 ? atol(argv[1]) : 10000000;
+    int threads = argc > 2 ? atoi(argv[2]) : 1;
+    struct node *pool = pool_create();
+    char *paths[POOL_SIZE];
+    char buf[256];
+    if (threads < 1 || threads > 64)
+        threads = 1;
+    // 模拟遍历时拼接出的完整路径
+    for (long i = 0; i < POOL_SIZE; i++)
+    {
+        snprintf(buf, sizeof(buf), "/srv/data/d%ld/d%ld/%s", i % 10, i % 7, pool[i].name_wp);
+        paths[i] = my_strcp(buf);
+    }
+    fprintf(stderr, "%ld records, %d thread(s)\n", count, threads);
+    fprintf(stderr, "%-12s %6.1f ns/record\n", "printf", run(paths, count, threads, 0));
+    fprintf(stderr, "%-12s %6.1f ns/record\n", "out_record", run(paths, count, threads, 1));
+    for (long i = 0; i < POOL_SIZE; i++)
+        free(paths[i]);
+    pool_free(pool);
+    return 0;
+}
@@ -0,0 +1,56 @@
+// 单个谓词的微基准：分别编译只含一个谓词的表达式，直接执行字节码（不输出），
+// 减去空表达式的耗时后得到每次谓词求值的开销。
+//
+// 用法：make bench_pred && ./bench_pred [求值次数]
+
+#include "bench_nodes.h"
+#include "bytecode.h"
+
+// 每个用例是一个以 NULL 结尾的表达式，空表达式作为基线
+static char *cases[][4] = {
+    {NULL},
+    {"-name", "*.c", NULL},
+    {"-name", "main*", NULL},
+    {"-name", "*[0-9]*", NULL},
+    {"-type", "f", NULL},
+    {"-type", "s", NULL},
+    {"-perm", "644", NULL},
+    {"-perm", "7777", NULL},
+};
+
+static double run_case(char **expr, struct node *pool, long count, long *matched)
+{
+    struct data d;
+    struct timespec start, end;
+    long hits = 0;
+    init_data(&d);
+    for (int i = 0; expr[i]; i++)
+        add_exp(&d, my_strcp(expr[i]));
+    if (compile_expression(&d))
+        exit(1);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < count; i++)
+        hits += run_program(&d, d.prog, &pool[i & (POOL_SIZE - 1)]);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    free_data(&d);
+    *matched = hits;
+    return elapsed(&start, &end) * 1e9 / count;
+}
+
+int main(int argc, char *argv[])
+{
+    long count = argc > 1 ? atol(argv[1]) : 10000000;
+    struct node *pool = pool_create();
+    long matched;
+    double base = run_case(cases[0], pool, count, &matched);
+    printf("%-20s %8.1f ns/eval\n", "(empty)", base);
+    for (size_t i = 1; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        char label[64];
+        double ns = run_case(cases[i], pool, count, &matched);
+        snprintf(label, sizeof(label), "%s %s", cases[i][0], cases[i][1]);
+        printf("%-20s %8.1f ns/eval  (+%.1f)  %5.1f%% true\n", label, ns, ns - base, 100.0 * matched / count);
+    }
+    pool_free(pool);
+    return 0;
+}
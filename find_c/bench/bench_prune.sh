@@ -0,0 +1,54 @@
+#!/bin/sh
+# -prune 与 -maxdepth 的基准：在模拟的开发目录树上比较完整遍历与跳过 node_modules/.git 子树的耗时。
+#
+# 用法：bench/bench_prune.sh [目录树路径] [项目数]
+# 每个项目包含少量源文件，以及由 bench/gen_tree.py 生成的较大的 node_modules 和 .git 目录。
+
+set -e
+cd "$(dirname "$0")/.."
+
+TREE=${1:-/tmp/myfind_dev_tree}
+PROJECTS=${2:-20}
+
+[ -x ./myfind ] || make >/dev/null
+if [ ! -d "$TREE" ]; then
+    i=0
+    while [ $i -lt "$PROJECTS" ]; do
+        mkdir -p "$TREE/proj$i/src"
+        for f in main.c util.c util.h README.md Makefile; do
+            : >"$TREE/proj$i/src/$f"
+        done
+        python3 bench/gen_tree.py "$TREE/proj$i/node_modules" --depth 3 --fanout 6 --files 10 >/dev/null
+        python3 bench/gen_tree.py "$TREE/proj$i/.git" --depth 2 --fanout 16 --files 8 >/dev/null
+        i=$((i + 1))
+    done
+fi
+
+echo "$(./myfind "$TREE" | wc -l) entries"
+
+# 取三次中的最好成绩，同时与 GNU find 的结果比较
+run() {
+    label=$1
+    shift
+    best=""
+    for i in 1 2 3; do
+        start=$(date +%s.%N)
+        "$@" >/dev/null
+        end=$(date +%s.%N)
+        t=$(awk "BEGIN { print $end - $start }")
+        best=$(awk "BEGIN { b = \"$best\"; print (b == \"\" || $t < b) ? $t : b }")
+    done
+    printf '%-40s %8d lines  best of 3: %.3fs\n' "$label" "$("$@" | wc -l)" "$best"
+}
+
+PRUNE="-name node_modules -prune -o -name .git -prune -o -type f -print"
+# shellcheck disable=SC2086
+run "myfind -type f" ./myfind "$TREE" -type f
+# shellcheck disable=SC2086
+run "myfind -prune node_modules/.git" ./myfind "$TREE" $PRUNE
+# shellcheck disable=SC2086
+run "myfind -j 4 -prune node_modules/.git" ./myfind -j 4 "$TREE" $PRUNE
+# shellcheck disable=SC2086
+run "find -prune node_modules/.git" find "$TREE" $PRUNE
+run "myfind -maxdepth 2" ./myfind "$TREE" -maxdepth 2
+run "find -maxdepth 2" find "$TREE" -maxdepth 2
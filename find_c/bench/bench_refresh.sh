@@ -0,0 +1,42 @@
+#!/bin/sh
+# 增量刷新索引的基准：建立索引后在若干个目录中创建和删除文件，比较 --refresh-index 与重新建立索引的耗时，
+# 并检查刷新得到的索引与重新建立的索引完全相同（只改变了名称，没有修改文件内容）。
+#
+# 用法：bench/bench_refresh.sh [目录树路径] [修改的目录数] [索引文件目录]
+# 目录树会被修改，默认使用单独生成的 /tmp/myfind_refresh_tree。
+
+set -e
+cd "$(dirname "$0")/.."
+
+TREE=${1:-/tmp/myfind_refresh_tree}
+DIRS=${2:-100}
+DIR=${3:-/tmp}
+
+[ -x ./myfind ] || make >/dev/null
+[ -d "$TREE" ] || python3 bench/gen_tree.py "$TREE" --depth 4 --fanout 10 --files 90 >/dev/null
+
+timed() {
+    start=$(date +%s.%N)
+    "$@"
+    end=$(date +%s.%N)
+    awk "BEGIN { printf \"%.3f\", $end - $start }"
+}
+
+echo "build index: $(timed ./myfind --build-index "$DIR/myfind_refresh.idx" "$TREE")s, $(./myfind --use-index "$DIR/myfind_refresh.idx" | wc -l) entries"
+
+# 在前 DIRS 个叶子目录中各创建一个文件并删除一个文件
+./myfind "$TREE" -mindepth 4 -type d -limit "$DIRS" | while read -r d; do
+    : >"$d/refresh_$$"
+    rm -f "$d/$(ls "$d" | head -n 1)"
+done
+
+echo "refresh after changing $DIRS directories: $(timed ./myfind --refresh-index "$DIR/myfind_refresh.idx")s"
+echo "refresh without changes: $(timed ./myfind --refresh-index "$DIR/myfind_refresh.idx")s"
+echo "full rebuild: $(timed ./myfind --build-index "$DIR/myfind_full.idx" "$TREE")s"
+if cmp -s "$DIR/myfind_refresh.idx" "$DIR/myfind_full.idx"; then
+    echo "refreshed index is identical to a full rebuild"
+else
+    echo "refreshed index differs from a full rebuild"
+    exit 1
+fi
+rm -f "$DIR/myfind_refresh.idx" "$DIR/myfind_full.idx"
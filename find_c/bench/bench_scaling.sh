@@ -0,0 +1,33 @@
+#!/bin/sh
+# 并行遍历的扩展性基准：在合成目录树上分别以 1..N 个线程运行 myfind。
+#
+# 用法：bench/bench_scaling.sh [最大线程数] [目录树路径]
+# 目录树不存在时使用 gen_tree.py 生成（约 60 万个节点）。
+
+set -e
+cd "$(dirname "$0")/.."
+
+MAX_JOBS=${1:-$(nproc)}
+TREE=${2:-/tmp/myfind_bench_tree}
+
+[ -x ./myfind ] || make >/dev/null
+if [ ! -d "$TREE" ]; then
+    echo "generating $TREE ..."
+    python3 bench/gen_tree.py "$TREE" --depth 5 --fanout 6 --files 60 >/dev/null
+fi
+
+# 预热页缓存，并记录单线程输出用于校验
+./myfind "$TREE" | sort >/tmp/myfind_bench_ref
+
+j=1
+while [ "$j" -le "$MAX_JOBS" ]; do
+    for mode in "" "--ordered"; do
+        start=$(date +%s.%N)
+        ./myfind -j "$j" $mode "$TREE" >/tmp/myfind_bench_out
+        end=$(date +%s.%N)
+        sort /tmp/myfind_bench_out | cmp -s - /tmp/myfind_bench_ref || echo "output mismatch: -j $j $mode"
+        printf 'jobs=%-3d %-10s %.3fs\n' "$j" "${mode:-unordered}" "$(awk "BEGIN { print $end - $start }")"
+    done
+    j=$((j * 2))
+done
+rm -f /tmp/myfind_bench_ref /tmp/myfind_bench_out
@@ -0,0 +1,162 @@
+// lib_str 的自检与微基准：先检查每组实现（逐字节、SSE2、AVX2）与 glibc 的结果一致，
+// 再比较 strlen、strcmp、strrchr 每次调用的耗时。
+//
+// 自检的字符串紧贴一个不可访问的页，向量实现读到字符串之后的页就会触发段错误。
+// 自检失败时返回 1。
+//
+// 用法：make bench_str && ./bench_str [每项调用次数]
+
+#include "lib/lib_str.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+// 计时用的字符串数量（2 的幂），循环使用
+#define POOL_SIZE 4096
+
+static double elapsed(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// 用小字母表填充，使 strrchr 能找到匹配、strcmp 经常有相同的前缀
+static void fill(char *s, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        s[i] = "ab/."[rand() % 4];
+    s[len] = '\0';
+}
+
+static int check(const struct str_impl *impl)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    char *mem = mmap(NULL, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    char *end = mem + page;
+    char other[256];
+    char *s, *r;
+    int fail = 0;
+    mprotect(end, page, PROT_NONE);
+    for (size_t len = 0; len < 200; len++)
+    {
+        // 字符串的结束符是页中的最后一个字节，起始地址覆盖所有对齐方式
+        s = end - len - 1;
+        fill(s, len);
+        if (impl->len(s) != strlen(s))
+            fail++;
+        for (int ch = 'a'; ch <= 'c'; ch++)
+        {
+            r = impl->rchr(s, ch);
+            if (r != strrchr(s, ch))
+                fail++;
+        }
+        for (size_t olen = len > 3 ? len - 3 : 0; olen < len + 3; olen++)
+        {
+            // 另一个字符串在不同的对齐位置，与 s 相同或只在某个位置不同
+            char *o = other + (len % 32);
+            memcpy(o, s, olen < len ? olen : len);
+            fill(o + len, olen > len ? olen - len : 0);
+            o[olen] = '\0';
+            if (len && olen == len && rand() % 2)
+                o[rand() % len] = 'z';
+            if (impl->cmp(s, o) != (strcmp(s, o) != 0) || impl->cmp(o, s) != (strcmp(o, s) != 0))
+                fail++;
+        }
+    }
+    munmap(mem, 2 * page);
+    return fail;
+}
+
+static size_t glibc_len(char *s)
+{
+    return strlen(s);
+}
+
+static int glibc_cmp(char *s1, char *s2)
+{
+    return strcmp(s1, s2) != 0;
+}
+
+static char *glibc_rchr(char *s, char ch)
+{
+    return strrchr(s, ch);
+}
+
+static const struct str_impl glibc = {"glibc", glibc_len, glibc_cmp, glibc_rchr};
+
+static void run(const struct str_impl *impl, char **pool, char **peer, long count)
+{
+    struct timespec start, end;
+    volatile size_t sink = 0;
+    double len, cmp, rchr;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < count; i++)
+        sink += impl->len(pool[i & (POOL_SIZE - 1)]);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    len = elapsed(&start, &end) * 1e9 / count;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < count; i++)
+        sink += impl->cmp(pool[i & (POOL_SIZE - 1)], peer[i & (POOL_SIZE - 1)]);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    cmp = elapsed(&start, &end) * 1e9 / count;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < count; i++)
+        sink += (size_t)impl->rchr(pool[i & (POOL_SIZE - 1)], '/');
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    rchr = elapsed(&start, &end) * 1e9 / count;
+    printf("%-8s %8.2f %8.2f %8.2f\n", impl->name, len, cmp, rchr);
+}
+
+// 以给定的长度范围生成字符串，peer 中是相同的副本，一半在末尾附近改动一个字节
+static void bench(const char *title, size_t min, size_t max, long count)
+{
+    char *pool[POOL_SIZE], *peer[POOL_SIZE];
+    const struct str_impl *impl;
+    size_t len;
+    for (size_t i = 0; i < POOL_SIZE; i++)
+    {
+        len = min + rand() % (max - min + 1);
+        // 起始地址不对齐，与遍历时拼接出的路径相同
+        pool[i] = (char *)malloc(len + 2) + i % 2;
+        fill(pool[i], len);
+        peer[i] = my_strcp(pool[i]);
+        if (i % 2)
+            peer[i][len - 1] = 'z';
+    }
+    printf("\n%s (%zu-%zu bytes), ns/call\n%-8s %8s %8s %8s\n", title, min, max, "", "strlen", "strcmp", "strrchr");
+    run(&glibc, pool, peer, count);
+    for (size_t i = 0; i < 3; i++)
+    {
+        if ((impl = my_str_impl(i)))
+            run(impl, pool, peer, count);
+    }
+    for (size_t i = 0; i < POOL_SIZE; i++)
+    {
+        free(pool[i] - i % 2);
+        free(peer[i]);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    long count = argc > 1 ? atol(argv[1]) : 10000000;
+    const struct str_impl *impl;
+    const struct str_impl *cur = my_str_use(NULL);
+    int fail = 0, f;
+    my_str_use(cur);
+    srand(1);
+    printf("dispatch: %s\n", cur->name);
+    for (size_t i = 0; i < 3; i++)
+    {
+        if (!(impl = my_str_impl(i)))
+            continue;
+        f = check(impl);
+        printf("check %-8s %s\n", impl->name, f ? "FAIL" : "ok");
+        fail += f;
+    }
+    bench("file names", 4, 32, count);
+    bench("paths", 32, 160, count);
+    return fail != 0;
+}
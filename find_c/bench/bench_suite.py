@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""基准测试套件：在参数化的合成目录树上对 myfind、GNU find 和 find_py 运行一组标准查询。
+
+每个（目录树, 查询, 实现）组合先运行一次统计输出的行数（带 -exec 的查询不输出路径），再用 bench/runstat 计时若干次取最好成绩，
+最后在 ptrace 下运行一次统计系统调用。结果每个组合一行 JSON，写到 --output 指定的文件（默认标准输出），
+便于与之前的结果比较；便于阅读的表格输出到标准错误。
+
+find_py 只支持 -name，其余查询记为不支持；它把每个目录项都打印到标准输出，匹配的路径写到当前目录的 res.txt，
+因此在临时目录中运行。
+
+用法：make bench，或 bench/bench_suite.py [--trees small,deep,...] [--tools myfind,find,find_py] [--runs N] [--output FILE]
+"""
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+from gen_tree import gen, gen_flat, gen_loops
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+MYFIND = os.path.join(HERE, "..", "myfind")
+RUNSTAT = os.path.join(HERE, "runstat")
+FIND_PY = os.path.join(HERE, "..", "..", "find_py", "utility_find.py")
+
+# 目录树：名称 -> gen_tree 的参数
+TREES = {
+    "small": dict(depth=3, fanout=8, files=16, mixed=True),
+    "deep": dict(depth=5, fanout=8, files=8, mixed=True),
+    "flat": dict(depth=0, fanout=0, files=0, flat=200000, mixed=True),
+    "longnames": dict(depth=3, fanout=8, files=32, name_len=200, mixed=True),
+    "loops": dict(depth=3, fanout=6, files=10, loops=100, mixed=True),
+}
+
+# 查询：名称 -> (选项, 表达式, 运行的目录树)，None 表示所有目录树
+QUERIES = {
+    "name": ([], ["-name", "*.c"], None),
+    "type": ([], ["-type", "d"], None),
+    "perm": ([], ["-perm", "600"], None),
+    "follow": (["-L"], ["-name", "*.h"], ("loops",)),
+    "exec;": ([], ["-name", "f2.h", "-exec", "true", "{}", ";"], ("small",)),
+    "exec+": ([], ["-name", "*.log", "-exec", "true", "{}", "+"], ("small", "deep")),
+}
+# find_py 支持的查询及其 -name 参数；它跟随符号链接时不检测循环，不参与 follow 查询
+PY_QUERIES = {"name": "*.c"}
+
+
+def tree_path(base: str, name: str) -> str:
+    params = TREES[name]
+    tag = "-".join(f"{k}{int(v)}" for k, v in sorted(params.items()))
+    return os.path.join(base, f"{name}-{tag}")
+
+
+def ensure_tree(base: str, name: str) -> tuple:
+    """生成目录树（已存在时复用），返回路径和节点数。"""
+    p = dict(TREES[name])
+    path = tree_path(base, name)
+    count_file = path + ".count"
+    if os.path.isdir(path) and os.path.exists(count_file):
+        with open(count_file) as f:
+            return path, int(f.read())
+    print(f"generating {path} ...", file=sys.stderr)
+    shutil.rmtree(path, ignore_errors=True)
+    count = gen(path, p["depth"], p["fanout"], p["files"], p.get("name_len", 0), p.get("mixed", False))
+    if p.get("flat"):
+        count += gen_flat(os.path.join(path, "flat"), p["flat"], p.get("name_len", 0), p.get("mixed", False))
+    if p.get("loops"):
+        count += gen_loops(path, p["depth"], p["fanout"], p["loops"])
+    with open(count_file, "w") as f:
+        f.write(str(count))
+    return path, count
+
+
+def command(tool: str, tree: str, query: str) -> list:
+    opts, expr, _ = QUERIES[query]
+    if tool == "myfind":
+        return [MYFIND] + opts + [tree] + expr
+    if tool == "find":
+        return ["find"] + opts + [tree] + expr
+    return [sys.executable, FIND_PY] + opts + [tree, "-name", PY_QUERIES[query]]
+
+
+def count_lines(tool: str, cmd: list, cwd: str) -> int:
+    out = subprocess.run(cmd, cwd=cwd, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL).stdout
+    if tool == "find_py":
+        with open(os.path.join(cwd, "res.txt"), "rb") as f:
+            return f.read().count(b"\n")
+    return out.count(b"\n")
+
+
+def runstat(cmd: list, cwd: str, syscalls: bool = False) -> dict:
+    args = [RUNSTAT] + (["-s"] if syscalls else []) + cmd
+    out = subprocess.run(args, cwd=cwd, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, check=True).stdout
+    return json.loads(out)
+
+
+def available_tools(wanted: list) -> list:
+    tools = []
+    for tool in wanted:
+        if tool == "find":
+            try:
+                version = subprocess.run(["find", "--version"], stdout=subprocess.PIPE, stderr=subprocess.DEVNULL).stdout
+            except OSError:
+                version = b""
+            if b"GNU" not in version:
+                print("GNU find not found, skipped", file=sys.stderr)
+                continue
+        if tool == "find_py" and not os.path.exists(FIND_PY):
+            print(f"{FIND_PY} not found, skipped", file=sys.stderr)
+            continue
+        tools.append(tool)
+    return tools
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run the standard query mix against myfind, GNU find and find_py.")
+    parser.add_argument("--base", default="/tmp/myfind_suite", help="Where generated trees are kept between runs.")
+    parser.add_argument("--trees", default=",".join(TREES), help="Comma-separated trees to run.")
+    parser.add_argument("--queries", default=",".join(QUERIES), help="Comma-separated queries to run.")
+    parser.add_argument("--tools", default="myfind,find,find_py", help="Comma-separated implementations to compare.")
+    parser.add_argument("--runs", type=int, default=3, help="Timed runs per combination; the best is reported.")
+    parser.add_argument("--no-syscalls", action="store_true", help="Skip the ptrace run that counts syscalls.")
+    parser.add_argument("--output", help="Write JSON lines here instead of stdout.")
+    args = parser.parse_args()
+
+    if not os.access(RUNSTAT, os.X_OK) or not os.access(MYFIND, os.X_OK):
+        print("build first: make myfind bench/runstat", file=sys.stderr)
+        sys.exit(1)
+    tools = available_tools(args.tools.split(","))
+    out = open(args.output, "w") if args.output else sys.stdout
+    cwd = tempfile.mkdtemp(prefix="myfind_suite_")
+    print(f"{'tree':<10} {'query':<7} {'tool':<7} {'lines':>8} {'best(s)':>9} {'entries/s':>11} "
+          f"{'syscalls':>9} {'stat':>8} {'rss KiB':>8}", file=sys.stderr)
+    try:
+        for tree_name in args.trees.split(","):
+            tree, entries = ensure_tree(args.base, tree_name)
+            for query in args.queries.split(","):
+                only = QUERIES[query][2]
+                if only is not None and tree_name not in only:
+                    continue
+                for tool in tools:
+                    rec = {"tree": tree_name, "entries": entries, "query": query, "tool": tool,
+                           "args": QUERIES[query][0] + QUERIES[query][1]}
+                    if tool == "find_py" and query not in PY_QUERIES:
+                        rec["supported"] = False
+                        out.write(json.dumps(rec) + "\n")
+                        continue
+                    cmd = command(tool, tree, query)
+                    rec["supported"] = True
+                    rec["lines"] = count_lines(tool, cmd, cwd)
+                    best = min((runstat(cmd, cwd) for _ in range(args.runs)), key=lambda r: r["wall"])
+                    rec.update(best)
+                    rec["entries_per_sec"] = round(entries / best["wall"]) if best["wall"] > 0 else None
+                    if not args.no_syscalls:
+                        traced = runstat(cmd, cwd, syscalls=True)
+                        for key in ("syscalls", "stat", "getdents", "open"):
+                            rec[key] = traced.get(key)
+                    out.write(json.dumps(rec) + "\n")
+                    out.flush()
+                    print(f"{tree_name:<10} {query:<7} {tool:<7} {rec['lines']:>8} {best['wall']:>9.4f} "
+                          f"{rec['entries_per_sec'] or 0:>11} {rec.get('syscalls') or '-':>9} "
+                          f"{rec.get('stat') if rec.get('stat') is not None else '-':>8} {best['maxrss_kib']:>8}",
+                          file=sys.stderr)
+    finally:
+        shutil.rmtree(cwd, ignore_errors=True)
+        if args.output:
+            out.close()
+
+
+if __name__ == "__main__":
+    main()
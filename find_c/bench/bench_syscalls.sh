@@ -0,0 +1,38 @@
+#!/bin/sh
+# 每个目录项的系统调用次数基准：使用 strace 统计不同谓词下 myfind 的系统调用。
+#
+# 用法：bench/bench_syscalls.sh [目录树路径]
+# 只使用 -name 时类型信息来自 d_type，每个目录项不应产生 stat 调用；
+# -type 在 d_type 可用时同样不需要 stat；-perm 需要完整的模式，每个目录项一次 fstatat。
+# -perm 写在 -name 之前时，默认的 -O1 把 -name 移到前面，只有名称匹配的目录项才需要 fstatat，
+# -O0 保持命令行中的顺序作为对照。
+
+set -e
+# 查询中的通配符原样传给 myfind
+set -f
+cd "$(dirname "$0")/.."
+
+TREE=${1:-/tmp/myfind_bench_tree}
+
+command -v strace >/dev/null || { echo "strace is required" >&2; exit 1; }
+[ -x ./myfind ] || make >/dev/null
+if [ ! -d "$TREE" ]; then
+    echo "generating $TREE ..."
+    python3 bench/gen_tree.py "$TREE" --depth 3 --fanout 8 --files 50 >/dev/null
+fi
+
+entries=$(./myfind "$TREE" | wc -l)
+echo "entries: $entries"
+for query in "-name *.txt" "-type f" "-perm 644" "-L -name *.txt" "-perm 644 -name f1.txt" "-O0 -perm 644 -name f1.txt"; do
+    case "$query" in
+    -L*|-O0*) opts=${query%% *}; expr=${query#* } ;;
+    *) opts=""; expr=$query ;;
+    esac
+    # shellcheck disable=SC2086
+    strace -f -qq -o /tmp/myfind_strace ./myfind $opts "$TREE" $expr >/dev/null
+    total=$(wc -l </tmp/myfind_strace)
+    stats=$(grep -cE '(stat|statx)\(' /tmp/myfind_strace || true)
+    printf '%-28s syscalls/entry %.2f  stat-family/entry %.2f\n' "$query" \
+        "$(awk "BEGIN { print $total / $entries }")" "$(awk "BEGIN { print $stats / $entries }")"
+done
+rm -f /tmp/myfind_strace
@@ -0,0 +1,41 @@
+#!/bin/sh
+# 同步 fstatat 与 io_uring statx 流水线的对比基准。
+#
+# 用法：bench/bench_uring.sh [目录树路径]
+# 默认使用 bench/gen_tree.py 生成的 /tmp/myfind_bench_tree。以 root 运行时每次计时前清空页缓存，
+# 否则测得的是热缓存下的开销（此时 io_uring 没有优势，主要用于确认其额外开销很小）。
+
+set -e
+cd "$(dirname "$0")/.."
+
+TREE=${1:-/tmp/myfind_bench_tree}
+
+[ -x ./myfind ] || make >/dev/null
+[ -d "$TREE" ] || python3 bench/gen_tree.py "$TREE" --depth 4 --fanout 8 --files 20
+
+drop_caches() {
+    if [ -w /proc/sys/vm/drop_caches ]; then
+        sync
+        echo 3 >/proc/sys/vm/drop_caches
+    fi
+}
+
+[ -w /proc/sys/vm/drop_caches ] || echo "not root: page cache is not dropped, timings are warm-cache"
+
+expected=$(./myfind "$TREE" -perm 644 | sort | cksum)
+for mode in "" "--uring" "-j 4" "-j 4 --uring"; do
+    best=""
+    for run in 1 2 3; do
+        drop_caches
+        start=$(date +%s.%N)
+        # shellcheck disable=SC2086
+        ./myfind $mode "$TREE" -perm 644 >/dev/null
+        end=$(date +%s.%N)
+        t=$(awk "BEGIN { print $end - $start }")
+        best=$(awk "BEGIN { b = \"$best\"; print (b == \"\" || $t < b) ? $t : b }")
+    done
+    # shellcheck disable=SC2086
+    got=$(./myfind $mode "$TREE" -perm 644 | sort | cksum)
+    [ "$got" = "$expected" ] && check=ok || check=MISMATCH
+    printf '%-14s best of 3: %.3fs %s\n' "${mode:-sync}" "$best" "$check"
+done
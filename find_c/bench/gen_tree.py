@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""生成用于基准测试的合成目录树。
+
+每个目录包含 `--files` 个普通文件和 `--fanout` 个子目录，共 `--depth` 层。
+此外可以生成：
+- `--flat N`：根目录下的 `flat` 目录，其中有 N 个文件，用于测试很大的扁平目录；
+- `--name-len L`：文件名用 `x` 补足到 L 个字符，用于测试很长的名称；
+- `--loops N`：N 个指向祖先目录的符号链接 `loopK`，只有 `-L` 会跟随并检测到循环；
+- `--mixed`：文件名的后缀依次为 `.txt`、`.c`、`.h`、`.log`（否则都是 `.txt`），
+  每三个文件中有一个权限为 0600、一个为 0755，其余为 0644，使 `-name`、`-perm` 的结果更接近真实的树。
+
+生成过程是确定的，同样的参数总是得到同样的树。
+"""
+import argparse
+import os
+
+SUFFIXES = (".txt", ".c", ".h", ".log")
+MODES = (0o644, 0o600, 0o755)
+
+
+def file_name(i: int, name_len: int, mixed: bool) -> str:
+    suffix = SUFFIXES[i % len(SUFFIXES)] if mixed else ".txt"
+    stem = f"f{i}"
+    if len(stem) + len(suffix) < name_len:
+        stem += "x" * (name_len - len(stem) - len(suffix))
+    return stem + suffix
+
+
+def gen(path: str, depth: int, fanout: int, files: int, name_len: int = 0, mixed: bool = False) -> int:
+    os.makedirs(path, exist_ok=True)
+    count = 1
+    for i in range(files):
+        name = os.path.join(path, file_name(i, name_len, mixed))
+        open(name, "w").close()
+        if mixed:
+            os.chmod(name, MODES[i % len(MODES)])
+        count += 1
+    if depth > 0:
+        for i in range(fanout):
+            count += gen(os.path.join(path, f"d{i}"), depth - 1, fanout, files, name_len, mixed)
+    return count
+
+
+def gen_flat(path: str, files: int, name_len: int = 0, mixed: bool = False) -> int:
+    os.makedirs(path, exist_ok=True)
+    for i in range(files):
+        open(os.path.join(path, file_name(i, name_len, mixed)), "w").close()
+    return files + 1
+
+
+def gen_loops(root: str, depth: int, fanout: int, loops: int) -> int:
+    """在最深一层的目录中依次放置指向 1 到 depth 层之上祖先的符号链接。"""
+    made = 0
+    for k in range(loops):
+        # 按 k 的各位数字选择一条从根到最深层的路径
+        parts, n = [], k
+        for _ in range(depth):
+            parts.append(f"d{n % fanout}")
+            n //= fanout
+        up = k % depth + 1
+        link = os.path.join(root, *parts, f"loop{k}")
+        if not os.path.lexists(link):
+            os.symlink(os.path.join(*[".."] * up), link)
+        made += 1
+    return made
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a synthetic directory tree.")
+    parser.add_argument("root", help="Directory to create.")
+    parser.add_argument("--depth", type=int, default=4, help="Number of directory levels below root.")
+    parser.add_argument("--fanout", type=int, default=8, help="Subdirectories per directory.")
+    parser.add_argument("--files", type=int, default=16, help="Regular files per directory.")
+    parser.add_argument("--flat", type=int, default=0, help="Files in an extra flat directory root/flat.")
+    parser.add_argument("--name-len", type=int, default=0, help="Pad file names to this length.")
+    parser.add_argument("--loops", type=int, default=0, help="Symlinks to ancestor directories (needs depth > 0).")
+    parser.add_argument("--mixed", action="store_true", help="Mix .txt/.c/.h/.log suffixes and 0644/0600/0755 modes.")
+    args = parser.parse_args()
+    count = gen(args.root, args.depth, args.fanout, args.files, args.name_len, args.mixed)
+    if args.flat:
+        count += gen_flat(os.path.join(args.root, "flat"), args.flat, args.name_len, args.mixed)
+    if args.loops and args.depth > 0 and args.fanout > 0:
+        count += gen_loops(args.root, args.depth, args.fanout, args.loops)
+    print(count)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,36 @@
+// 统计进程调用 malloc、calloc 和 realloc 的次数，退出时输出到标准错误。
+//
+// 用法：make bench/malloc_count.so && LD_PRELOAD=bench/malloc_count.so ./myfind ...
+// 直接转发到 glibc 导出的 __libc_* 函数，避免 dlsym 自身分配内存造成的递归。
+
+#include <stddef.h>
+#include <stdio.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static long allocs;
+
+void *malloc(size_t size)
+{
+    __atomic_add_fetch(&allocs, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    __atomic_add_fetch(&allocs, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    __atomic_add_fetch(&allocs, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(ptr, size);
+}
+
+__attribute__((destructor)) static void report(void)
+{
+    fprintf(stderr, "allocations: %ld\n", allocs);
+}
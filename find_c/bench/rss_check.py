@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""内存回归检查：在约 100 万个节点的合成目录树上运行 myfind，断言峰值 RSS 不超过上限。
+
+节点求值后立即释放，峰值内存只应与目录深度有关，而与节点总数无关。
+用法：bench/rss_check.py [--tree PATH] [--limit-mib N] [myfind 额外参数...]
+"""
+import argparse
+import os
+import subprocess
+import sys
+import time
+
+from gen_tree import gen
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+MYFIND = os.path.join(HERE, "..", "myfind")
+
+
+def vm_hwm(pid: int) -> int:
+    """返回进程的峰值 RSS（KiB），进程已退出时返回 0。"""
+    try:
+        with open(f"/proc/{pid}/status") as f:
+            for line in f:
+                if line.startswith("VmHWM:"):
+                    return int(line.split()[1])
+    except OSError:
+        pass
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Assert a peak RSS ceiling for myfind.")
+    parser.add_argument("--tree", default="/tmp/myfind_rss_tree", help="Tree to walk, generated if missing.")
+    parser.add_argument("--limit-mib", type=float, default=8.0, help="Peak RSS ceiling in MiB.")
+    parser.add_argument("args", nargs="*", help="Extra myfind arguments, e.g. -j 4 or -d.")
+    args = parser.parse_args()
+
+    if not os.path.isdir(args.tree):
+        # 11111 个目录，每个目录 90 个文件，共约 101 万个节点
+        print(f"generating {args.tree} ...", file=sys.stderr)
+        gen(args.tree, depth=4, fanout=10, files=90)
+
+    # 子进程的 ru_maxrss 会计入 fork 时继承的 Python 解释器内存，
+    # 因此轮询 /proc/PID/status 中的 VmHWM（exec 之后重新计数的峰值）
+    peak_kib = 0
+    with open(os.devnull, "w") as devnull:
+        proc = subprocess.Popen([MYFIND] + args.args + [args.tree], stdout=devnull)
+        while proc.poll() is None:
+            peak_kib = max(peak_kib, vm_hwm(proc.pid))
+            time.sleep(0.02)
+    if proc.returncode != 0:
+        print(f"myfind exited with {proc.returncode}", file=sys.stderr)
+        sys.exit(1)
+
+    peak_mib = peak_kib / 1024
+    print(f"peak RSS {peak_mib:.1f} MiB (limit {args.limit_mib:.1f} MiB)")
+    if peak_mib > args.limit_mib:
+        print("FAIL: peak RSS above limit", file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,168 @@
+// 运行一条命令并以一行 JSON 输出它的资源使用情况，供 bench/bench_suite.py 使用。
+//
+// 用法：make bench/runstat && bench/runstat [-s] 命令 [参数...]
+// 命令的标准输出重定向到 /dev/null，结果写到标准输出：
+//   {"status":0,"wall":0.123,"user":0.1,"sys":0.02,"maxrss_kib":2048}
+// 加上 -s 时用 ptrace 跟踪命令及其线程（不含 -exec 启动的子进程），额外统计系统调用次数：
+//   "syscalls"、"stat"（stat 族）、"getdents"、"open"。跟踪会显著拖慢命令，因此计时和计数应分开运行。
+// 由体积很小的本程序 fork 出命令，ru_maxrss 不会计入调用者（例如 Python 解释器）的内存。
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+struct counts
+{
+    uint64_t total;
+    uint64_t stat;
+    uint64_t getdents;
+    uint64_t open;
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double tv_sec(struct timeval *tv)
+{
+    return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+static void classify(struct counts *c, uint64_t nr)
+{
+    c->total++;
+    switch (nr)
+    {
+#ifdef SYS_stat
+    case SYS_stat:
+#endif
+#ifdef SYS_lstat
+    case SYS_lstat:
+#endif
+#ifdef SYS_newfstatat
+    case SYS_newfstatat:
+#endif
+#ifdef SYS_statx
+    case SYS_statx:
+#endif
+    case SYS_fstat:
+        c->stat++;
+        break;
+#ifdef SYS_getdents
+    case SYS_getdents:
+#endif
+    case SYS_getdents64:
+        c->getdents++;
+        break;
+#ifdef SYS_open
+    case SYS_open:
+#endif
+    case SYS_openat:
+        c->open++;
+        break;
+    default:
+        break;
+    }
+}
+
+// 跟踪 pid 及其创建的线程直到 pid 退出，返回 pid 的等待状态
+static int trace(pid_t pid, struct counts *c, struct rusage *ru)
+{
+    struct __ptrace_syscall_info info;
+    int status, result = 0, sig;
+    pid_t tid;
+    // 停在 exec 之后
+    if (waitpid(pid, &status, 0) != pid || !WIFSTOPPED(status))
+        return status;
+    ptrace(PTRACE_SETOPTIONS, pid, 0, PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | PTRACE_O_EXITKILL);
+    ptrace(PTRACE_SYSCALL, pid, 0, 0);
+    for (;;)
+    {
+        tid = wait4(-1, &status, __WALL, ru);
+        if (tid == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (WIFEXITED(status) || WIFSIGNALED(status))
+        {
+            if (tid == pid)
+                result = status;
+            continue;
+        }
+        sig = 0;
+        if (WSTOPSIG(status) == (SIGTRAP | 0x80))
+        {
+            if (ptrace(PTRACE_GET_SYSCALL_INFO, tid, sizeof(info), &info) > 0 && info.op == PTRACE_SYSCALL_INFO_ENTRY)
+                classify(c, info.entry.nr);
+        }
+        else if (WSTOPSIG(status) != SIGTRAP && WSTOPSIG(status) != SIGSTOP)
+            sig = WSTOPSIG(status); // 转发真正的信号
+        ptrace(PTRACE_SYSCALL, tid, 0, sig);
+    }
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    struct counts c = {0};
+    struct rusage ru;
+    int count = argc > 1 && strcmp(argv[1], "-s") == 0;
+    int status, devnull;
+    double start, end;
+    pid_t pid;
+    char **cmd = argv + 1 + count;
+    if (!*cmd)
+    {
+        fprintf(stderr, "usage: %s [-s] command [args...]\n", argv[0]);
+        return 2;
+    }
+    start = now();
+    pid = fork();
+    if (pid == -1)
+    {
+        perror("fork");
+        return 2;
+    }
+    if (pid == 0)
+    {
+        devnull = open("/dev/null", O_WRONLY);
+        dup2(devnull, STDOUT_FILENO);
+        if (count)
+            ptrace(PTRACE_TRACEME, 0, 0, 0);
+        execvp(cmd[0], cmd);
+        perror(cmd[0]);
+        _exit(127);
+    }
+    if (count)
+        status = trace(pid, &c, &ru);
+    else
+        wait4(pid, &status, 0, &ru);
+    end = now();
+    // 跟踪时 wait4 返回的是最后一个线程的资源使用，改为取所有已回收子进程的总和
+    if (count)
+        getrusage(RUSAGE_CHILDREN, &ru);
+    printf("{\"status\":%d,\"wall\":%.6f,\"user\":%.6f,\"sys\":%.6f,\"maxrss_kib\":%ld",
+           WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status), end - start,
+           tv_sec(&ru.ru_utime), tv_sec(&ru.ru_stime), ru.ru_maxrss);
+    if (count)
+        printf(",\"syscalls\":%llu,\"stat\":%llu,\"getdents\":%llu,\"open\":%llu",
+               (unsigned long long)c.total, (unsigned long long)c.stat, (unsigned long long)c.getdents,
+               (unsigned long long)c.open);
+    printf("}\n");
+    return 0;
+}
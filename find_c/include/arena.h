@@ -0,0 +1,102 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**
+ * @def ARENA_CHUNK_SIZE
+ * @brief 每块内存的默认容量，超过该大小的分配单独占用一块。
+ */
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+/**
+ * @struct arena_chunk
+ * @brief 竞技场中的一块连续内存，新块链接在旧块之前。
+ */
+struct arena_chunk
+{
+    struct arena_chunk *prev; /**< 之前分配的块。 */
+    size_t size;              /**< `data` 的容量。 */
+    size_t used;              /**< `data` 中已使用的字节数。 */
+    char data[];              /**< 分配给调用者的内存。 */
+};
+
+/**
+ * @struct arena
+ * @brief 按栈的顺序分配和释放的内存竞技场（bump allocator）。
+ *
+ * 遍历目录时每个目录项的路径从竞技场中分配，处理完目录项（包括递归进入的子目录）后
+ * 回退到之前记录的位置，因此同一块内存被反复用来拼接路径，每个目录项不需要调用 `malloc`。
+ * 每个线程使用自己的竞技场。
+ */
+struct arena
+{
+    struct arena_chunk *cur;   /**< 当前正在使用的块。 */
+    struct arena_chunk *spare; /**< 回退时保留的一个空闲块，避免在块边界反复分配和释放。 */
+    size_t chunks;             /**< 调用 `malloc` 分配过的块数，用于统计。 */
+};
+
+/**
+ * @struct arena_mark
+ * @brief 竞技场的一个位置，由 `arena_mark` 记录，`arena_release` 回退到该位置。
+ */
+struct arena_mark
+{
+    struct arena_chunk *chunk; /**< 记录时的当前块。 */
+    size_t used;               /**< 记录时当前块已使用的字节数。 */
+};
+
+/**
+ * @brief 初始化一个空的竞技场，第一次分配时才申请内存。
+ *
+ * @param a 要初始化的竞技场。
+ */
+void arena_init(struct arena *a);
+
+/**
+ * @brief 从竞技场中分配内存，按指针大小对齐。
+ *
+ * @param a 竞技场。
+ * @param size 需要的字节数。
+ *
+ * @return 分配的内存，在回退到更早的位置或释放竞技场之前有效。
+ */
+void *arena_alloc(struct arena *a, size_t size);
+
+/**
+ * @brief 在竞技场中拼接路径 `dir/name`，`dir` 以 `'/'` 结尾时不再插入分隔符（与 `my_concate` 相同）。
+ *
+ * @param a 竞技场。
+ * @param dir 目录路径。
+ * @param dlen `dir` 的长度。
+ * @param name 目录项名称。
+ *
+ * @return 以 `'\0'` 结尾的完整路径。
+ */
+char *arena_path(struct arena *a, char *dir, size_t dlen, char *name);
+
+/**
+ * @brief 记录竞技场的当前位置。
+ *
+ * @param a 竞技场。
+ *
+ * @return 当前位置。
+ */
+struct arena_mark arena_mark(struct arena *a);
+
+/**
+ * @brief 回退到之前记录的位置，释放之后分配的所有内存。
+ *
+ * @param a 竞技场。
+ * @param m `arena_mark` 返回的位置。
+ */
+void arena_release(struct arena *a, struct arena_mark m);
+
+/**
+ * @brief 释放竞技场占用的所有内存。
+ *
+ * @param a 要释放的竞技场。
+ */
+void arena_free(struct arena *a);
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "globmatch.h"
+#include "myfind.h"
+
+#include <stddef.h>
+
+/**
+ * @enum opcode
+ * @brief 字节码指令的操作码。
+ *
+ * 程序只有一个布尔累加器：谓词和动作指令把结果写入累加器，
+ * 跳转指令根据累加器决定是否跳转，从而实现 `-a`、`-o` 的短路求值。
+ */
+enum opcode
+{
+    OP_NAME = 0, /**< `-name`：文件名匹配通配符。 */
+    OP_NAMESET,  /**< 多个用 `-o` 连接的 `-name`：文件名匹配其中任意一个。 */
+    OP_TYPE,     /**< `-type`：文件类型匹配。 */
+    OP_PERM,     /**< `-perm`：权限位完全相等。 */
+    OP_SIZE,     /**< `-size`：文件大小与 `N` 比较。 */
+    OP_MTIME,    /**< `-mtime`、`-mmin`：修改时间距今的天数或分钟数与 `N` 比较。 */
+    OP_NEWER,    /**< `-newer`：修改时间晚于参考文件。 */
+    OP_EMPTY,    /**< `-empty`：空文件或空目录。 */
+    OP_CONTAINS, /**< `-contains`、`-contains-regex`：文件内容包含字符串或匹配正则表达式。 */
+    OP_PRUNE,    /**< `-prune`：标记节点不再进入，结果为真。 */
+    OP_LIMIT,    /**< `-limit N`：前 `N` 次为真，之后结束遍历。 */
+    OP_QUIT,     /**< `-quit`：请求结束遍历并立即返回真。 */
+    OP_PRINT,    /**< `-print`：输出路径和换行符，结果为真。 */
+    OP_PRINT0,   /**< `-print0`：输出路径和 `'\0'`，结果为真。 */
+    OP_EXEC,     /**< `-exec ... ;`：子进程退出状态为 0 时结果为真。 */
+    OP_EXECA,    /**< 结果不被使用的 `-exec ... ;`：通过子进程池启动，可以不等待其结束。 */
+    OP_EXECP,    /**< `-exec ... +`：加入批处理，结果为真。 */
+    OP_NOT,      /**< `!`：累加器取反。 */
+    OP_JF,       /**< 累加器为假时跳转到 `target`。 */
+    OP_JT,       /**< 累加器为真时跳转到 `target`。 */
+    OP_TRUE,     /**< 累加器置为真（空表达式）。 */
+    OP_END       /**< 结束，返回累加器。 */
+};
+
+/**
+ * @struct insn
+ * @brief 一条字节码指令。
+ */
+struct insn
+{
+    enum opcode op;      /**< 操作码。 */
+    size_t target;       /**< 跳转指令的目标下标。 */
+    struct compound *c;  /**< 谓词或动作的参数，其他指令为 NULL。 */
+    struct globset *set; /**< `OP_NAMESET` 的模式集合，由程序拥有。 */
+};
+
+/**
+ * @struct program
+ * @brief 由 AST 编译得到的线性字节码程序。
+ *
+ * 程序在求值过程中不会被修改，因此并行遍历的所有工作线程可以共享同一个程序。
+ */
+struct program
+{
+    struct insn *code; /**< 指令数组，最后一条指令为 `OP_END`。 */
+    size_t size;       /**< 指令数量。 */
+    size_t capacity;   /**< `code` 当前分配的容量。 */
+};
+
+/**
+ * @brief 将 `build_ast` 生成的 AST 编译成字节码。
+ *
+ * - `a -a b` 和相邻的 `a b` 编译为 `a; JF end; b`。
+ * - `a -o b` 编译为 `a; JT end; b`。
+ * - `! a` 只作用于紧随其后的一个操作数，编译为 `a; NOT`。
+ * - `-o` 连接的操作数中连续两个以上的 `-name` 合并为一条 `OP_NAMESET` 指令，一次扫描文件名即可完成匹配。
+ *
+ * 编译完成后对跳转链做一次合并：跳转到另一条同向跳转的指令直接跳到最终目标，
+ * 跳转到反向跳转的指令直接跳到其下一条指令。之后紧跟（可能经过 `OP_NOT`）`OP_END` 的 `OP_EXEC`
+ * 改为 `OP_EXECA`：含有 `-exec` 的表达式不会默认打印，因此它的退出状态不影响任何结果。
+ * AST 必须已经通过 `is_ast_valid` 的检查。
+ *
+ * @param ast AST 的根节点。
+ *
+ * @return 新分配的程序，由 `free_program` 释放。
+ */
+struct program *compile_ast(struct ast *ast);
+
+/**
+ * @brief 对一个节点执行字节码程序。
+ *
+ * @param d 指向 `struct data` 的指针，动作指令需要用到其中的批处理缓冲区和输出缓冲区。
+ * @param p 程序。
+ * @param n 当前节点。
+ *
+ * @return 表达式的值，真为 1，假为 0。
+ */
+int run_program(struct data *d, struct program *p, struct node *n);
+
+/**
+ * @brief 释放程序。
+ *
+ * @param p 要释放的程序，可以为 NULL。
+ */
+void free_program(struct program *p);
+
+#endif
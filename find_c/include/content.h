@@ -0,0 +1,83 @@
+#ifndef CONTENT_H
+#define CONTENT_H
+
+#include <regex.h>
+#include <stddef.h>
+
+/**
+ * @def CONTENT_BUF_SIZE
+ * @brief 每个线程读取文件内容的缓冲区的初始大小，`-contains-regex` 遇到更长的行时按需增长。
+ */
+#define CONTENT_BUF_SIZE (256 * 1024)
+
+/**
+ * @def CONTENT_BINARY_PROBE
+ * @brief `--skip-binary` 检查的文件开头的字节数，其中含有 `'\0'` 的文件视为二进制文件。
+ */
+#define CONTENT_BINARY_PROBE 4096
+
+/**
+ * @struct content_pattern
+ * @brief `-contains` 或 `-contains-regex` 在解析表达式时准备好的模式。
+ */
+struct content_pattern
+{
+    const char *needle; /**< `-contains` 的字符串，指向表达式中的参数。 */
+    size_t len;         /**< `needle` 的长度。 */
+    regex_t *regex;     /**< `-contains-regex` 编译后的扩展正则表达式（`REG_NEWLINE`），否则为 NULL。 */
+    int skip_binary;    /**< 开启 `--skip-binary` 时为 1：开头含有 `'\0'` 的文件不匹配。 */
+};
+
+/**
+ * @brief 在 `hay` 的前 `n` 个字节中查找 `needle`，与 GNU `memmem` 语义相同。
+ *
+ * 支持 SSE2/AVX2 时每次比较 16/32 个候选位置的首尾两个字节，只对两者都相等的位置比较整个字符串，
+ * 程序启动时按 CPU 支持的指令集选择实现。
+ *
+ * @param hay 被搜索的内容，不需要以 `'\0'` 结尾。
+ * @param n `hay` 的长度。
+ * @param needle 要查找的字节序列。
+ * @param m `needle` 的长度，为 0 时返回 `hay`。
+ *
+ * @return 第一次出现的位置；没有找到时返回 NULL。
+ */
+const char *content_memmem(const char *hay, size_t n, const char *needle, size_t m);
+
+/**
+ * @brief 编译 `-contains-regex` 的扩展正则表达式，按行匹配（`.` 和 `[^...]` 不匹配换行，`^`、`$` 匹配行首、行尾）。
+ *
+ * @param p 要填写的模式。
+ * @param pattern 正则表达式。
+ *
+ * @return 成功返回 0；表达式无效时输出错误信息并返回 1。
+ */
+int content_compile_regex(struct content_pattern *p, const char *pattern);
+
+/**
+ * @brief 释放 `content_compile_regex` 编译的正则表达式。
+ *
+ * @param p 模式，`regex` 可以为 NULL。
+ */
+void content_free(struct content_pattern *p);
+
+/**
+ * @brief 读取文件内容并查找模式，找到第一处匹配后立即停止读取。
+ *
+ * 文件用当前线程的缓冲区顺序 `read`，不用 `mmap`，因此被其他进程截断的文件不会导致 `SIGBUS`。
+ * `-contains` 在相邻两次读取之间保留 `len - 1` 个字节，跨越缓冲区边界的匹配不会遗漏；
+ * `-contains-regex` 只对完整的行求值，最后一行不完整的部分留到下一次读取。
+ *
+ * @param dirfd 文件所在目录的文件描述符，或 `AT_FDCWD`。
+ * @param name 相对于 `dirfd` 的文件名。
+ * @param p 模式。
+ *
+ * @return 找到返回 1，没有找到返回 0，无法打开或读取文件时返回 -1。
+ */
+int content_match(int dirfd, const char *name, const struct content_pattern *p);
+
+/**
+ * @brief 释放当前线程的读取缓冲区，工作线程结束前和程序退出时调用。
+ */
+void content_release(void);
+
+#endif
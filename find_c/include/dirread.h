@@ -0,0 +1,69 @@
+#ifndef DIRREAD_H
+#define DIRREAD_H
+
+#include <dirent.h>
+#include <stddef.h>
+
+/**
+ * @struct dir_entry
+ * @brief 目录读取器返回的一个目录项。
+ *
+ * `name` 指向读取器内部的缓冲区，只在下一次调用 `dir_next` 之前有效。
+ */
+struct dir_entry
+{
+    char *name;         /**< 目录项名称。 */
+    unsigned char type; /**< 目录项的 `d_type`，可能为 `DT_UNKNOWN`。 */
+};
+
+/**
+ * @struct dir_reader
+ * @brief 目录读取器，支持 `readdir` 和直接调用 `getdents64` 两种后端。
+ *
+ * `getdents64` 后端每次系统调用将一批目录项读入缓冲区。缓冲区从较小的容量开始，
+ * 当一次调用几乎填满缓冲区时（说明目录很大）翻倍，直到达到 `max` 指定的上限，
+ * 因此递归打开的小目录不会占用大量内存，而包含数百万个文件的扁平目录只需要很少的系统调用。
+ */
+struct dir_reader
+{
+    int fd;       /**< 目录的文件描述符。 */
+    DIR *di;      /**< `readdir` 后端使用的目录流，使用 `getdents64` 时为 NULL。 */
+    char *buf;    /**< `getdents64` 的缓冲区。 */
+    size_t size;  /**< `buf` 当前的容量。 */
+    size_t max;   /**< `buf` 允许增长到的最大容量。 */
+    size_t len;   /**< 上一次 `getdents64` 返回的字节数。 */
+    size_t pos;   /**< 当前批次中下一个目录项的偏移。 */
+    int eof;      /**< 是否已经读完目录。 */
+    int batches;  /**< 已调用 `getdents64` 的次数。 */
+};
+
+/**
+ * @brief 打开目录读取器。
+ *
+ * @param r 要初始化的读取器。
+ * @param fd 已打开的目录文件描述符，所有权转移给读取器，由 `dir_close` 关闭。
+ * @param max `getdents64` 缓冲区的最大字节数，小于初始容量（32 KiB）时按初始容量处理；
+ *            为 0 或系统不支持 `getdents64` 时使用 `readdir`。
+ *
+ * @return 成功返回 0；失败返回 -1 并设置 `errno`，此时 `fd` 已被关闭。
+ */
+int dir_open(struct dir_reader *r, int fd, size_t max);
+
+/**
+ * @brief 读取下一个目录项，跳过 `.` 和 `..`。
+ *
+ * @param r 读取器。
+ * @param e 用于保存目录项的结构体。
+ *
+ * @return 读到目录项返回 1；目录已读完或出错返回 0。
+ */
+int dir_next(struct dir_reader *r, struct dir_entry *e);
+
+/**
+ * @brief 关闭读取器及其文件描述符，并释放缓冲区。
+ *
+ * @param r 读取器。
+ */
+void dir_close(struct dir_reader *r);
+
+#endif
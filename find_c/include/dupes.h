@@ -0,0 +1,93 @@
+#ifndef DUPES_H
+#define DUPES_H
+
+#include "myfind.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @def DUPES_PROBE
+ * @brief 第二阶段读取的文件开头和结尾的字节数；不超过它两倍的文件在第二阶段就读取了全部内容。
+ */
+#define DUPES_PROBE 4096
+
+/**
+ * @def DUPES_BUF_SIZE
+ * @brief 第三阶段计算完整内容的散列时每个线程的读取缓冲区大小。
+ */
+#define DUPES_BUF_SIZE (256 * 1024)
+
+/**
+ * @struct dupe_file
+ * @brief 一个候选文件。
+ */
+struct dupe_file
+{
+    char *path;    /**< 文件的完整路径。 */
+    uint64_t size; /**< 文件大小。 */
+    uint64_t dev;  /**< `st_dev`，与 `ino` 一起识别硬链接。 */
+    uint64_t ino;  /**< `st_ino`。 */
+    uint64_t head; /**< 开头和结尾各 `DUPES_PROBE` 字节的散列，尚未计算时为 0。 */
+    uint64_t full; /**< 完整内容的散列；尚未计算或文件不超过 `2 * DUPES_PROBE` 字节时为 0。 */
+    size_t order;  /**< 加入的顺序，同一组内按它输出。 */
+    int err;       /**< 读取失败时的 `errno`，否则为 0。 */
+};
+
+/**
+ * @struct dupes
+ * @brief `--dupes` 模式收集的候选文件。
+ *
+ * 并行遍历的所有线程共享同一个实例，加入文件时加锁。
+ */
+struct dupes
+{
+    struct dupe_file *files; /**< 候选文件。 */
+    size_t count;            /**< 候选文件的数量。 */
+    size_t capacity;         /**< `files` 当前分配的容量。 */
+    pthread_mutex_t lock;    /**< 保护 `files` 和 `count`。 */
+};
+
+/**
+ * @brief 创建空的候选文件表。
+ *
+ * @return 新的表；内存不足时返回 NULL。
+ */
+struct dupes *dupes_create(void);
+
+/**
+ * @brief 释放候选文件表。
+ *
+ * @param dp 候选文件表，可以为 NULL。
+ */
+void dupes_destroy(struct dupes *dp);
+
+/**
+ * @brief 使表达式为真的节点如果是非空的普通文件（`-L` 时跟随符号链接），加入候选文件表，代替默认的打印。
+ *
+ * 大小、`st_dev` 和 `st_ino` 取自遍历时获取的属性（`d->attr_mask` 包含 `STATX_SIZE | STATX_INO`），
+ * 使用索引时取自索引中的记录，因此不需要额外的 `stat`。
+ *
+ * @param d 指向 `struct data` 的指针。
+ * @param n 当前节点。
+ */
+void dupes_add(struct data *d, struct node *n);
+
+/**
+ * @brief 遍历结束后找出内容相同的文件并输出。
+ *
+ * 分三个阶段逐步缩小候选范围，每个阶段只处理在上一阶段中仍与其他文件相同的文件：
+ * 按大小分组；计算开头和结尾各 `DUPES_PROBE` 字节的散列；计算完整内容的散列。
+ * 散列使用 xxHash64 算法。同一个 inode 的多个硬链接只读取一次，只由硬链接组成的组不是重复文件。
+ * 后两个阶段用 `-j` 指定的线程数并行读取文件。
+ *
+ * 每组重复文件按加入的顺序输出，每行一个路径，组之后输出一个空行；较大的文件的组在前。
+ *
+ * @param d 指向 `struct data` 的指针，`d->dupes` 中是遍历收集的候选文件。
+ *
+ * @return 所有文件都能读取时返回 0；否则输出错误信息（这些文件不参与比较）并返回 1。
+ */
+int dupes_run(struct data *d);
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef EXEC_H
+#define EXEC_H
+
+#include <poll.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * @def EXEC_HEADROOM
+ * @brief 计算参数字节预算时额外预留的字节数（与 `xargs` 相同）。
+ */
+#define EXEC_HEADROOM 2048
+
+/**
+ * @struct child
+ * @brief 子进程池中一个正在运行的子进程。
+ */
+struct child
+{
+    pid_t pid; /**< 进程号。 */
+    int pidfd; /**< `pidfd_open` 得到的文件描述符，进程结束时可读；内核不支持时为 -1。 */
+    int batch; /**< 是否是批处理，批处理的退出状态决定程序的返回值。 */
+};
+
+/**
+ * @struct proc_pool
+ * @brief 所有工作线程共享的子进程池，执行批处理和结果不被使用的 `-exec ... ;`。
+ *
+ * `max` 为 0 时同步执行：启动子进程后立即等待其结束，与 `find` 的行为相同。
+ * `max` 大于 0 时（`--exec-jobs N`）最多同时运行 `max` 个子进程，遍历在它们运行期间继续进行。
+ * 每次启动前用一次 `poll` 检查所有子进程的 pidfd，回收已经结束的子进程；池满时阻塞在 `poll` 上，
+ * 任意一个子进程结束即可启动新命令。
+ */
+struct proc_pool
+{
+    struct child *children; /**< 正在运行的子进程，按启动顺序排列。 */
+    struct pollfd *fds;     /**< `poll` 使用的数组，与 `children` 一一对应。 */
+    int count;              /**< `children` 中元素的当前数量。 */
+    int max;                /**< 同时运行的子进程数量上限，0 表示同步执行。 */
+    int failed;             /**< 是否有批处理命令启动失败或以非 0 状态退出。 */
+    pthread_mutex_t lock;   /**< 保护以上字段，多个工作线程可能同时启动命令。 */
+};
+
+/**
+ * @struct batch
+ * @brief 一个 `-exec ... {} +` 子句的参数缓冲区。
+ *
+ * `argv` 的前 `fixed` 项是 `{}` 之前的命令和参数，之后是累积的文件路径。
+ * `bytes` 按内核计算方式（字符串长度加结尾的 `'\0'` 加一个指针）统计整个 `argv` 的大小，
+ * 再加入一个路径会超过 `limit` 时先执行当前这一批。
+ */
+struct batch
+{
+    char **argv;  /**< 命令、固定参数和文件路径，执行时以 NULL 结尾。 */
+    size_t argc;  /**< `argv` 中元素的当前数量。 */
+    size_t cap;   /**< `argv` 当前分配的容量。 */
+    size_t fixed; /**< 命令和固定参数的数量，它们由表达式持有，不会被释放。 */
+    size_t bytes; /**< 当前 `argv` 占用的参数字节数。 */
+    size_t limit; /**< 一批参数允许占用的最大字节数。 */
+};
+
+/**
+ * @brief 计算一次 `execve` 可以使用的参数字节预算。
+ *
+ * 结果为 `sysconf(_SC_ARG_MAX)` 减去当前环境变量占用的空间和 `EXEC_HEADROOM`。
+ *
+ * @return 参数字节预算。
+ */
+size_t exec_arg_limit(void);
+
+/**
+ * @brief 创建子进程池。
+ *
+ * @param max 同时运行的子进程数量上限，0 表示同步执行。
+ *
+ * @return 新的子进程池，由 `procs_destroy` 释放。
+ */
+struct proc_pool *procs_create(int max);
+
+/**
+ * @brief 使用 `posix_spawnp` 执行一个命令并等待其结束。
+ *
+ * 启动前刷新标准输出，使之前打印的路径出现在子进程输出之前。
+ *
+ * @param argv 以 NULL 结尾的命令和参数。
+ *
+ * @return 命令正常退出且退出状态为 0 时返回 1，否则（包括无法启动）返回 0。
+ */
+int exec_run(char **argv);
+
+/**
+ * @brief 通过子进程池启动一个命令。
+ *
+ * 同步模式下等待命令结束；否则在池满时先等待任意一个子进程结束，再启动新命令并立即返回。
+ *
+ * @param p 子进程池。
+ * @param argv 以 NULL 结尾的命令和参数，函数返回后即可释放。
+ * @param batch 是否是批处理；批处理失败时 `procs_wait_all` 返回 1，其他命令的退出状态被忽略。
+ */
+void procs_spawn(struct proc_pool *p, char **argv, int batch);
+
+/**
+ * @brief 等待池中所有子进程结束。
+ *
+ * @param p 子进程池。
+ *
+ * @return 如果至今有批处理命令启动失败或以非 0 状态退出，返回 1；否则返回 0。
+ */
+int procs_wait_all(struct proc_pool *p);
+
+/**
+ * @brief 等待所有子进程并释放子进程池。
+ *
+ * @param p 要释放的子进程池，可以为 NULL。
+ */
+void procs_destroy(struct proc_pool *p);
+
+/**
+ * @brief 初始化一个批处理缓冲区。
+ *
+ * @param b 要初始化的缓冲区。
+ * @param args `-exec` 子句的参数，最后一个是 `{}`，以 NULL 结尾。
+ * @param limit 一批参数允许占用的最大字节数，见 `exec_arg_limit`。
+ */
+void batch_init(struct batch *b, char **args, size_t limit);
+
+/**
+ * @brief 判断加入一个路径后是否仍在字节预算之内。
+ *
+ * 缓冲区为空时总是返回 1：单个路径本身就超过预算时仍然单独成批，由 `posix_spawnp` 报告错误。
+ *
+ * @param b 批处理缓冲区。
+ * @param path 文件路径。
+ *
+ * @return 可以加入返回 1；需要先调用 `batch_flush` 返回 0。
+ */
+int batch_fits(struct batch *b, char *path);
+
+/**
+ * @brief 将一个路径加入批处理，调用者应先用 `batch_fits` 检查字节预算。
+ *
+ * @param b 批处理缓冲区。
+ * @param path 文件路径，函数会复制一份。
+ */
+void batch_add(struct batch *b, char *path);
+
+/**
+ * @brief 执行已经累积的路径（如果有），然后清空缓冲区。
+ *
+ * @param b 批处理缓冲区。
+ * @param p 执行命令的子进程池。
+ */
+void batch_flush(struct batch *b, struct proc_pool *p);
+
+/**
+ * @brief 释放批处理缓冲区中的路径和参数数组，不执行命令。
+ *
+ * @param b 要释放的缓冲区。
+ */
+void batch_free(struct batch *b);
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef GLOBMATCH_H
+#define GLOBMATCH_H
+
+#include <stddef.h>
+
+/**
+ * @def GLOB_MAX_STATES
+ * @brief 一个 DFA 最多允许的状态数，超过时退回逐个模式匹配或 `fnmatch`。
+ */
+#define GLOB_MAX_STATES 1024
+
+/**
+ * @enum glob_kind
+ * @brief 编译后的匹配方式。
+ */
+enum glob_kind
+{
+    GLOB_EXACT = 0, /**< 不含通配符：整个名称与字面量相等。 */
+    GLOB_PREFIX,    /**< `foo*`：名称以字面量开头。 */
+    GLOB_SUFFIX,    /**< `*.log`：名称以字面量结尾。 */
+    GLOB_CONTAINS,  /**< `*foo*`：名称包含字面量。 */
+    GLOB_ANY,       /**< `*`：匹配任何名称。 */
+    GLOB_DFA,       /**< 一般的 `*?[]` 模式，编译为 DFA。 */
+    GLOB_FNMATCH    /**< 不支持的语法（如 `[[=a=]]`）或 DFA 过大，退回 `fnmatch`。 */
+};
+
+/**
+ * @enum dfa_flags
+ * @brief DFA 状态的提前结束标记。
+ */
+enum dfa_flags
+{
+    DFA_DEAD = 1, /**< 不可能再匹配。 */
+    DFA_ALL = 2   /**< 之后无论读到什么都匹配（以 `*` 结尾的模式已经匹配完前面的部分）。 */
+};
+
+/**
+ * @struct dfa
+ * @brief 由一个或多个通配符模式编译得到的确定有限自动机。
+ *
+ * 字节先通过 `classes` 映射为等价类，转移表的大小为 `nstates * nclasses`。
+ * 状态 0 是死状态。`flags` 标记死状态和“之后无论读到什么都接受”的状态，匹配时遇到即可提前返回。
+ */
+struct dfa
+{
+    unsigned char classes[256]; /**< 字节到等价类的映射。 */
+    int nclasses;               /**< 等价类数量。 */
+    int nstates;                /**< 状态数量。 */
+    int start;                  /**< 初始状态。 */
+    int *trans;                 /**< 转移表，`trans[s * nclasses + classes[c]]`。 */
+    unsigned char *accept;      /**< 读完名称后停在该状态时是否匹配。 */
+    unsigned char *flags;       /**< `DFA_DEAD`、`DFA_ALL` 或 0。 */
+};
+
+/**
+ * @struct glob
+ * @brief 编译后的单个 `-name` 模式。
+ */
+struct glob
+{
+    enum glob_kind kind; /**< 匹配方式。 */
+    char *lit;           /**< 字面量匹配方式使用的字面量（已去掉转义）。 */
+    size_t len;          /**< `lit` 的长度。 */
+    struct dfa *dfa;     /**< `GLOB_DFA` 使用的自动机。 */
+    char *pattern;       /**< 原始模式，`GLOB_FNMATCH` 使用。 */
+};
+
+/**
+ * @struct globset
+ * @brief 多个用 `-o` 连接的 `-name` 模式，一次扫描名称即可判断是否匹配其中之一。
+ *
+ * 所有模式能够合并为一个 DFA 时使用 `dfa`；否则逐个使用 `globs` 匹配。
+ */
+struct globset
+{
+    struct dfa *dfa;     /**< 合并后的自动机，无法合并时为 NULL。 */
+    struct glob **globs; /**< 各个模式单独编译的结果（`dfa` 为 NULL 时使用）。 */
+    size_t count;        /**< 模式数量。 */
+};
+
+/**
+ * @brief 编译一个通配符模式，语义与 `fnmatch(pattern, name, 0)` 相同。
+ *
+ * 只含字面量且 `*` 只出现在首尾的模式使用 `memcmp`/`memmem` 直接比较；
+ * 其他模式编译为 DFA；无法编译时保留原始模式并在匹配时调用 `fnmatch`。
+ *
+ * @param pattern 通配符模式，函数会复制一份。
+ *
+ * @return 编译结果，由 `glob_free` 释放。
+ */
+struct glob *glob_compile(const char *pattern);
+
+/**
+ * @brief 判断名称是否匹配已编译的模式。
+ *
+ * @param g 编译后的模式。
+ * @param name 文件名（不含路径）。
+ *
+ * @return 匹配返回 1，否则返回 0。
+ */
+int glob_match(struct glob *g, const char *name);
+
+/**
+ * @brief 释放编译后的模式。
+ *
+ * @param g 要释放的模式，可以为 NULL。
+ */
+void glob_free(struct glob *g);
+
+/**
+ * @brief 将多个通配符模式编译为一个集合。
+ *
+ * @param patterns 模式数组。
+ * @param count 模式数量。
+ *
+ * @return 编译结果，由 `globset_free` 释放。
+ */
+struct globset *globset_compile(char **patterns, size_t count);
+
+/**
+ * @brief 判断名称是否匹配集合中的任意一个模式。
+ *
+ * @param s 模式集合。
+ * @param name 文件名（不含路径）。
+ *
+ * @return 匹配返回 1，否则返回 0。
+ */
+int globset_match(struct globset *s, const char *name);
+
+/**
+ * @brief 释放模式集合。
+ *
+ * @param s 要释放的集合，可以为 NULL。
+ */
+void globset_free(struct globset *s);
+
+#endif
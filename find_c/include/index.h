@@ -0,0 +1,279 @@
+#ifndef INDEX_H
+#define INDEX_H
+
+#include "myfind.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @def INDEX_MAGIC
+ * @brief 索引文件开头的 8 字节标识，包含格式版本。
+ */
+#define INDEX_MAGIC "MYFIDX01"
+
+/**
+ * @def INDEX_BLOCK
+ * @brief 每个块最多包含的记录数。
+ */
+#define INDEX_BLOCK 64
+
+/**
+ * @struct index_header
+ * @brief 索引文件头，位于文件开头。
+ *
+ * 索引文件由文件头、若干个块和块偏移表组成。记录按路径排序，比较时 `'/'` 小于其他任何字符，
+ * 因此一个目录的整棵子树紧跟在目录之后，与按名称排序的先序遍历顺序相同。
+ *
+ * 每个块保存最多 `INDEX_BLOCK` 条记录，依次为 `struct index_block`、按列存放的
+ * `size`、`mtime`、`ctime`、`dev`、`ino`（各 `uint64_t`）、`mode`（`uint32_t`）、`depth`（`uint16_t`），
+ * 最后是前缀压缩的路径：每条路径为与上一条路径共享的前缀长度和剩余部分的长度（LEB128 变长整数）
+ * 加上剩余部分的字节，块中第一条路径不共享前缀，因此每个块可以独立解码。
+ * 每一部分都按 8 字节对齐。
+ */
+struct index_header
+{
+    char magic[8];     /**< `INDEX_MAGIC`。 */
+    uint64_t count;    /**< 记录总数。 */
+    uint64_t nblocks;  /**< 块的数量。 */
+    uint64_t table;    /**< 块偏移表（每个块一个 `uint64_t`）在文件中的偏移。 */
+};
+
+/**
+ * @struct index_block
+ * @brief 块的头部。
+ */
+struct index_block
+{
+    uint32_t count; /**< 块中的记录数。 */
+    uint32_t bytes; /**< 前缀压缩的路径占用的字节数（不含对齐）。 */
+};
+
+/**
+ * @struct index_rec
+ * @brief 索引中的一条记录，即建立索引时 `lstat` 得到的一个目录项。
+ */
+struct index_rec
+{
+    char *path;     /**< 完整路径，以 `'\0'` 结尾，在读取下一条记录之前有效。 */
+    size_t len;     /**< `path` 的长度。 */
+    mode_t mode;    /**< `st_mode`。 */
+    int depth;      /**< 相对于建立索引时的查找路径的深度，查找路径本身为 0。 */
+    uint64_t size;  /**< `st_size`。 */
+    int64_t mtime;  /**< `st_mtim`，以纳秒为单位。 */
+    int64_t ctime;  /**< `st_ctim`，以纳秒为单位。 */
+    uint64_t dev;   /**< `st_dev`。 */
+    uint64_t ino;   /**< `st_ino`。 */
+};
+
+/**
+ * @struct index_writer
+ * @brief 按顺序写入记录的索引写入器，记录在内存中凑满一个块后写出。
+ *
+ * 索引先写入 `FILE.tmp`，完成后改名为 `FILE`，因此正在使用的旧索引不会被写了一半的文件替换。
+ */
+struct index_writer
+{
+    FILE *f;                       /**< 临时文件。 */
+    char *path;                    /**< 索引文件的路径。 */
+    char *tmp;                     /**< 临时文件的路径。 */
+    uint64_t off;                  /**< 下一个块在文件中的偏移。 */
+    uint64_t count;                /**< 已写入的记录数。 */
+    uint64_t *table;               /**< 已写出的块的偏移。 */
+    size_t nblocks;                /**< `table` 中元素的当前数量。 */
+    size_t tb_capacity;            /**< `table` 当前分配的容量。 */
+    struct index_rec recs[INDEX_BLOCK]; /**< 当前块中的记录，不含路径。 */
+    size_t n;                      /**< 当前块中的记录数。 */
+    unsigned char *paths;          /**< 当前块前缀压缩后的路径。 */
+    size_t pa_size;                /**< `paths` 中已使用的字节数。 */
+    size_t pa_capacity;            /**< `paths` 当前分配的容量。 */
+    char *prev;                    /**< 上一条路径，用于计算共享的前缀。 */
+    size_t prev_len;               /**< `prev` 的长度。 */
+    size_t prev_capacity;          /**< `prev` 当前分配的容量。 */
+};
+
+/**
+ * @struct index
+ * @brief 以只读方式映射到内存的索引文件。
+ */
+struct index
+{
+    char *map;                        /**< 映射的起始地址。 */
+    size_t size;                      /**< 文件大小。 */
+    const struct index_header *head;  /**< 文件头。 */
+    const uint64_t *table;            /**< 块偏移表。 */
+};
+
+/**
+ * @struct index_cursor
+ * @brief 按顺序读取索引记录的游标，路径解码到游标自己的缓冲区中。
+ */
+struct index_cursor
+{
+    const struct index *ix;        /**< 正在读取的索引。 */
+    uint64_t block;                /**< 当前块的下标。 */
+    uint32_t i;                    /**< 下一条记录在当前块中的下标。 */
+    uint32_t n;                    /**< 当前块中的记录数，未载入块时为 0。 */
+    const struct index_block *blk; /**< 当前块的头部。 */
+    const unsigned char *p;        /**< 下一条路径的编码。 */
+    const unsigned char *end;      /**< 当前块路径编码的结尾。 */
+    int bad;                       /**< 遇到损坏的块时为 1。 */
+    char *path;                    /**< 解码后的路径。 */
+    size_t len;                    /**< `path` 的长度。 */
+    size_t capacity;               /**< `path` 当前分配的容量。 */
+};
+
+/**
+ * @brief 比较两个路径在索引中的顺序，`'/'` 小于其他任何字符。
+ *
+ * @param a 第一个路径。
+ * @param alen `a` 的长度。
+ * @param b 第二个路径。
+ * @param blen `b` 的长度。
+ *
+ * @return `a` 在 `b` 之前返回负数，相同返回 0，之后返回正数。
+ */
+int index_path_cmp(const char *a, size_t alen, const char *b, size_t blen);
+
+/**
+ * @brief 创建索引写入器，打开临时文件并预留文件头。
+ *
+ * @param w 要初始化的写入器。
+ * @param path 索引文件的路径。
+ *
+ * @return 成功返回 0；失败返回 -1 并设置 `errno`。
+ */
+int index_writer_open(struct index_writer *w, char *path);
+
+/**
+ * @brief 追加一条记录，记录必须按 `index_path_cmp` 的顺序追加。
+ *
+ * @param w 写入器。
+ * @param rec 要追加的记录，`path` 被复制。
+ *
+ * @return 成功返回 0；写入失败返回 -1。
+ */
+int index_writer_add(struct index_writer *w, const struct index_rec *rec);
+
+/**
+ * @brief 写出最后一个块、块偏移表和文件头，并将临时文件改名为索引文件。
+ *
+ * @param w 写入器，函数返回后不能再使用。
+ * @param commit 为 0 时删除临时文件而不替换索引文件，用于出错时放弃写入。
+ *
+ * @return 成功返回 0；写入或改名失败返回 -1。
+ */
+int index_writer_close(struct index_writer *w, int commit);
+
+/**
+ * @brief 将记录的元数据从 `struct stat` 中填入。
+ *
+ * @param rec 要填写的记录，`path`、`len` 和 `depth` 不变。
+ * @param sb `lstat` 的结果。
+ */
+void index_rec_stat(struct index_rec *rec, const struct stat *sb);
+
+/**
+ * @brief 以只读方式映射索引文件并检查文件头和块偏移表。
+ *
+ * @param ix 要初始化的索引。
+ * @param path 索引文件的路径。
+ *
+ * @return 成功返回 0；文件无法打开时返回 -1 并设置 `errno`，格式不正确时返回 -1 并将 `errno` 设为 `EINVAL`。
+ */
+int index_open(struct index *ix, char *path);
+
+/**
+ * @brief 解除索引文件的映射。
+ *
+ * @param ix 索引。
+ */
+void index_close(struct index *ix);
+
+/**
+ * @brief 创建游标，定位到给定的块的开头。
+ *
+ * @param c 要初始化的游标。
+ * @param ix 索引。
+ * @param block 开始读取的块的下标。
+ */
+void index_cursor_init(struct index_cursor *c, const struct index *ix, uint64_t block);
+
+/**
+ * @brief 释放游标的路径缓冲区。
+ *
+ * @param c 游标。
+ */
+void index_cursor_free(struct index_cursor *c);
+
+/**
+ * @brief 读取下一条记录。
+ *
+ * @param c 游标。
+ * @param rec 用于保存记录的结构体，`path` 指向游标的缓冲区。
+ *
+ * @return 读到记录返回 1；已经读完或记录损坏时返回 0，损坏时 `c->bad` 为 1。
+ */
+int index_next(struct index_cursor *c, struct index_rec *rec);
+
+/**
+ * @brief 查找可能包含给定路径的第一个块，即第一条路径不在 `path` 之后的最后一个块。
+ *
+ * 每个块的第一条路径不共享前缀，因此可以直接在块偏移表上二分查找。
+ *
+ * @param ix 索引。
+ * @param path 要查找的路径。
+ * @param len `path` 的长度。
+ *
+ * @return 块的下标。
+ */
+uint64_t index_seek(const struct index *ix, const char *path, size_t len);
+
+/**
+ * @brief `--build-index`：遍历查找路径，将每个目录项的 `lstat` 结果写入索引文件。
+ *
+ * 每个目录的目录项按名称排序后依次写入，遇到子目录时递归进入，因此记录按 `index_path_cmp` 的顺序生成，
+ * 不需要在内存中保存整个索引。查找路径按相同的顺序排序，包含在其他查找路径中的会被跳过。
+ * 与 `-P` 相同，遍历时不跟随符号链接；`-H` 和 `-L` 只影响查找路径本身。
+ *
+ * @param d 指向 `struct data` 的指针，包含查找路径和选项。
+ * @param path 索引文件的路径。
+ *
+ * @return 成功返回 0；写入失败返回 1。无法访问的目录项输出错误信息并设置 `d->return_value`，但不影响其余部分。
+ */
+int index_build(struct data *d, char *path);
+
+/**
+ * @brief `--refresh-index`：按照文件系统的当前状态更新索引，只读取名称发生变化的目录。
+ *
+ * 旧索引中深度为 0 的记录就是建立索引时的查找路径。对每个目录调用 `fstatat`，
+ * 如果 `st_mtime` 和 `st_ctime` 都与旧记录相同，说明其中没有创建、删除或改名的目录项，
+ * 不读取目录，直接复制旧索引中该目录的记录，只检查其中的子目录；否则读出目录中的名称，
+ * 与旧索引中的名称合并：新名称调用 `fstatat` 写入记录，删除的名称连同子树一起去掉。
+ * 新索引与旧索引按相同的顺序生成，同样写入 `FILE.tmp` 后替换旧索引。
+ *
+ * 没有变化的目录中文件的 `size`、`mtime` 等元数据沿用旧索引，修改文件内容不会更新这些列。
+ *
+ * @param d 指向 `struct data` 的指针。
+ * @param path 索引文件的路径。
+ *
+ * @return 成功返回 0；旧索引无法打开或损坏、写入失败时返回 1，此时旧索引保持不变。
+ */
+int index_refresh(struct data *d, char *path);
+
+/**
+ * @brief `--use-index`：对索引中的记录执行 `d->prog`，代替遍历文件系统。
+ *
+ * 记录中保存了完整的 `lstat` 结果，因此 `-name`、`-type`、`-perm` 不需要任何 `stat` 调用。
+ * 给出查找路径时只对该路径及其子树中的记录求值，深度相对于该路径计算；否则对所有记录求值。
+ * `-prune` 和 `-maxdepth` 跳过子树中的记录，`-d` 在子树的记录之后对目录求值。
+ * 输出顺序是索引的顺序，即按名称排序的遍历顺序。
+ *
+ * @param d 指向 `struct data` 的指针，表达式已经编译。
+ * @param path 索引文件的路径。
+ *
+ * @return 成功返回 0；索引无法打开或损坏时返回 1。
+ */
+int index_query(struct data *d, char *path);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef INODE_SET_H
+#define INODE_SET_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * @struct inode_key
+ * @brief 哈希集合中的一个槽位，由设备号和 inode 编号唯一标识一个目录。
+ */
+struct inode_key
+{
+    dev_t dev; /**< 目录所在的设备号。 */
+    ino_t ino; /**< 目录的 inode 编号。 */
+    int used;  /**< 槽位是否被占用。 */
+};
+
+/**
+ * @struct inode_set
+ * @brief 以 `(st_dev, st_ino)` 为键的开放寻址哈希集合（线性探测）。
+ *
+ * 删除时使用后移法（backward shift）填补空位，不需要墓碑标记，
+ * 因此频繁的插入和删除（例如只记录当前祖先链）不会使探测序列变长。
+ */
+struct inode_set
+{
+    struct inode_key *slots; /**< 槽位数组。 */
+    size_t size;             /**< 集合中元素的当前数量。 */
+    size_t capacity;         /**< 槽位数量，始终为 2 的幂。 */
+};
+
+/**
+ * @brief 初始化一个空集合。
+ *
+ * @param s 要初始化的集合。
+ */
+void iset_init(struct inode_set *s);
+
+/**
+ * @brief 释放集合占用的内存。
+ *
+ * @param s 要释放的集合。
+ */
+void iset_free(struct inode_set *s);
+
+/**
+ * @brief 将 `(dev, ino)` 加入集合，负载超过 3/4 时容量翻倍。
+ *
+ * @param s 集合。
+ * @param dev 设备号。
+ * @param ino inode 编号。
+ *
+ * @return 如果插入成功，返回 1；如果元素已经存在，返回 0。
+ */
+int iset_insert(struct inode_set *s, dev_t dev, ino_t ino);
+
+/**
+ * @brief 检查 `(dev, ino)` 是否在集合中。
+ *
+ * @param s 集合。
+ * @param dev 设备号。
+ * @param ino inode 编号。
+ *
+ * @return 如果存在，返回 1；否则返回 0。
+ */
+int iset_contains(struct inode_set *s, dev_t dev, ino_t ino);
+
+/**
+ * @brief 从集合中删除 `(dev, ino)`，元素不存在时什么也不做。
+ *
+ * @param s 集合。
+ * @param dev 设备号。
+ * @param ino inode 编号。
+ */
+void iset_remove(struct inode_set *s, dev_t dev, ino_t ino);
+
+#endif
@@ -1,9 +1,42 @@
 #include <unistd.h>
 
+/**
+ * @struct str_impl
+ * @brief 字符串函数的一组实现。
+ *
+ * 提供逐字节、SSE2 和 AVX2 三组实现，程序启动时按 CPU 支持的指令集选择最快的一组。
+ * 向量实现按对齐的块读取，不会越过字符串所在的页；语义与逐字节实现完全相同。
+ */
+struct str_impl
+{
+    const char *name;                  /**< 实现的名称：`"scalar"`、`"sse2"` 或 `"avx2"`。 */
+    size_t (*len)(char *str);          /**< `my_strlen`，`str` 不为 NULL。 */
+    int (*cmp)(char *s1, char *s2);    /**< `my_strcmp`，参数不为 NULL。 */
+    char *(*rchr)(char *str, char ch); /**< `my_strrchr`，`ch` 不为 `'\0'`。 */
+};
+
+/**
+ * @brief 获取第 `i` 组实现，供基准测试逐一比较。
+ *
+ * @param i 实现的序号，从 0（逐字节实现）开始。
+ *
+ * @return 对应的实现；序号越界或当前 CPU 不支持时返回 NULL。
+ */
+const struct str_impl *my_str_impl(size_t i);
+
+/**
+ * @brief 切换字符串函数使用的实现。不是线程安全的，只应在启动线程之前调用。
+ *
+ * @param impl `my_str_impl` 返回的实现。
+ *
+ * @return 之前使用的实现。
+ */
+const struct str_impl *my_str_use(const struct str_impl *impl);
+
 /**
  * @brief 计算字符串的长度
  *
- * 此函数用于计算给定字符串 `str` 的长度，不包括空字符（`\0`）。该函数通过遍历字符串中的每个字符，直到遇到空字符为止，返回字符串的字符数。
+ * 此函数用于计算给定字符串 `str` 的长度，不包括空字符（`\0`）。支持 SSE2/AVX2 时每次检查对齐的 64 个字节。
  * 
  * @param str 指向一个以空字符结尾的字符串的指针。
  * 
@@ -14,7 +47,7 @@ size_t my_strlen(char *str);
 /**
  * @brief 比较两个字符串是否相等
  *
- * 此函数通过逐个字符地比较两个字符串 `str1` 和 `str2` 是否相等。如果两个字符串的长度不相等，直接返回 1，表示不相等。如果长度相同，则逐字符比较，遇到不同字符时返回 1，表示不相等。如果所有字符都相同，则返回 0，表示两个字符串相等。
+ * 此函数同时扫描两个字符串 `str1` 和 `str2`，遇到第一个不同的字符或结束符时停止，不需要先计算长度。NULL 与空字符串相等。
  * 
  * @param str1 第一个字符串。
  * @param str2 第二个字符串。
@@ -23,4 +23,25 @@ int my_stroi(char *str, size_t i);
  * 
  * @return 返回 `n` 转换为十进制后的整数。
  */
-int octal_to_dec(int n);
\ No newline at end of file
+int octal_to_dec(int n);
+
+/**
+ * @brief 将表示字节数的字符串转换为整数。
+ *
+ * 字符串由十进制数字和可选的单位后缀组成，后缀 `K`、`M`、`G`（不区分大小写）分别表示 2^10、2^20、2^30，
+ * 例如 "4M" 表示 4194304。
+ *
+ * @param str 输入的字符串。
+ *
+ * @return 返回转换后的字节数；字符串格式无效时返回 0。
+ */
+size_t parse_size(char *str);
+
+/**
+ * @brief 判断字符串是否是一个非负十进制整数，例如 `-maxdepth` 的参数。
+ *
+ * @param str 输入的字符串。
+ *
+ * @return 字符串非空且只由数字组成时返回 1，否则返回 0。
+ */
+int is_number(char *str);
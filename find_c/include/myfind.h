@@ -1,22 +1,62 @@
 #ifndef DEFINE_H
 #define DEFINE_H
 
+#include <stdint.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "arena.h"
+#include "content.h"
+#include "inode_set.h"
+
+struct dupes;
+struct walk;
+struct task;
+struct uring;
+struct dir_reader;
+struct program;
+struct glob;
+struct batch;
+struct proc_pool;
+struct out_buf;
+struct watch;
+
+/**
+ * @enum node_flags
+ * @brief 表示 `struct node` 中哪些类型信息已经获取。
+ *
+ * 节点的类型信息按需获取：优先使用 `readdir` 返回的 `d_type`，只有谓词确实需要时才调用 `fstatat`。
+ */
+enum node_flags
+{
+    NODE_FTYPE = 1, /**< `type` 中的文件类型位（`S_IFMT`）有效，可能来自 `d_type`。 */
+    NODE_LSTAT = 2, /**< `type` 保存完整的 `lstat` 结果。 */
+    NODE_STAT = 4,  /**< `r_type` 保存完整的 `stat` 结果。 */
+    NODE_PRUNE = 8, /**< 求值时执行了 `-prune`，不进入该目录。 */
+    NODE_ATTR = 16, /**< `size`、`mtime`、`dev` 和 `ino` 有效（`-L` 时跟随符号链接）。 */
+    NODE_NOATTR = 32 /**< 获取 `size` 和 `mtime` 的 `statx` 失败，依赖它们的谓词为假。 */
+};
+
 /**
  * @struct node
  * @brief 描述文件系统中的一个节点信息。
  *
  * 该结构体表示文件系统中的一个节点（如文件、目录或符号链接）及其相关属性。
+ * `type` 和 `r_type` 是延迟获取的，应通过 `node_ftype`、`node_type` 和 `node_r_type` 读取。
  */
 struct node
 {
     char *name;    /**< 节点的完整路径名，包括路径和文件名。 */
     char *name_wp; /**< 节点的文件名，不含路径部分（name without path）。 */
-    mode_t type;   /**< 节点的链接类型，来自 `lstat` 系统调用的结果。 */
+    mode_t type;   /**< 节点的链接类型，来自 `d_type` 或 `lstat` 系统调用的结果。 */
     mode_t r_type; /**< 节点的实际类型，来自 `stat` 系统调用的结果。 */
+    int dirfd;     /**< 父目录的文件描述符，`fstatat` 相对于它解析 `name_wp`；为 `AT_FDCWD` 时使用 `name`。 */
+    int flags;     /**< `enum node_flags` 的组合，表示哪些类型信息已经获取。 */
+    uint64_t size; /**< `st_size`，延迟获取，应通过 `node_attr` 读取。 */
+    int64_t mtime; /**< `st_mtim`，以纳秒为单位，延迟获取，应通过 `node_attr` 读取。 */
+    uint64_t dev;  /**< `st_dev`，与 `size` 一起获取。 */
+    uint64_t ino;  /**< `st_ino`，与 `size` 一起获取。 */
 };
 
 /**
@@ -40,6 +80,50 @@ enum enum_type
     FAPA       /**< 表示因式分解括号（factorized parenthesis）。 */
 };
 
+/**
+ * @enum pred_kind
+ * @brief 条件谓词的种类，在 `create_c_list` 中解析一次，求值时不再比较谓词名称。
+ */
+enum pred_kind
+{
+    PRED_NONE = 0, /**< 不是条件谓词。 */
+    PRED_NAME,     /**< `-name PATTERN` */
+    PRED_TYPE,     /**< `-type C` */
+    PRED_PERM,     /**< `-perm MODE` */
+    PRED_PRUNE,    /**< `-prune`：总是为真，先序遍历时不进入该目录。 */
+    PRED_TRUE,     /**< `-maxdepth N`、`-mindepth N`：只影响遍历范围，求值时总是为真。 */
+    PRED_QUIT,     /**< `-quit`：立即结束遍历，是一个动作。 */
+    PRED_LIMIT,    /**< `-limit N`：前 `N` 次求值为真，第 `N` 次之后结束遍历。 */
+    PRED_SIZE,     /**< `-size [+-]N[bcwkMG]` */
+    PRED_MTIME,    /**< `-mtime [+-]N`、`-mmin [+-]N` */
+    PRED_NEWER,    /**< `-newer FILE` */
+    PRED_EMPTY,    /**< `-empty`：空的普通文件或目录。 */
+    PRED_CONTAINS  /**< `-contains STRING`、`-contains-regex REGEX` */
+};
+
+/**
+ * @struct predicate
+ * @brief 预先解析好的条件谓词参数。
+ */
+struct predicate
+{
+    enum pred_kind kind; /**< 谓词种类。 */
+    char *pattern;       /**< `-name` 的通配符，指向表达式中的参数。 */
+    struct glob *glob;   /**< `-name` 编译后的匹配器。 */
+    unsigned int types;  /**< `-type` 接受的文件类型位图，第 `(mode & S_IFMT) >> 12` 位表示一种类型；无效参数为 0。 */
+    int perm;            /**< `-perm` 要求的权限位（`0777` 以内）；参数不是三位数字时为 -1，永远不匹配。 */
+    size_t limit;        /**< `-limit` 允许为真的次数。 */
+    size_t hits;         /**< `-limit` 已经求值的次数，所有线程共享，原子更新。 */
+    int cmp;             /**< `-size`、`-mtime`、`-mmin` 的比较方式：`+N` 为 1，`-N` 为 -1，`N` 为 0。 */
+    int64_t num;         /**< `-size`、`-mtime`、`-mmin` 的 `N`。 */
+    int64_t unit;        /**< `-size` 的单位字节数，或 `-mtime`（一天）、`-mmin`（一分钟）的纳秒数。 */
+    int64_t ref;         /**< `-newer` 参考文件的 `mtime`，或 `-mtime`、`-mmin` 解析表达式时的当前时间，以纳秒为单位。 */
+    unsigned int mask;   /**< 表达式中所有属性谓词需要的 `statx` 字段的并集，第一次获取属性时一起请求。 */
+    int follow;          /**< `-L` 时为 1：属性取自符号链接指向的文件。 */
+    int exact;           /**< `-mmin` 为 1：与 find 一致，按精确的时间差比较；`-mtime` 比较向下取整的天数。 */
+    struct content_pattern content; /**< `-contains`、`-contains-regex` 的模式。 */
+};
+
 /**
  * @struct compound
  * @brief 表示一个复合命令或逻辑单元的数据结构。
@@ -52,6 +136,8 @@ struct compound
     char **args;            /**< 命令的参数数组，以 NULL 结尾。 */
     struct compound **fapa; /**< 指向复合命令数组的指针，适用于 `et == FAPA` 的情况。 */
     enum enum_type et;      /**< 枚举值，表示该复合命令的逻辑类型（如 OR、AND 等）。 */
+    struct predicate pred;  /**< `et == CONDITION` 时预先解析好的谓词。 */
+    size_t batch;           /**< `et == EXECP` 时该子句在 `data.batches` 中的下标。 */
 };
 
 /**
@@ -66,10 +152,6 @@ struct ast
     struct ast *left;         /**< 指向左子节点的指针，表示树的左侧操作或表达式。 */
     struct ast *right;        /**< 指向右子节点的指针，表示树的右侧操作或表达式。 */
     enum enum_type et;        /**< 当前节点的操作类型，表示该节点的操作（如 AND、OR、THEN 等）。 */
-    int rvalue[2];            /**< `rvalue` 数组，存储左右子节点的返回值：
-                               * - `rvalue[0]`: 左子节点的返回值。
-                               * - `rvalue[1]`: 右子节点的返回值。
-                               */
     struct compound **c_list; /**< 指向复合命令列表的指针数组。 */
     size_t cl_size;           /**< `c_list` 的大小，表示命令列表的元素数量。 */
 };
@@ -99,33 +181,66 @@ struct data
     size_t el_size;     /**< `e_list` 中元素的当前数量。 */
     size_t el_capacity; /**< `e_list` 当前分配的容量，表示最多能容纳多少表达式。 */
 
-    // 节点列表
-    struct node **nodes; /**< 存储节点列表，表示各个文件、目录或符号链接。 */
-    size_t no_size;      /**< `nodes` 中元素的当前数量。 */
-    size_t no_capacity;  /**< `nodes` 当前分配的容量，表示最多能容纳多少节点。 */
-
-    // 存储已访问目录的 inode 列表，避免无限循环
-    int *inode_list;    /**< 存储已访问目录的 inode 列表，用于避免无限循环遍历。 */
-    size_t il_size;     /**< `inode_list` 中元素的当前数量。 */
-    size_t il_capacity; /**< `inode_list` 当前分配的容量，表示最多能容纳多少 inode。 */
+    // 当前祖先链上目录的 (st_dev, st_ino) 集合，`-L` 模式下用于检测循环
+    struct inode_set ancestors; /**< 正在遍历的目录及其所有祖先目录，离开目录时删除。 */
 
     // 存储复合命令列表（如因式分解的表达式）
     struct compound **c_list; /**< 存储复合命令的表达式列表，在构建 AST 前使用。 */
     size_t cl_size;           /**< `c_list` 中元素的当前数量。 */
     size_t cl_capacity;       /**< `c_list` 当前分配的容量，表示最多能容纳多少复合命令。 */
 
-    // 存储需要批处理执行的文件(-exec [command] {} +)
-    char *batch_command;      /**< 批处理文件的命令 */
-    char **batch_file_list;   /**< 存储需要批处理执行的文件，用于-exec [command] {} + */
-    size_t bfl_size;          /**< `batch_file_list` 中元素的当前数量。 */
-    size_t bfl_capacity;      /**< `batch_file_list` 当前分配的容量，表示最多能容纳多少批处理执行的文件。 */
-
+    // 需要批处理执行的文件(-exec [command] {} +)，每个子句一个缓冲区
+    struct batch *batches;   /**< 每个 `-exec ... +` 子句的参数缓冲区，每个工作线程各有一份。 */
+    size_t nbatches;         /**< 表达式中 `-exec ... +` 子句的数量。 */
+    struct proc_pool *procs; /**< 执行 `-exec` 的子进程池，所有工作线程共享；没有 `-exec` 时为 NULL。 */
+    int exec_jobs;           /**< `--exec-jobs` 指定的同时运行的子进程数量，0 表示同步执行。 */
 
     // 抽象语法树（AST）
-    struct ast *ast; /**< 存储抽象语法树，用于表示命令或表达式的树状结构。 */
+    struct ast *ast;      /**< 存储抽象语法树，用于表示命令或表达式的树状结构。 */
+    struct program *prog; /**< 由 AST 编译得到的字节码程序，对每个节点求值时执行。 */
 
     // 动作标记
     int actions; /**< 如果 AST 中包含动作（如执行），则为 1；否则为 0。 */
+
+    // 表达式优化
+    int opt_level; /**< `-O` 指定的优化级别，见 `optimize_ast`；默认为 `OPT_LEVEL_DEFAULT`。 */
+    int debug_opt; /**< `-D opt` 时为 1：编译前将优化前后的 AST 输出到标准错误。 */
+
+    // 并行遍历
+    int jobs;          /**< `-j` 指定的遍历线程数，1 表示单线程遍历。 */
+    int ordered;       /**< 如果开启 `--ordered`，并行遍历时按单线程遍历的顺序输出，则为 1；否则为 0。 */
+    struct walk *walk; /**< 当前的并行遍历，单线程遍历时为 NULL。 */
+
+    // 遍历深度
+    int depth;    /**< 正在求值的节点的深度，查找路径本身为 0。 */
+    int mindepth; /**< `-mindepth` 指定的最小深度，更浅的节点不求值，默认为 0。 */
+    int maxdepth; /**< `-maxdepth` 指定的最大深度，不进入更深的目录，-1 表示不限制。 */
+
+    // 目录读取
+    size_t dirbuf; /**< `--dirbuf` 指定的 `getdents64` 缓冲区最大字节数，0 表示使用 `readdir`。 */
+
+    // 异步 statx
+    int use_uring;       /**< 如果开启 `--uring`，则为 1；否则为 0。 */
+    struct uring *uring; /**< 当前线程的 io_uring 实例，未开启或内核不支持时为 NULL。 */
+    int need_mode;       /**< 如果表达式需要完整的文件模式（如 `-perm`），则为 1；否则为 0。 */
+    unsigned int attr_mask; /**< 表达式中属性谓词（如 `-size`、`-mtime`）需要的 `statx` 字段，为 0 时不需要。 */
+    int skip_binary;        /**< 开启 `--skip-binary` 时为 1：`-contains` 不匹配开头含有 `'\0'` 的文件。 */
+    struct task *task; /**< 当前正在处理的目录任务，用于有序输出，单线程遍历时为 NULL。 */
+
+    // 输出
+    struct out_buf *out; /**< 标准输出缓冲区，每个工作线程各有一个。 */
+
+    // 路径
+    struct arena arena; /**< 拼接目录项路径的竞技场，每个工作线程各有一个。 */
+    // 索引
+    char *index_build; /**< `--build-index` 指定的索引文件，为 NULL 时不建立索引。 */
+    char *index_use;   /**< `--use-index` 指定的索引文件，为 NULL 时遍历文件系统。 */
+    char *index_refresh; /**< `--refresh-index` 指定的索引文件，为 NULL 时不刷新索引。 */
+    // 监视
+    struct watch *watch; /**< `--watch` 的 inotify 监视表，未开启时为 NULL。 */
+    struct dupes *dupes; /**< `--dupes` 收集的候选文件，所有线程共享；未开启时为 NULL。 */
+    // 统计
+    int show_stats; /**< `--stats` 时为 1，`--stats=json` 时为 2，退出时将统计结果输出到标准错误；否则为 0。 */
 };
 
 /**
@@ -148,35 +263,75 @@ void init_data(struct data *d);
  * - 如果选项为 `-d`，将 `d->d_checked` 设置为 `1`。
  * - 如果选项为 `-P`、`-H` 或 `-L`，将 `d->option` 设置为不同的值。
  * - -H、-L 和 -P 同时指定，最后一个指定的选项生效。
+ * - 如果选项为 `-j N` 或 `-jN`，将 `d->jobs` 设置为 `N`。
+ * - 如果选项为 `--ordered`，将 `d->ordered` 设置为 `1`。
+ * - 如果选项为 `--uring`，将 `d->use_uring` 设置为 `1`。
+ * - 如果选项为 `--dirbuf SIZE` 或 `--dirbuf=SIZE`，将 `d->dirbuf` 设置为 `SIZE` 字节（支持 K、M、G 后缀）。
+ * - 如果选项为 `--exec-jobs N` 或 `--exec-jobs=N`，将 `d->exec_jobs` 设置为 `N`。
+ * - 如果选项为 `--build-index FILE` 或 `--build-index=FILE`，将 `d->index_build` 设置为 `FILE`。
+ * - 如果选项为 `--use-index FILE` 或 `--use-index=FILE`，将 `d->index_use` 设置为 `FILE`。
+ * - 如果选项为 `--refresh-index FILE` 或 `--refresh-index=FILE`，将 `d->index_refresh` 设置为 `FILE`。
+ * - 如果选项为 `--watch`，创建 inotify 实例 `d->watch`。
+ * - 如果选项为 `--stats` 或 `--stats=json`，将 `d->show_stats` 设置为 `1` 或 `2`。
+ * - 如果选项为 `-ON`（`N` 为一位数字），将 `d->opt_level` 设置为 `N`。
+ * - 如果选项为 `-D opt`，将 `d->debug_opt` 设置为 `1`；`-D` 的其他参数输出错误信息并退出。
  * @param d 要更新的 `struct data` 结构体。
  * @param opt 传入的选项字符串。
+ * @param arg 选项之后的下一个命令行参数，不存在时为 NULL。
  *
- * @return 如果选项匹配并成功更新字段，返回 `1`；否则返回 `0`，表示没有匹配的选项。
+ * @return 返回该选项消耗的命令行参数个数（`1` 或 `2`）；返回 `0` 表示没有匹配的选项。
  */
-int update_option(struct data *d, char *opt);
+int update_option(struct data *d, char *opt, char *arg);
 
 /**
  * @brief 生成节点并递归解析目录
  *
  * 该函数遍历 `search_path_list` 中的所有文件或目录，并根据文件信息生成节点。如果文件是符号链接，
  * 会获取符号链接和目标文件的状态信息。如果文件是目录并且符号链接没有循环或符合特定选项，
- * 则递归调用 `parse_dir` 来遍历子目录。对于每个文件或目录，都会调用 `add_node` 来将其信息
- * 添加到数据结构中。函数还会确保不重复解析相同的 inode。
+ * 则递归调用 `parse_dir` 来遍历子目录。对于每个文件或目录，都会调用 `eval_node` 对其求值，
+ * 节点不会被保留，因此内存占用只与目录深度有关。
  *
  * @param d 指向 `struct data` 的指针，包含 `search_path_list` 数组和相关容量信息。
  */
 void generate_nodes(struct data *d);
 
 /**
- * @brief 处理未到达批处理临界的最后一批次数据
+ * @brief 处理未到达批处理临界的最后一批次数据，并等待所有批处理结束
  *
  * @param d 指向 `struct data` 的指针。
- * 
- * @return 如果成功，返回 0；如果出现错误（例如无效的语法），返回 1。
-
+ *
+ * @return 如果所有批处理命令都以 0 状态退出，返回 0；否则返回 1。
  */
 int deal_batch_remaining(struct data *d);
 
+/**
+ * @brief 为表达式中每个 `-exec ... +` 子句创建参数缓冲区。
+ *
+ * 参数的字节预算由 `exec_arg_limit` 决定。并行遍历时每个工作线程调用一次，得到自己的缓冲区。
+ *
+ * @param d 指向 `struct data` 的指针，`c_list` 和 `nbatches` 已经填好。
+ */
+void init_batches(struct data *d);
+
+/**
+ * @brief 释放 `init_batches` 创建的缓冲区，不执行其中剩余的文件。
+ *
+ * @param d 指向 `struct data` 的指针。
+ */
+void free_batches(struct data *d);
+
+/**
+ * @brief 将 `exp_list` 中的表达式解析为可执行的形式。
+ *
+ * 依次调用 `create_c_list`、`build_ast` 和 `is_ast_valid`，出错时输出错误信息并设置 `d->return_value`。
+ * 无论成功与否，`c_list` 都交由 `d->ast` 管理，调用者只需调用 `free_data`。
+ *
+ * @param d 指向 `struct data` 的指针，`exp_list` 已经填好。
+ *
+ * @return 如果成功，返回 0；如果表达式有误，返回 1。
+ */
+int compile_expression(struct data *d);
+
 /**
  * @brief 遍历表达式列表（e_list），并根据每个表达式的类型创建相应的复合表达式，将其添加到复合表达式列表（c_list）中。
  *
@@ -205,20 +360,185 @@ int create_c_list(struct data *d);
 void build_ast(struct ast *ast);
 
 /**
- * @brief 执行抽象语法树（AST）中的操作。
+ * @brief 解析条件谓词的名称和参数，填写 `c->pred`。
+ *
+ * `-name` 的通配符被编译为匹配器（见 `glob_compile`），`-type` 的字母被转换为文件类型位图，
+ * `-perm` 的三位八进制数被转换为权限位，因此求值时不需要再解析参数。
+ *
+ * @param c `et == CONDITION` 的复合命令，`args[0]` 为谓词参数。
+ */
+void parse_predicate(struct compound *c);
+
+/**
+ * @brief 解析属性谓词 `-size`、`-mtime`、`-mmin`、`-newer`、`-empty` 的参数，填写 `c->pred`。
+ *
+ * `-mtime` 和 `-mmin` 以解析时的当前时间为准；`-newer` 在解析时获取参考文件的修改时间（`-H`、`-L` 时跟随符号链接），
+ * 求值时只比较时间。`-size` 的单位与 `find` 相同：默认为 512 字节的块，`c`、`w`、`k`、`M`、`G` 分别为
+ * 1、2、1024、1024²、1024³ 字节，文件大小按单位向上取整后比较。
+ *
+ * @param d 指向 `struct data` 的指针，包含符号链接选项。
+ * @param c `et == CONDITION` 的复合命令，`-empty` 以外的谓词 `args[0]` 为参数。
+ *
+ * @return 成功返回 0；参数无效或参考文件不存在时输出错误信息并返回 1。
+ */
+int parse_attr_predicate(struct data *d, struct compound *c);
+
+/**
+ * @brief `-name` 谓词：文件名（不含路径）是否匹配通配符。
+ *
+ * @param c 谓词对应的复合命令。
+ * @param n 当前节点。
+ *
+ * @return 匹配返回 1，否则返回 0。
+ */
+int match_name(struct compound *c, struct node *n);
+
+/**
+ * @brief `-type` 谓词：文件类型是否在预先解析的类型位图中（`b`、`c`、`d`、`f`、`l`、`p`、`s`）。
+ *
+ * @param c 谓词对应的复合命令。
+ * @param n 当前节点。
+ *
+ * @return 匹配返回 1，否则返回 0。
+ */
+int match_type(struct compound *c, struct node *n);
+
+/**
+ * @brief `-perm` 谓词：权限位是否与预先解析的三位八进制数完全相等。
+ *
+ * @param c 谓词对应的复合命令。
+ * @param n 当前节点。
+ *
+ * @return 匹配返回 1，否则返回 0。
+ */
+int match_perm(struct compound *c, struct node *n);
+
+/**
+ * @brief `-size` 谓词：按单位向上取整后的文件大小与 `N` 比较。
+ *
+ * @param c 谓词对应的复合命令。
+ * @param n 当前节点。
+ *
+ * @return 匹配返回 1，否则返回 0。
+ */
+int match_size(struct compound *c, struct node *n);
+
+/**
+ * @brief `-mtime`、`-mmin` 谓词：距上次修改经过的时间与 `N` 比较。
+ *
+ * `-mtime` 比较向下取整的天数；`-mmin` 与 `find` 一致按精确的时间差比较，`-mmin N` 表示 `(N-1, N]` 分钟之前。
+ *
+ * @param c 谓词对应的复合命令。
+ * @param n 当前节点。
+ *
+ * @return 匹配返回 1，否则返回 0。
+ */
+int match_mtime(struct compound *c, struct node *n);
+
+/**
+ * @brief `-newer` 谓词：修改时间是否晚于参考文件。
+ *
+ * @param c 谓词对应的复合命令。
+ * @param n 当前节点。
+ *
+ * @return 匹配返回 1，否则返回 0。
+ */
+int match_newer(struct compound *c, struct node *n);
+
+/**
+ * @brief `-empty` 谓词：大小为 0 的普通文件，或者除 `.` 和 `..` 之外没有目录项的目录。
+ *
+ * @param c 谓词对应的复合命令。
+ * @param n 当前节点。
+ *
+ * @return 匹配返回 1，否则返回 0。
+ */
+int match_empty(struct compound *c, struct node *n);
+
+/**
+ * @brief 解析 `-contains STRING` 或 `-contains-regex REGEX` 的参数，填写 `c->pred`；正则表达式在这里编译一次。
+ *
+ * @param d 指向 `struct data` 的指针，包含符号链接选项和 `--skip-binary`。
+ * @param c `et == CONDITION` 的复合命令，`args[0]` 为参数。
+ *
+ * @return 成功返回 0；正则表达式无效时输出错误信息并返回 1。
+ */
+int parse_contains_predicate(struct data *d, struct compound *c);
+
+/**
+ * @brief `-contains`、`-contains-regex` 谓词：普通文件（`-L` 时跟随符号链接）的内容是否包含字符串或有一行匹配正则表达式。
+ *
+ * 在进程内读取文件并在第一处匹配时停止，不需要为每批文件启动 `grep`；并行遍历时每个工作线程独立读取。
+ * 其他类型的文件和无法读取的文件为假。
+ *
+ * @param c 谓词对应的复合命令。
+ * @param n 当前节点。
+ *
+ * @return 匹配返回 1，否则返回 0。
+ */
+int match_contains(struct compound *c, struct node *n);
+
+/**
+ * @brief `-limit N` 谓词：计数加一，前 `N` 次为真；第 `N` 次时请求结束遍历。
+ *
+ * 计数在所有线程之间共享，因此并行遍历时也恰好有 `N` 个节点使其为真。
+ *
+ * @param c 谓词对应的复合命令。
+ *
+ * @return 计数不超过 `N` 时返回 1，否则返回 0。
+ */
+int match_limit(struct compound *c);
+
+/**
+ * @brief 请求结束遍历（`-quit`、`-limit`），所有线程共享同一个标志。
  *
- * 该函数根据 AST 节点的类型（如 THEN、AND、OR、PRINT、CONDITION、EXECP 和 EXEC 执行不同的操作，
- * 处理节点的条件判断、命令执行等。
+ * 之后不再对任何节点求值，也不再打开新的目录；各个遍历循环在读取下一个目录项之前检查该标志，
+ * 并行遍历的工作线程直接完成剩余的任务而不读取目录。已经缓冲的输出和 `-exec ... +` 的参数
+ * 照常由 `deal_batch_remaining` 和 `out_flush` 处理，正在运行的子进程也会被等待。
+ */
+void request_quit(void);
+
+/**
+ * @brief 查询是否已经请求结束遍历。
  *
- * @param d 指向 `data` 结构体的指针
- * @param parent 父节点指针，用于更新父节点的返回值。
- * @param ast 当前执行的节点（AST）指针。
- * @param n 当前处理的节点信息（如文件名、类型等）。
- * @param child 当前节点是父节点的左子节点（child = 0）还是右子节点（child = 1）。
+ * @return 已经请求时返回 1，否则返回 0。
+ */
+int quit_requested(void);
+
+/**
+ * @brief 执行 `-exec ... ;`，将参数中的 `{}` 替换为节点路径后用 `posix_spawnp` 创建子进程并等待其结束。
  *
- * @return 返回执行结果，表示是否成功执行某个操作。
+ * @param d 指向 `struct data` 的指针。
+ * @param c 动作对应的复合命令。
+ * @param n 当前节点。
+ *
+ * @return 子进程正常退出且退出状态为 0 时返回 1，否则返回 0。
  */
-int exec_ast(struct data *d, struct ast *parent, struct ast *ast, struct node *n, int child);
+int exec_command(struct data *d, struct compound *c, struct node *n);
+
+/**
+ * @brief 执行结果不被使用的 `-exec ... ;`，通过子进程池启动命令。
+ *
+ * 开启 `--exec-jobs N` 时不等待命令结束，最多同时运行 `N` 个子进程；否则与 `exec_command` 一样同步执行。
+ *
+ * @param d 指向 `struct data` 的指针，包含子进程池。
+ * @param c 动作对应的复合命令。
+ * @param n 当前节点。
+ *
+ * @return 总是返回 1。
+ */
+int exec_spawn(struct data *d, struct compound *c, struct node *n);
+
+/**
+ * @brief 执行 `-exec ... +`，将节点路径加入该子句的缓冲区，参数字节数将超过 `ARG_MAX` 预算时先执行一批。
+ *
+ * @param d 指向 `struct data` 的指针，包含批处理缓冲区。
+ * @param c 动作对应的复合命令。
+ * @param n 当前节点。
+ *
+ * @return 总是返回 1。
+ */
+int exec_batch(struct data *d, struct compound *c, struct node *n);
 
 /**
  * @brief 动态扩展 `struct data` 中的数组容量
@@ -230,10 +550,7 @@ int exec_ast(struct data *d, struct ast *parent, struct ast *ast, struct node *n
  * @param id 标识需要扩展的数组。不同的 `id` 对应不同的数组：
  *          - id = 0 扩展 `search_path_list` 数组
  *          - id = 1 扩展 `exp_list` 数组
- *          - id = 2 扩展 `nodes` 数组
- *          - id = 3 扩展 `inode_list` 数组
  *          - id = 4 扩展 `c_list` 数组
- *          - id = 5 扩展 `batch_file_list` 数组
  */
 void my_realloc(struct data *d, int id);
 
@@ -260,42 +577,27 @@ void add_search_path(struct data *d, char *name);
 void add_exp(struct data *d, char *exp);
 
 /**
- * @brief 将 inode 添加到 `inode_list` 数组，以避免目录遍历中的无限循环
- *
- * 该函数用于将目录的 inode 值 `ino` 添加到 `struct data` 中的 `inode_list` 数组。
- * `inode_list` 用于记录已经遍历过的目录的 inode，从而避免在遍历过程中进入相同的目录，防止无限循环。
- * 如果当前数组容量已满，函数会调用 `my_realloc` 来扩展数组容量，并继续将 inode 添加到数组中。
- *
- * @param ino 目录的 inode 值。
- * @param d 指向 `struct data` 的指针，其中包含 `inode_list` 数组和相关容量信息（`il_size` 和 `il_capacity`）。
- */
-void add_inode(struct data *d, int ino);
-
-/**
- * @brief 检查指定的 inode 是否已经存在于 `inode_list` 中
+ * @brief 对一个节点求值
  *
- * 该函数检查给定的 inode 编号 `ino` 是否已经存在于 `d->inode_list` 数组中。
- * 它通过遍历 `inode_list` 数组来查找是否有与 `ino` 相同的 inode 值。如果找到了，则返回 1，表示该 inode 已经存在；如果没有找到，则返回 0，表示该 inode 不存在。
+ * 该函数对遍历到的节点执行字节码程序 `d->prog`；如果表达式中没有动作且结果为真，则打印节点路径。
+ * 深度小于 `-mindepth` 的节点不求值。
+ * 节点不会被保存，调用者在函数返回后即可释放节点及其字符串，从而使内存占用与遍历的节点总数无关。
  *
- * @param ino 要检查的 inode 编号。
- * @param d 指向 `struct data` 的指针，其中包含 `inode_list` 数组和相关的信息。
- * @return 如果 `ino` 存在于 `inode_list` 中，返回 1；否则返回 0。
+ * @param d 指向 `struct data` 的指针，包含字节码程序。
+ * @param n 要求值的节点。
  */
-int inode_exists(struct data *d, int ino);
+void eval_node(struct data *d, struct node *n);
 
 /**
- * @brief 将一个新的节点添加到 `nodes` 数组
+ * @brief 输出一个节点的路径，用于 `-print`、`-print0` 和默认的打印。
  *
- * 该函数用于将一个新的 `node` 结构体添加到 `struct data` 的 `nodes` 数组中。`node` 结构体包含文件/目录的信息，如名称、类型等。
- * 如果当前 `nodes` 数组的容量已满，函数会调用 `my_realloc` 来扩展数组的容量，然后将新的节点添加进去。
+ * 通常写入 `d->out`；并行遍历开启 `--ordered` 时写入当前任务的输出缓冲区。
  *
- * @param name 文件/目录的名称。
- * @param name_wp 文件/目录的名称，不包含路径。
- * @param type 文件/目录的类型（使用 `mode_t` 类型，包含文件的类型信息）。
- * @param r_type 文件/目录的原始类型（使用 `mode_t` 类型，表示文件的原始类型信息）。
- * @param d 指向 `struct data` 的指针，其中包含 `nodes` 数组和相关容量信息（`no_size` 和 `no_capacity`）。
+ * @param d 指向 `struct data` 的指针。
+ * @param name 要输出的路径。
+ * @param term 路径之后的结束符，`-print0` 为 `'\0'`，否则为 `'\n'`。
  */
-void add_node(char *name, char *name_wp, mode_t type, mode_t r_type, struct data *d);
+void print_path(struct data *d, char *name, char term);
 
 /**
  * @brief 将一个新的复合表达式（compound）添加到 data 结构体中的 c_list（复合表达式列表）。
@@ -310,28 +612,136 @@ void add_node(char *name, char *name_wp, mode_t type, mode_t r_type, struct data
 void add_compound(struct data *d, char *name, char **args, enum enum_type et);
 
 /**
- * 将一个批处理文件添加到 `data` 结构体的 `batch_file_list` 中。
- * 如果当前 `batch_file_list` 数组的容量已满，函数会调用 `my_realloc` 来扩展数组的容量，然后将新的节点添加进去。
+ * @brief 递归遍历指定目录并处理每个文件或子目录
  *
- * @param d            指向 `data` 结构体的指针，该结构体包含批处理文件列表。
- * @param batch_file   指向要添加的批处理文件字符串的指针。
+ * 该函数递归地遍历给定目录 `name`，对目录中的每个文件和子目录求值。目录项的类型优先取自 `d_type`，
+ * 子目录通过 `openat` 相对于 `fd` 打开，只有谓词需要或 `d_type` 不可用时才调用 `fstatat`，
+ * 因此只使用 `-name` 的查询每个目录项不需要任何 `stat` 调用。该函数会跳过当前目录 (`.`) 和父目录 (`..`)。
+ * 在 `-L` 模式下，进入目录时将其 `(st_dev, st_ino)` 加入 `d->ancestors`，离开时删除；
+ * 如果目录已经在祖先链上，说明形成了循环，输出错误信息并跳过该目录。
+ * 开启 `--watch` 时在读取目录之前监视该目录。
  *
- * @return             如果批处理文件成功添加，返回 1；
- *                     如果列表已达到最大允许大小 (`MAX_BATCH_SIZE`)，返回 0。
+ * @param fd 已打开的目录文件描述符，函数返回时关闭。
+ * @param name 要遍历的目录的路径，用于拼接输出的完整路径。
+ * @param d 指向 `struct data` 的指针，包含需要的数组和信息，用于存储遍历结果。
  */
-int add_batch_file(struct data *d, char *batch_file);
+void parse_dir(int fd, char *name, struct data *d);
 
 /**
- * @brief 递归遍历指定目录并处理每个文件或子目录
+ * @brief 依次读取目录项并求值，需要时递归进入子目录，`parse_dir` 在未开启 `--uring` 时调用。
  *
- * 该函数递归地遍历给定目录 `name`，对目录中的每个文件和子目录执行特定操作。在遍历过程中，
- * 会为每个文件或子目录执行一些操作，如将文件或目录的信息添加到数据结构中。对于符号链接，函数会
- * 检查符号链接本身以及符号链接指向的目标文件的类型。该函数会跳过当前目录 (`.`) 和父目录 (`..`)。
+ * @param r 已打开的目录读取器，由调用者关闭。
+ * @param fd 目录的文件描述符。
+ * @param name 目录的路径。
+ * @param d 指向 `struct data` 的指针。
+ */
+void parse_dir_entries(struct dir_reader *r, int fd, char *name, struct data *d);
+
+/**
+ * @brief 使用 io_uring 遍历目录，`parse_dir` 在开启 `--uring` 时调用。
  *
- * @param name 要遍历的目录的路径，需要保证是有效目录。
- * @param d 指向 `struct data` 的指针，包含需要的数组和信息，用于存储遍历结果。
+ * 每次从目录中读取一批目录项，为需要类型信息的目录项一次性提交 `statx` 请求，
+ * 按完成的顺序对目录项求值（先序遍历），整批完成后再依次进入子目录。
+ * 因此同一目录内的输出顺序是请求完成的顺序。
+ *
+ * @param r 已打开的目录读取器，由调用者关闭。
+ * @param fd 目录的文件描述符。
+ * @param name 目录的路径。
+ * @param d 指向 `struct data` 的指针。
+ */
+void parse_dir_uring(struct dir_reader *r, int fd, char *name, struct data *d);
+
+/**
+ * @brief 将 `readdir` 返回的 `d_type` 转换为 `mode_t` 中的文件类型位。
+ *
+ * @param d_type 目录项的 `d_type`。
+ *
+ * @return 对应的 `S_IFMT` 类型位；`DT_UNKNOWN` 或无法识别时返回 0。
+ */
+mode_t dtype_to_mode(unsigned char d_type);
+
+/**
+ * @brief 获取节点的文件类型位（不跟随符号链接）。
+ *
+ * 如果 `d_type` 已经给出类型则不产生系统调用，否则调用 `node_type`。
+ *
+ * @param n 节点。
+ *
+ * @return 节点的 `S_IFMT` 类型位。
  */
-void parse_dir(char *name, struct data *d);
+mode_t node_ftype(struct node *n);
+
+/**
+ * @brief 获取节点完整的 `lstat` 模式，首次调用时执行 `fstatat(..., AT_SYMLINK_NOFOLLOW)`。
+ *
+ * @param n 节点。
+ *
+ * @return 节点的 `st_mode`；`fstatat` 失败时返回 0。
+ */
+mode_t node_type(struct node *n);
+
+/**
+ * @brief 获取节点完整的 `stat` 模式（跟随符号链接），首次调用时执行 `fstatat`。
+ *
+ * 对于不是符号链接的节点，直接复用 `lstat` 的结果。
+ *
+ * @param n 节点。
+ *
+ * @return 节点目标的 `st_mode`；`fstatat` 失败时返回 0。
+ */
+mode_t node_r_type(struct node *n);
+
+/**
+ * @brief 获取节点的 `size` 和 `mtime`，首次调用时执行一次只请求 `mask` 字段的 `statx`。
+ *
+ * 在网络文件系统上，只请求需要的字段比完整的 `stat` 代价更低。`statx` 同时返回文件模式，
+ * 不跟随符号链接时一并填入 `type`，之后的 `node_type` 不需要再调用 `fstatat`。
+ * 内核不支持 `statx` 时退回 `fstatat`。
+ *
+ * @param n 节点。
+ * @param mask 需要的 `STATX_*` 字段。
+ * @param follow 是否跟随符号链接。
+ *
+ * @return 成功返回 0；`statx` 失败时返回 -1。
+ */
+int node_attr(struct node *n, unsigned int mask, int follow);
+
+/**
+ * @brief 判断遍历时是否需要进入该节点。
+ *
+ * 节点是目录时返回 1；在 `-L` 模式下，指向目录的符号链接也返回 1。
+ *
+ * @param d 指向 `struct data` 的指针，包含符号链接选项。
+ * @param n 节点。
+ *
+ * @return 需要进入时返回 1，否则返回 0。
+ */
+int node_is_dir(struct data *d, struct node *n);
+
+/**
+ * @brief 对节点求值之后判断是否进入该节点。
+ *
+ * 在 `node_is_dir` 的基础上，先序遍历时执行过 `-prune` 的节点不进入，
+ * 深度已经达到 `-maxdepth` 的节点也不进入，因此被排除的子树不会被打开。
+ *
+ * @param d 指向 `struct data` 的指针，`d->depth` 为节点的深度。
+ * @param n 已经求值的节点。
+ *
+ * @return 需要进入时返回 1，否则返回 0。
+ */
+int node_descend(struct data *d, struct node *n);
+
+/**
+ * @brief 打开需要进入的子目录。
+ *
+ * @param d 指向 `struct data` 的指针。
+ * @param fd 父目录的文件描述符，或 `AT_FDCWD`。
+ * @param name 相对于 `fd` 的子目录名。
+ * @param path 子目录的完整路径，用于错误信息。
+ *
+ * @return 子目录的文件描述符；打开失败时返回 -1，并设置 `d->return_value`。
+ */
+int open_subdir(struct data *d, int fd, char *name, char *path);
 
 /**
  * @brief 在抽象语法树 (AST) 中找到匹配的右括号 (PAC)。
@@ -406,36 +816,6 @@ int brackets_finder(char *str);
  */
 int is_ast_valid(struct data *d, struct ast *parent, struct ast *ast, int child);
 
-/**
- * @brief 重置抽象语法树（AST）中所有节点的rvalue值。
- *
- * 该函数通过深度优先遍历AST，重置每个节点的rvalue[0]和rvalue[1]为1。
- * rvalue字段表示节点的结果或状态，调用此函数后，将这些值恢复为初始状态。
- *
- * @param root 指向AST根节点的指针。
- */
-void reset_rvalues(struct ast *root);
-
-/**
- * @brief 释放并重新初始化 `inode_list` 数组
- *
- * 该函数用于释放 `struct data` 结构体中的 `inode_list` 数组所占用的内存，并重新初始化该数组。
- * 在释放内存后，`inode_list` 数组会被分配一个新的、容量为 10 的内存块，并将相关的计数器（`il_size` 和 `il_capacity`）重置为初始值。
- *
- * @param d 指向 `struct data` 的指针，其中包含 `inode_list` 数组以及相关的容量和大小信息。
- */
-void free_il(struct data *d);
-
-/**
- * @brief 释放并重新初始化 `batch_file_list` 数组
- *
- * 该函数用于释放 `struct data` 结构体中的 `batch_file_list` 数组所占用的内存，并重新初始化该数组。
- * 在释放内存后，`batch_file_list` 数组会被分配一个新的、容量为 10 的内存块，并将相关的计数器（`bfl_size` 和 `bfl_capacity`）重置为初始值。
- *
- * @param d 指向 `struct data` 的指针，其中包含 `inode_list` 数组以及相关的容量和大小信息。
- */
-void free_bfl(struct data *d);
-
 /**
  * @brief 递归释放抽象语法树 (AST) 的内存。
  *
@@ -455,9 +835,10 @@ void free_ast(struct ast *ast);
 void free_data(struct data *d);
 
 /**
- * @brief 打印抽象语法树（AST）的结构。
+ * @brief 将抽象语法树（AST）的结构打印到标准错误，`-D opt` 使用。
  *
- * 该函数递归地遍历并打印抽象语法树中每个节点的类型。对于每个节点，打印其在树中的索引、位置（左子节点或右子节点）以及节点的类型（如 THEN、AND、OR 等）。
+ * 该函数递归地遍历并打印抽象语法树中每个节点的类型。对于每个节点，按深度缩进，打印其在树中的索引、位置（左子节点或右子节点）以及节点的类型（如 THEN、AND、OR 等）；
+ * 叶子节点还打印谓词或动作的名称和参数。除 `!` 以外的节点附带 `ast_estimate` 估计的代价、为真的概率以及是否有副作用。
  * 打印的输出有助于调试和可视化AST的结构。
  *
  * 该函数会递归调用自身来遍历左右子树，直到到达叶子节点。
@@ -0,0 +1,63 @@
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include "myfind.h"
+
+/**
+ * @def OPT_LEVEL_DEFAULT
+ * @brief 未指定 `-O` 时的优化级别。
+ */
+#define OPT_LEVEL_DEFAULT 1
+
+/**
+ * @struct estimate
+ * @brief 一个子表达式求值一次的估计代价和为真的概率。
+ */
+struct estimate
+{
+    double cost; /**< 期望代价，单位约为一次名称比较；短路求值时后面的操作数按前面的结果加权。 */
+    double p;    /**< 为真的概率。 */
+    int pure;    /**< 子表达式没有副作用、可以与相邻的操作数交换顺序时为 1。 */
+};
+
+/**
+ * @brief 估计子表达式的代价和为真的概率。
+ *
+ * 每个谓词的代价按它需要的系统调用分级：只看名称的 `-name` 最低，其次是只需要 `d_type` 的 `-type`，
+ * 再次是需要 `stat` 的 `-perm`、`-size`、`-mtime`、`-mmin`、`-newer` 和还可能需要打开目录的 `-empty`，
+ * 读取文件内容的 `-contains` 更高，启动子进程的 `-exec` 最高。概率是对一般目录树的粗略估计，
+ * 例如 `-type f` 为 0.85，`-name` 不含通配符时为 0.01。
+ *
+ * `-print`、`-exec ... +`、`-prune`、`-quit`、`-limit` 有副作用，含有它们的子表达式不是纯的；
+ * `level >= 2` 时 `-exec ... ;` 被视为没有副作用的测试。
+ *
+ * @param ast 子表达式的根节点，必须已经通过 `is_ast_valid` 的检查。
+ * @param level 优化级别，见 `optimize_ast`。
+ *
+ * @return 估计结果。
+ */
+struct estimate ast_estimate(struct ast *ast, int level);
+
+/**
+ * @brief 按估计的代价重新排列表达式中没有副作用的操作数，使便宜且选择性强的测试先求值。
+ *
+ * 相邻的 `a b`、`a -a b` 连接的操作数合并为一条合取链，`-o` 连接的操作数合并为一条析取链，
+ * 括号内的子表达式先递归优化，再作为一个整体参与排序；`!` 与紧随其后的操作数一起移动。
+ * 链中有副作用的操作数（见 `ast_estimate`）是屏障，只在两个屏障之间排序，因此动作求值的次数和顺序不变。
+ * 合取链按 `cost / (1 - p)` 升序排列，析取链按 `cost / p` 升序排列，这是互相独立的测试的最优顺序；
+ * 估计相同的操作数保持原来的顺序。
+ *
+ * 优化后的合取链是向右展开的 `THEN` 链，析取链是向右展开的 `OR` 树，与 `build_ast` 的结果形式相同。
+ * 根节点原地修改，被合并的中间节点重新使用或释放，复合命令本身不变。
+ *
+ * - `level == 0`：不做任何修改。
+ * - `level == 1`：只移动纯的谓词，输出和动作都不变。
+ * - `level >= 2`：`-exec ... ;` 也可以移动到更便宜的测试之后，命令的执行次数可能减少，
+ *   只应在命令本身没有副作用（如 `-exec test ... \;`）时使用。
+ *
+ * @param ast AST 的根节点，必须已经通过 `is_ast_valid` 的检查。
+ * @param level 优化级别。
+ */
+void optimize_ast(struct ast *ast, int level);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+#include <sys/uio.h>
+
+/**
+ * @def OUT_BUF_SIZE
+ * @brief 每个输出缓冲区的容量。
+ */
+#define OUT_BUF_SIZE (64 * 1024)
+
+/**
+ * @struct out_buf
+ * @brief 标准输出的缓冲区，绕过 stdio 直接用 `write`/`writev` 写入文件描述符 1。
+ *
+ * 单线程遍历只有一个缓冲区；并行遍历时每个工作线程各有一个，互不加锁地追加记录。
+ * 缓冲区只包含完整的记录，写出时持有全局的输出锁，因此不同线程的记录不会交错。
+ * 标准输出是终端时每条记录之后立即写出，与 stdio 的行缓冲一致。
+ */
+struct out_buf
+{
+    char *buf;  /**< 缓冲区。 */
+    size_t len; /**< 已使用的字节数。 */
+    size_t cap; /**< 缓冲区容量。 */
+    int line;   /**< 标准输出是否是终端，是则每条记录之后立即写出。 */
+    int error;  /**< 是否发生过写入错误，发生后丢弃之后的所有输出。 */
+};
+
+/**
+ * @brief 创建输出缓冲区。
+ *
+ * @param cap 缓冲区容量。
+ *
+ * @return 新的缓冲区，由 `out_destroy` 释放。
+ */
+struct out_buf *out_create(size_t cap);
+
+/**
+ * @brief 追加一条记录：`len` 字节的 `str` 加上结束符 `term`（`'\n'` 或 `-print0` 的 `'\0'`）。
+ *
+ * 缓冲区放不下时先写出已有内容；记录本身比缓冲区还大时与已有内容一起用一次 `writev` 直接写出。
+ *
+ * @param o 输出缓冲区。
+ * @param str 记录内容，不必以 `'\0'` 结尾。
+ * @param len 记录长度。
+ * @param term 结束符。
+ */
+void out_record(struct out_buf *o, const char *str, size_t len, char term);
+
+/**
+ * @brief 写出缓冲区中的内容，再用 `writev` 写出 `iov` 指向的数据，整个过程持有输出锁。
+ *
+ * 用于 `--ordered` 模式按顺序写出各个任务已经缓冲好的输出，不需要再复制一次。
+ *
+ * @param o 输出缓冲区。
+ * @param iov 要写出的数据。
+ * @param count `iov` 中元素的数量。
+ */
+void out_writev(struct out_buf *o, struct iovec *iov, int count);
+
+/**
+ * @brief 写出缓冲区中的所有内容。
+ *
+ * 启动子进程之前需要调用，使已经打印的路径出现在子进程的输出之前。
+ *
+ * @param o 输出缓冲区。
+ *
+ * @return 成功返回 0；这次或之前发生过写入错误时返回 -1。
+ */
+int out_flush(struct out_buf *o);
+
+/**
+ * @brief 写出剩余内容并释放缓冲区。
+ *
+ * @param o 要释放的缓冲区，可以为 NULL。
+ *
+ * @return 成功返回 0；发生过写入错误时返回 -1。
+ */
+int out_destroy(struct out_buf *o);
+
+#endif
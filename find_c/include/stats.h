@@ -0,0 +1,85 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+/**
+ * @def STATS_OPS
+ * @brief 按操作码统计求值次数的数组大小，不小于 `enum opcode` 中操作码的数量。
+ */
+#define STATS_OPS 24
+
+/**
+ * @def STATS_INC
+ * @brief 当前线程的计数器加一，不需要加锁或原子操作。
+ */
+#define STATS_INC(field) (stats_local.field++)
+
+/**
+ * @enum stats_phase
+ * @brief `--stats` 分别计时的阶段，按顺序进行。
+ */
+enum stats_phase
+{
+    PHASE_PARSE = 0, /**< 解析选项、查找路径和表达式。 */
+    PHASE_COMPILE,   /**< `compile_expression`：`build_ast`、检查和编译字节码。 */
+    PHASE_WALK,      /**< 遍历、建立或查询索引、监视。 */
+    PHASE_DUPES,     /**< `--dupes` 读取候选文件并比较内容。 */
+    PHASE_EXEC,      /**< 执行剩余的 `-exec ... +`、等待子进程并写出剩余输出。 */
+    PHASE_COUNT      /**< 阶段的数量。 */
+};
+
+/**
+ * @struct stats
+ * @brief 一个线程的计数器。
+ *
+ * 每个线程在线程局部存储中有一份，计数时只是一次普通的加法，因此总是开启，
+ * `--stats` 只决定退出时是否输出。工作线程结束前调用 `stats_merge` 累加到全局计数器中。
+ */
+struct stats
+{
+    uint64_t dirs;           /**< 成功打开并读取的目录数。 */
+    uint64_t entries;        /**< 读到的目录项数（不含 `.` 和 `..`）。 */
+    uint64_t lstats;         /**< `lstat`/`fstatat(AT_SYMLINK_NOFOLLOW)`/`statx` 的调用次数。 */
+    uint64_t stats;          /**< 跟随符号链接的 `stat` 调用次数。 */
+    uint64_t spawns;         /**< `-exec` 启动的子进程数。 */
+    uint64_t bytes;          /**< `-print`、`-print0` 和默认输出的字节数。 */
+    uint64_t scanned;        /**< `-contains`、`-contains-regex` 和 `--dupes` 读取的文件内容字节数。 */
+    uint64_t exec_ns;        /**< 启动和等待 `-exec` 子进程花费的时间，以纳秒为单位。 */
+    uint64_t ops[STATS_OPS]; /**< 按操作码统计的字节码指令执行次数，即每种谓词和动作的求值次数。 */
+};
+
+/**
+ * @brief 当前线程的计数器。
+ */
+extern __thread struct stats stats_local;
+
+/**
+ * @brief 单调时钟的当前时间。
+ *
+ * @return 以纳秒为单位的时间。
+ */
+uint64_t stats_now(void);
+
+/**
+ * @brief 结束当前阶段的计时并开始下一个阶段，第一次调用时开始计时。
+ *
+ * 每个阶段记录经过的时间和进程（所有线程）使用的 CPU 时间。
+ *
+ * @param ph 下一个阶段。
+ */
+void stats_phase(enum stats_phase ph);
+
+/**
+ * @brief 将当前线程的计数器累加到全局计数器中并清零，工作线程结束前调用。
+ */
+void stats_merge(void);
+
+/**
+ * @brief 结束当前阶段，合并主线程的计数器，并将统计结果输出到标准错误。
+ *
+ * @param json 为 1 时输出一行 JSON，否则输出便于阅读的表格。
+ */
+void stats_report(int json);
+
+#endif
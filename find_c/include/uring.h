@@ -0,0 +1,53 @@
+#ifndef URING_H
+#define URING_H
+
+#include "myfind.h"
+
+#include <stddef.h>
+
+/**
+ * @def URING_DEPTH
+ * @brief 每个 io_uring 的队列深度，也是一批同时提交 `statx` 的目录项数量上限。
+ */
+#define URING_DEPTH 64
+
+struct uring;
+
+/**
+ * @brief 创建一个 io_uring 实例。
+ *
+ * 直接使用 `io_uring_setup` 系统调用和 mmap 映射的提交/完成队列，不依赖 liburing。
+ *
+ * @param entries 队列深度。
+ *
+ * @return 成功返回 io_uring 实例；内核不支持、被禁用或编译时没有 `<linux/io_uring.h>` 时返回 NULL，
+ *         调用者应退回同步的 `fstatat` 路径。
+ */
+struct uring *uring_create(unsigned int entries);
+
+/**
+ * @brief 释放 io_uring 实例。
+ *
+ * @param u 要释放的实例，可以为 NULL。
+ */
+void uring_destroy(struct uring *u);
+
+/**
+ * @brief 异步获取一批节点的类型信息，每个节点的信息就绪后立即调用 `ready`。
+ *
+ * 对于需要 `lstat`（`d_type` 未知、表达式需要完整模式或属性）或需要跟随符号链接的节点，
+ * 一次性提交 `IORING_OP_STATX` 请求（相对于节点的 `dirfd`），并按完成的顺序回调；
+ * 请求的字段包括 `d->attr_mask`，因此 `-size`、`-mtime` 等谓词同样不需要同步的系统调用。
+ * 不需要任何系统调用的节点直接回调。函数返回时所有请求都已完成，队列为空。
+ *
+ * @param u io_uring 实例。
+ * @param d 指向 `struct data` 的指针，包含符号链接选项、`need_mode` 和 `attr_mask`。
+ * @param nodes 节点数组，数量不能超过队列深度。
+ * @param count 节点数量。
+ * @param ready 节点信息就绪时的回调。
+ * @param arg 传给回调的参数。
+ */
+void uring_stat_batch(struct uring *u, struct data *d, struct node *nodes, size_t count,
+                      void (*ready)(struct data *d, struct node *n, void *arg), void *arg);
+
+#endif
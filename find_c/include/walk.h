@@ -0,0 +1,127 @@
+#ifndef WALK_H
+#define WALK_H
+
+#include "myfind.h"
+
+#include <pthread.h>
+#include <stddef.h>
+
+/**
+ * @struct out_item
+ * @brief 有序输出模式下任务输出列表中的一项。
+ *
+ * 一项要么是一段累积的文本（`child == NULL`），要么是对子目录任务输出的引用。
+ * 按列表顺序展开所有项即可得到与单线程遍历完全一致的输出顺序。
+ */
+struct out_item
+{
+    char *buf;          /**< 累积的输出文本。 */
+    size_t len;         /**< `buf` 中已使用的字节数。 */
+    size_t cap;         /**< `buf` 当前分配的容量。 */
+    struct task *child; /**< 子目录任务，非 NULL 时该项表示子任务的全部输出。 */
+};
+
+/**
+ * @struct task
+ * @brief 并行遍历中的一个目录任务。
+ *
+ * 每个待遍历的目录对应一个任务。任务被放入工作线程的双端队列中，可以被其他线程窃取。
+ * `pending` 记录该任务自身以及尚未完成的子任务数量，归零时表示整棵子树已遍历完毕，
+ * 此时在 `-d` 模式下才对目录本身求值（后序遍历）。
+ */
+struct task
+{
+    char *path;          /**< 目录的完整路径。 */
+    char *name_wp;       /**< 目录名，不含路径（仅后序遍历时使用）。 */
+    mode_t type;         /**< 目录的链接类型（仅后序遍历时使用）。 */
+    mode_t r_type;       /**< 目录的实际类型（仅后序遍历时使用）。 */
+    int flags;           /**< `type` 和 `r_type` 中哪些信息有效（仅后序遍历时使用）。 */
+    int has_node;        /**< 是否需要在子树完成后对目录本身求值（`-d` 模式）。 */
+    int is_root;         /**< 是否是命令行中给出的查找路径，根任务由 `walk_root` 释放。 */
+    int depth;           /**< 目录的深度，查找路径本身为 0，其中的目录项深度为 `depth + 1`。 */
+    struct task *parent; /**< 父目录任务，根任务为 NULL。 */
+    size_t pending;      /**< 任务自身加上未完成的子任务数量，原子更新。 */
+    struct worker *walker; /**< 正在处理该任务的工作线程（仅 io_uring 回调使用）。 */
+    dev_t dev;             /**< 目录的设备号（仅 `-L` 模式下检测循环使用）。 */
+    ino_t ino;             /**< 目录的 inode 编号（仅 `-L` 模式下检测循环使用）。 */
+    int tracked;           /**< `dev` 和 `ino` 是否有效。 */
+
+    // 有序输出缓冲区（仅 `--ordered` 模式使用）
+    struct out_item *items; /**< 输出项列表。 */
+    size_t it_size;         /**< `items` 中元素的当前数量。 */
+    size_t it_capacity;     /**< `items` 当前分配的容量。 */
+};
+
+/**
+ * @struct deque
+ * @brief 每个工作线程私有的任务双端队列。
+ *
+ * 所有者从尾部压入和弹出任务（后进先出，保持深度优先的局部性），
+ * 其他线程从头部窃取任务（先进先出，倾向于窃取更大的子树）。
+ */
+struct deque
+{
+    struct task **buf;    /**< 环形缓冲区。 */
+    size_t head;          /**< 队头下标，窃取端。 */
+    size_t tail;          /**< 队尾下标，所有者端。 */
+    size_t cap;           /**< 环形缓冲区的容量，始终为 2 的幂。 */
+    pthread_mutex_t lock; /**< 保护队列的互斥锁。 */
+};
+
+struct walk;
+
+/**
+ * @struct worker
+ * @brief 一个遍历工作线程。
+ *
+ * 每个工作线程拥有自己的 `struct data` 副本（共享字节码程序，拥有独立的批处理缓冲区），
+ * 因此求值过程无需加锁。
+ */
+struct worker
+{
+    struct walk *walk; /**< 所属的并行遍历。 */
+    struct data d;     /**< 线程私有的数据副本。 */
+    struct deque dq;   /**< 线程私有的任务队列。 */
+    int id;            /**< 线程编号。 */
+    unsigned int seed; /**< 选择窃取目标的随机数种子。 */
+    pthread_t tid;     /**< 线程标识。 */
+};
+
+/**
+ * @struct walk
+ * @brief 一次并行遍历（一个查找路径）的共享状态。
+ */
+struct walk
+{
+    struct data *d;             /**< 主线程的数据。 */
+    struct worker *workers;     /**< 工作线程数组。 */
+    int nworkers;               /**< 工作线程数量。 */
+    size_t outstanding;         /**< 已创建但尚未处理完的任务数量，原子更新。 */
+    size_t idle;                /**< 正在等待任务的线程数量。 */
+    pthread_mutex_t idle_lock;  /**< 与 `idle_cond` 配合使用。 */
+    pthread_cond_t idle_cond;   /**< 有新任务或遍历结束时通知空闲线程。 */
+};
+
+/**
+ * @brief 使用 `d->jobs` 个线程并行遍历一个查找路径。
+ *
+ * 子目录作为任务放入工作线程的双端队列，空闲线程从其他线程的队列中窃取任务。
+ * 默认先序遍历时目录在其内容之前求值，求值结果（`-prune`）和 `-maxdepth` 决定是否为其创建任务；
+ * 开启 `-d` 时目录在其所有内容求值完成后才求值。查找路径本身在先序遍历时由调用者求值。
+ * 开启 `--ordered` 时，每个目录的输出先写入任务缓冲区，整个查找路径遍历完成后按单线程遍历的顺序输出。
+ *
+ * @param d 主线程的数据。
+ * @param n 查找路径对应的节点，必须是一个目录。函数返回后调用者仍负责释放节点中的字符串。
+ */
+void walk_root(struct data *d, struct node *n);
+
+/**
+ * @brief 将一条输出记录写入当前任务的有序输出缓冲区。
+ *
+ * @param t 当前任务。
+ * @param str 输出的字符串。
+ * @param len 字符串长度。
+ */
+void task_append(struct task *t, const char *str, size_t len);
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "myfind.h"
+
+#include <stddef.h>
+#include <sys/inotify.h>
+
+/**
+ * @def WATCH_MASK
+ * @brief 监视每个目录的 inotify 事件：目录项的创建、移入、写入后关闭、属性变化，以及用于维护监视表的移出。
+ */
+#define WATCH_MASK (IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_ONLYDIR)
+
+/**
+ * @def WATCH_BUF_SIZE
+ * @brief 每次 `read` inotify 事件的缓冲区大小。
+ */
+#define WATCH_BUF_SIZE (64 * 1024)
+
+/**
+ * @def WATCH_DELAY_MS
+ * @brief 读到事件后继续等待后续事件的毫秒数，使一次写入产生的多个事件落在同一批中而只求值一次。
+ */
+#define WATCH_DELAY_MS 20
+
+/**
+ * @struct watch_dir
+ * @brief 一个被监视的目录。
+ */
+struct watch_dir
+{
+    char *path; /**< 目录的完整路径，不监视时为 NULL。 */
+    int depth;  /**< 目录的深度，其中目录项的深度为 `depth + 1`。 */
+};
+
+/**
+ * @struct watch
+ * @brief `--watch` 模式的 inotify 实例和监视表。
+ *
+ * 遍历时 `parse_dir` 在读取每个目录之前为它添加监视，因此被 `-prune` 排除或超过 `-maxdepth` 的目录不会被监视。
+ * 监视描述符是从 1 开始递增的小整数，直接作为 `dirs` 的下标。
+ */
+struct watch
+{
+    int fd;                /**< inotify 实例的文件描述符。 */
+    struct watch_dir *dirs; /**< 以监视描述符为下标的目录表。 */
+    size_t capacity;       /**< `dirs` 当前分配的容量。 */
+    size_t count;          /**< 正在监视的目录数。 */
+    int full;              /**< 是否已经达到 `max_user_watches` 上限（只警告一次）。 */
+};
+
+/**
+ * @brief 创建 inotify 实例。
+ *
+ * @return 新的监视表；内核不支持 inotify 时返回 NULL 并设置 `errno`。
+ */
+struct watch *watch_create(void);
+
+/**
+ * @brief 关闭 inotify 实例并释放监视表。
+ *
+ * @param w 监视表，可以为 NULL。
+ */
+void watch_destroy(struct watch *w);
+
+/**
+ * @brief 监视一个将要读取的目录，由 `parse_dir` 在读取目录之前调用。
+ *
+ * 先添加监视再读取目录，因此读取期间创建的目录项不会遗漏（可能被求值两次）。
+ * 同一个目录（例如被改名后重新遍历）返回同一个监视描述符，此时更新它的路径和深度。
+ *
+ * @param w 监视表。
+ * @param path 目录的完整路径。
+ * @param depth 目录的深度。
+ */
+void watch_add(struct watch *w, char *path, int depth);
+
+/**
+ * @brief 初始遍历完成后持续读取 inotify 事件，只对新出现或变化的目录项求值。
+ *
+ * 对创建、移入、写入后关闭和属性变化的目录项执行 `d->prog`。读到事件后再等待 `WATCH_DELAY_MS` 收集后续事件，
+ * 同一批事件中连续针对同一个目录项的多个事件只求值一次。
+ * 新创建或移入的目录在求值后按遍历的规则（`-prune`、`-maxdepth`）递归读取并监视。
+ * 移出监视范围的目录不再监视。每批事件处理完后写出输出，并执行累积的 `-exec ... +`。
+ * 执行 `-quit`、`-limit` 结束，或收到 `SIGINT`、`SIGTERM` 时返回。
+ *
+ * @param d 指向 `struct data` 的指针，`d->watch` 中已经有初始遍历添加的监视。
+ */
+void watch_run(struct data *d);
+
+#endif
@@ -0,0 +1,94 @@
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// 分配的对齐单位
+#define ARENA_ALIGN sizeof(void *)
+
+void arena_init(struct arena *a)
+{
+    a->cur = NULL;
+    a->spare = NULL;
+    a->chunks = 0;
+}
+
+// 当前块放不下时换一块新的，优先使用保留的空闲块
+static void arena_grow(struct arena *a, size_t size)
+{
+    struct arena_chunk *c = a->spare;
+    if (c && c->size >= size)
+        a->spare = NULL;
+    else
+    {
+        size_t cap = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+        c = malloc(sizeof(struct arena_chunk) + cap);
+        c->size = cap;
+        a->chunks++;
+    }
+    c->used = 0;
+    c->prev = a->cur;
+    a->cur = c;
+}
+
+void *arena_alloc(struct arena *a, size_t size)
+{
+    size_t used;
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if (!a->cur || a->cur->used + size > a->cur->size)
+        arena_grow(a, size);
+    used = a->cur->used;
+    a->cur->used += size;
+    return a->cur->data + used;
+}
+
+char *arena_path(struct arena *a, char *dir, size_t dlen, char *name)
+{
+    size_t nlen = strlen(name);
+    int sep = dlen == 0 || dir[dlen - 1] != '/';
+    char *path = arena_alloc(a, dlen + sep + nlen + 1);
+    memcpy(path, dir, dlen);
+    if (sep)
+        path[dlen] = '/';
+    memcpy(path + dlen + sep, name, nlen + 1);
+    return path;
+}
+
+struct arena_mark arena_mark(struct arena *a)
+{
+    struct arena_mark m;
+    m.chunk = a->cur;
+    m.used = a->cur ? a->cur->used : 0;
+    return m;
+}
+
+void arena_release(struct arena *a, struct arena_mark m)
+{
+    while (a->cur != m.chunk)
+    {
+        struct arena_chunk *c = a->cur;
+        a->cur = c->prev;
+        // 保留较大的一块作为空闲块
+        if (!a->spare || a->spare->size < c->size)
+        {
+            free(a->spare);
+            a->spare = c;
+        }
+        else
+            free(c);
+    }
+    if (a->cur)
+        a->cur->used = m.used;
+}
+
+void arena_free(struct arena *a)
+{
+    while (a->cur)
+    {
+        struct arena_chunk *c = a->cur;
+        a->cur = c->prev;
+        free(c);
+    }
+    free(a->spare);
+    a->spare = NULL;
+}
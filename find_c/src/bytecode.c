@@ -0,0 +1,336 @@
+#include "bytecode.h"
+#include "lib/lib_str.h"
+#include "stats.h"
+
+#include <stdlib.h>
+
+static size_t emit(struct program *p, enum opcode op, struct compound *c)
+{
+    if (p->size >= p->capacity)
+    {
+        p->capacity = p->capacity ? p->capacity * 2 : 16;
+        p->code = realloc(p->code, p->capacity * sizeof(struct insn));
+    }
+    p->code[p->size].op = op;
+    p->code[p->size].target = 0;
+    p->code[p->size].c = c;
+    p->code[p->size].set = NULL;
+    return p->size++;
+}
+
+// 将跳转指令的目标设置为下一条要生成的指令
+static void patch(struct program *p, size_t at)
+{
+    p->code[at].target = p->size;
+}
+
+static enum opcode predicate_op(struct compound *c)
+{
+    if (c->pred.kind == PRED_NAME)
+        return OP_NAME;
+    if (c->pred.kind == PRED_TYPE)
+        return OP_TYPE;
+    if (c->pred.kind == PRED_PRUNE)
+        return OP_PRUNE;
+    if (c->pred.kind == PRED_TRUE)
+        return OP_TRUE;
+    if (c->pred.kind == PRED_LIMIT)
+        return OP_LIMIT;
+    if (c->pred.kind == PRED_QUIT)
+        return OP_QUIT;
+    if (c->pred.kind == PRED_SIZE)
+        return OP_SIZE;
+    if (c->pred.kind == PRED_MTIME)
+        return OP_MTIME;
+    if (c->pred.kind == PRED_NEWER)
+        return OP_NEWER;
+    if (c->pred.kind == PRED_EMPTY)
+        return OP_EMPTY;
+    if (c->pred.kind == PRED_CONTAINS)
+        return OP_CONTAINS;
+    return OP_PERM;
+}
+
+static void compile_node(struct program *p, struct ast *ast);
+
+// 如果子树只是一个 -name 谓词（可能带括号），返回对应的复合命令
+static struct compound *name_leaf(struct ast *ast)
+{
+    while (ast->et == THEN && ast->left && !ast->right)
+        ast = ast->left;
+    if (ast->et == CONDITION && ast->c_list[0]->pred.kind == PRED_NAME)
+        return ast->c_list[0];
+    return NULL;
+}
+
+// 展开嵌套的 -o，按从左到右的顺序收集操作数
+static void collect_or(struct ast *ast, struct ast ***ops, size_t *count, size_t *capacity)
+{
+    struct ast *inner = ast;
+    while (inner->et == THEN && inner->left && !inner->right)
+        inner = inner->left;
+    if (inner->et == OR)
+    {
+        collect_or(inner->left, ops, count, capacity);
+        collect_or(inner->right, ops, count, capacity);
+        return;
+    }
+    if (*count >= *capacity)
+    {
+        *capacity = *capacity ? *capacity * 2 : 8;
+        *ops = realloc(*ops, *capacity * sizeof(struct ast *));
+    }
+    (*ops)[(*count)++] = ast;
+}
+
+// a -o b -o c 编译为 a; JT end; b; JT end; c
+// 谓词没有副作用，因此相邻的 -name 可以合并为一个集合而不改变短路求值的结果
+static void compile_or(struct program *p, struct ast *ast)
+{
+    struct ast **ops = NULL;
+    size_t count = 0, capacity = 0;
+    size_t *jumps;
+    size_t njumps = 0;
+    collect_or(ast, &ops, &count, &capacity);
+    jumps = calloc(count, sizeof(size_t));
+    for (size_t i = 0; i < count;)
+    {
+        size_t j = i;
+        while (j < count && name_leaf(ops[j]))
+            j++;
+        if (j - i >= 2)
+        {
+            char **patterns = calloc(j - i, sizeof(char *));
+            size_t at = emit(p, OP_NAMESET, NULL);
+            for (size_t k = i; k < j; k++)
+                patterns[k - i] = name_leaf(ops[k])->pred.pattern;
+            p->code[at].set = globset_compile(patterns, j - i);
+            free(patterns);
+            i = j;
+        }
+        else
+            compile_node(p, ops[i++]);
+        if (i < count)
+            jumps[njumps++] = emit(p, OP_JT, NULL);
+    }
+    for (size_t i = 0; i < njumps; i++)
+        patch(p, jumps[i]);
+    free(jumps);
+    free(ops);
+}
+
+// THEN 链：相邻的两个操作数之间是隐式的 -a，`!` 只作用于下一个操作数
+static void compile_then(struct program *p, struct ast *ast)
+{
+    int negate = 0;
+    size_t jump;
+    if (!ast->left)
+    {
+        emit(p, OP_TRUE, NULL);
+        return;
+    }
+    while (ast->left && ast->left->et == NO && ast->right)
+    {
+        negate = !negate;
+        ast = ast->right;
+    }
+    if (ast->et != THEN)
+    {
+        compile_node(p, ast);
+        if (negate)
+            emit(p, OP_NOT, NULL);
+        return;
+    }
+    compile_node(p, ast->left);
+    if (negate)
+        emit(p, OP_NOT, NULL);
+    if (ast->right)
+    {
+        jump = emit(p, OP_JF, NULL);
+        compile_node(p, ast->right);
+        patch(p, jump);
+    }
+}
+
+static void compile_node(struct program *p, struct ast *ast)
+{
+    size_t jump;
+    switch (ast->et)
+    {
+    case AND:
+        compile_node(p, ast->left);
+        jump = emit(p, OP_JF, NULL);
+        compile_node(p, ast->right);
+        patch(p, jump);
+        break;
+    case OR:
+        compile_or(p, ast);
+        break;
+    case THEN:
+        compile_then(p, ast);
+        break;
+    case CONDITION:
+        emit(p, predicate_op(ast->c_list[0]), ast->c_list[0]);
+        break;
+    case PRINT:
+        emit(p, my_strcmp("-print0", ast->c_list[0]->name) ? OP_PRINT : OP_PRINT0, ast->c_list[0]);
+        break;
+    case EXEC:
+        emit(p, OP_EXEC, ast->c_list[0]);
+        break;
+    case EXECP:
+        emit(p, OP_EXECP, ast->c_list[0]);
+        break;
+    default:
+        emit(p, OP_TRUE, NULL);
+        break;
+    }
+}
+
+// 合并跳转链，累加器在跳转过程中不变
+static void thread_jumps(struct program *p)
+{
+    for (size_t i = 0; i < p->size; i++)
+    {
+        struct insn *in = &p->code[i];
+        if (in->op != OP_JF && in->op != OP_JT)
+            continue;
+        for (;;)
+        {
+            struct insn *t = &p->code[in->target];
+            if (t->op == in->op)
+                in->target = t->target;
+            else if (t->op == OP_JF || t->op == OP_JT)
+                in->target++;
+            else
+                break;
+        }
+    }
+}
+
+// 结果直接成为程序返回值的 -exec ; 不需要等待退出状态
+static void mark_async(struct program *p)
+{
+    for (size_t i = 0; i < p->size; i++)
+    {
+        size_t j = i + 1;
+        if (p->code[i].op != OP_EXEC)
+            continue;
+        while (p->code[j].op == OP_NOT)
+            j++;
+        if (p->code[j].op == OP_END)
+            p->code[i].op = OP_EXECA;
+    }
+}
+
+struct program *compile_ast(struct ast *ast)
+{
+    struct program *p = calloc(1, sizeof(struct program));
+    compile_node(p, ast);
+    emit(p, OP_END, NULL);
+    thread_jumps(p);
+    mark_async(p);
+    return p;
+}
+
+int run_program(struct data *d, struct program *p, struct node *n)
+{
+    struct insn *code = p->code;
+    struct insn *ip = code;
+    int r = 1;
+    for (;;)
+    {
+        STATS_INC(ops[ip->op]);
+        switch (ip->op)
+        {
+        case OP_NAME:
+            r = match_name(ip->c, n);
+            break;
+        case OP_NAMESET:
+            r = globset_match(ip->set, n->name_wp);
+            break;
+        case OP_TYPE:
+            r = match_type(ip->c, n);
+            break;
+        case OP_PERM:
+            r = match_perm(ip->c, n);
+            break;
+        case OP_SIZE:
+            r = match_size(ip->c, n);
+            break;
+        case OP_MTIME:
+            r = match_mtime(ip->c, n);
+            break;
+        case OP_NEWER:
+            r = match_newer(ip->c, n);
+            break;
+        case OP_EMPTY:
+            r = match_empty(ip->c, n);
+            break;
+        case OP_CONTAINS:
+            r = match_contains(ip->c, n);
+            break;
+        case OP_PRINT:
+            print_path(d, n->name, '\n');
+            r = 1;
+            break;
+        case OP_PRINT0:
+            print_path(d, n->name, '\0');
+            r = 1;
+            break;
+        case OP_EXEC:
+            r = exec_command(d, ip->c, n);
+            break;
+        case OP_EXECA:
+            r = exec_spawn(d, ip->c, n);
+            break;
+        case OP_EXECP:
+            r = exec_batch(d, ip->c, n);
+            break;
+        case OP_PRUNE:
+            n->flags |= NODE_PRUNE;
+            r = 1;
+            break;
+        case OP_LIMIT:
+            r = match_limit(ip->c);
+            break;
+        case OP_QUIT:
+            // 与 find 一致，表达式的其余部分不再求值
+            request_quit();
+            return 1;
+        case OP_NOT:
+            r = !r;
+            break;
+        case OP_JF:
+            if (!r)
+            {
+                ip = code + ip->target;
+                continue;
+            }
+            break;
+        case OP_JT:
+            if (r)
+            {
+                ip = code + ip->target;
+                continue;
+            }
+            break;
+        case OP_TRUE:
+            r = 1;
+            break;
+        case OP_END:
+            return r;
+        }
+        ip++;
+    }
+}
+
+void free_program(struct program *p)
+{
+    if (!p)
+        return;
+    for (size_t i = 0; i < p->size; i++)
+        globset_free(p->code[i].set);
+    free(p->code);
+    free(p);
+}
@@ -0,0 +1,253 @@
+#include "content.h"
+#include "stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CONTENT_X86 1
+#include <immintrin.h>
+#endif
+
+// 每个线程的读取缓冲区，第一次读取文件时分配
+static __thread char *buf;
+static __thread size_t buf_cap;
+
+// 逐字节的实现：用 memchr 找首字节，再比较其余部分；调用者保证 m >= 1
+static const char *memmem_scalar(const char *hay, size_t n, const char *needle, size_t m)
+{
+    const char *p = hay, *end;
+    if (n < m)
+        return NULL;
+    end = hay + n - m + 1;
+    while (p < end && (p = memchr(p, needle[0], end - p)))
+    {
+        if (memcmp(p + 1, needle + 1, m - 1) == 0)
+            return p;
+        p++;
+    }
+    return NULL;
+}
+
+#ifdef CONTENT_X86
+
+// 向量实现同时比较每个候选位置的首字节和尾字节，两者都相等的位置才比较中间的 m - 2 个字节；
+// 首尾两个字节同时出现的概率很低，绝大多数块只需要两次读取和一次比较。调用者保证 m >= 2。
+// 两次读取都在 hay 的范围内，剩余不足一个块的部分交给逐字节实现。
+
+static const char *memmem_sse2(const char *hay, size_t n, const char *needle, size_t m)
+{
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= n; i += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(hay + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(hay + i + m - 1));
+        unsigned int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while (mask)
+        {
+            unsigned int bit = __builtin_ctz(mask);
+            if (memcmp(hay + i + bit + 1, needle + 1, m - 2) == 0)
+                return hay + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return memmem_scalar(hay + i, n - i, needle, m);
+}
+
+__attribute__((target("avx2"))) static const char *memmem_avx2(const char *hay, size_t n, const char *needle, size_t m)
+{
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 32 <= n; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(hay + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(hay + i + m - 1));
+        unsigned int mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        while (mask)
+        {
+            unsigned int bit = __builtin_ctz(mask);
+            if (memcmp(hay + i + bit + 1, needle + 1, m - 2) == 0)
+                return hay + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return memmem_scalar(hay + i, n - i, needle, m);
+}
+
+#endif
+
+static const char *(*memmem_impl)(const char *, size_t, const char *, size_t) = memmem_scalar;
+
+// 程序启动时选择当前 CPU 支持的最快实现
+__attribute__((constructor)) static void content_dispatch(void)
+{
+#ifdef CONTENT_X86
+    __builtin_cpu_init();
+    memmem_impl = __builtin_cpu_supports("avx2") ? memmem_avx2 : memmem_sse2;
+#endif
+}
+
+const char *content_memmem(const char *hay, size_t n, const char *needle, size_t m)
+{
+    if (m == 0)
+        return hay;
+    if (n < m)
+        return NULL;
+    if (m == 1)
+        return memchr(hay, needle[0], n);
+    return memmem_impl(hay, n, needle, m);
+}
+
+int content_compile_regex(struct content_pattern *p, const char *pattern)
+{
+    char msg[256];
+    int err;
+    p->regex = malloc(sizeof(regex_t));
+    if (!p->regex)
+    {
+        perror("malloc");
+        return 1;
+    }
+    err = regcomp(p->regex, pattern, REG_EXTENDED | REG_NOSUB | REG_NEWLINE);
+    if (err)
+    {
+        regerror(err, p->regex, msg, sizeof(msg));
+        fprintf(stderr, "-contains-regex : invalid regular expression \'%s\' : %s\n", pattern, msg);
+        free(p->regex);
+        p->regex = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+void content_free(struct content_pattern *p)
+{
+    if (!p->regex)
+        return;
+    regfree(p->regex);
+    free(p->regex);
+    p->regex = NULL;
+}
+
+// 保证缓冲区至少有 size 个字节，保留已有的内容
+static int reserve(size_t size)
+{
+    char *b;
+    if (buf_cap >= size)
+        return 0;
+    b = realloc(buf, size);
+    if (!b)
+        return -1;
+    buf = b;
+    buf_cap = size;
+    return 0;
+}
+
+// 在 buf 的前 len 个字节中查找；正则表达式按行匹配，REG_STARTEND 使内容不需要以 '\0' 结尾
+static int search(const struct content_pattern *p, size_t len)
+{
+    regmatch_t m;
+    if (!p->regex)
+        return content_memmem(buf, len, p->needle, p->len) != NULL;
+    m.rm_so = 0;
+    m.rm_eo = len;
+    return regexec(p->regex, buf, 1, &m, REG_STARTEND) == 0;
+}
+
+// 最后一个换行符之后的位置，没有换行符时为 0
+static size_t line_end(size_t len)
+{
+    while (len && buf[len - 1] != '\n')
+        len--;
+    return len;
+}
+
+int content_match(int dirfd, const char *name, const struct content_pattern *p)
+{
+    size_t len = 0, end, keep;
+    ssize_t got;
+    int fd, found = 0, first = 1;
+    if (reserve(CONTENT_BUF_SIZE > 2 * p->len ? CONTENT_BUF_SIZE : 2 * p->len))
+        return -1;
+    fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC | O_NOCTTY);
+    if (fd == -1)
+        return -1;
+    for (;;)
+    {
+        got = read(fd, buf + len, buf_cap - len);
+        if (got == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            found = -1;
+            break;
+        }
+        stats_local.scanned += got;
+        if (first && got)
+        {
+            first = 0;
+            if (p->skip_binary && memchr(buf, '\0', got < CONTENT_BINARY_PROBE ? got : CONTENT_BINARY_PROBE))
+                break;
+            // 第一次读取就填满缓冲区的大文件，让内核加大预读
+            if ((size_t)got == buf_cap)
+                posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+        len += got;
+        if (got == 0)
+        {
+            // 文件末尾：最后一行可能没有换行符，空的剩余部分不是一行
+            if (p->regex)
+                found = len && search(p, len - (buf[len - 1] == '\n'));
+            else
+                found = search(p, len);
+            break;
+        }
+        if (len < buf_cap)
+            continue;
+        // 缓冲区已满：查找后只保留可能与下一次读取的内容组成匹配的部分
+        if (p->regex)
+        {
+            end = line_end(len);
+            if (end && search(p, end - 1))
+            {
+                found = 1;
+                break;
+            }
+            keep = len - end;
+            if (keep == buf_cap && reserve(buf_cap * 2))
+            {
+                found = -1;
+                break;
+            }
+        }
+        else
+        {
+            if (search(p, len))
+            {
+                found = 1;
+                break;
+            }
+            keep = p->len ? p->len - 1 : 0;
+            end = len - keep;
+        }
+        memmove(buf, buf + end, keep);
+        len = keep;
+    }
+    close(fd);
+    return found;
+}
+
+void content_release(void)
+{
+    free(buf);
+    buf = NULL;
+    buf_cap = 0;
+}
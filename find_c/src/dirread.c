@@ -0,0 +1,138 @@
+#include "dirread.h"
+#include "stats.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+// getdents64 缓冲区的初始容量
+#define DIRBUF_MIN (32 * 1024)
+
+#ifdef SYS_getdents64
+// 内核返回的目录项格式，glibc 没有公开该结构体
+struct linux_dirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+#endif
+
+int dir_open(struct dir_reader *r, int fd, size_t max)
+{
+    r->fd = fd;
+    r->di = NULL;
+    r->buf = NULL;
+    r->size = 0;
+    r->max = max < DIRBUF_MIN ? DIRBUF_MIN : max;
+    r->len = 0;
+    r->pos = 0;
+    r->eof = 0;
+    r->batches = 0;
+#ifdef SYS_getdents64
+    if (max)
+    {
+        r->size = DIRBUF_MIN;
+        r->buf = malloc(r->size);
+        STATS_INC(dirs);
+        return 0;
+    }
+#endif
+    r->di = fdopendir(fd);
+    if (!r->di)
+    {
+        int e = errno;
+        close(fd);
+        errno = e;
+        return -1;
+    }
+    STATS_INC(dirs);
+    return 0;
+}
+
+static int is_dot(const char *name)
+{
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+#ifdef SYS_getdents64
+// 读取下一批目录项，返回 0 表示目录已读完
+static int refill(struct dir_reader *r)
+{
+    // 上一批几乎填满了缓冲区，说明目录很大，扩大缓冲区以减少系统调用
+    if (r->len + 512 > r->size && r->size < r->max)
+    {
+        size_t size = r->size * 2 > r->max ? r->max : r->size * 2;
+        char *buf = malloc(size);
+        if (buf)
+        {
+            free(r->buf);
+            r->buf = buf;
+            r->size = size;
+        }
+    }
+    long n = syscall(SYS_getdents64, r->fd, r->buf, r->size);
+    // 内核不支持 getdents64 时退回 readdir
+    if (n < 0 && errno == ENOSYS && !r->batches && (r->di = fdopendir(r->fd)) != NULL)
+        return 0;
+    r->batches++;
+    if (n <= 0)
+    {
+        r->eof = 1;
+        r->len = 0;
+        return 0;
+    }
+    r->len = n;
+    r->pos = 0;
+    return 1;
+}
+#endif
+
+int dir_next(struct dir_reader *r, struct dir_entry *e)
+{
+    if (r->di)
+    {
+        struct dirent *dir;
+        while ((dir = readdir(r->di)) != NULL)
+        {
+            if (is_dot(dir->d_name))
+                continue;
+            e->name = dir->d_name;
+            e->type = dir->d_type;
+            STATS_INC(entries);
+            return 1;
+        }
+        return 0;
+    }
+#ifdef SYS_getdents64
+    while (!r->eof)
+    {
+        if (r->pos >= r->len && !refill(r))
+            return r->di ? dir_next(r, e) : 0;
+        struct linux_dirent64 *ent = (struct linux_dirent64 *)(r->buf + r->pos);
+        r->pos += ent->d_reclen;
+        if (is_dot(ent->d_name))
+            continue;
+        e->name = ent->d_name;
+        e->type = ent->d_type;
+        STATS_INC(entries);
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+void dir_close(struct dir_reader *r)
+{
+    if (r->di)
+        closedir(r->di);
+    else
+        close(r->fd);
+    free(r->buf);
+}
@@ -0,0 +1,420 @@
+#include "dupes.h"
+#include "lib/lib_str.h"
+#include "stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// xxHash64：每次处理 32 字节的四路累加，最后混合剩余的字节
+
+#define P1 0x9E3779B185EBCA87ULL
+#define P2 0xC2B2AE3D27D4EB4FULL
+#define P3 0x165667B19E3779F9ULL
+#define P4 0x85EBCA77C2B2AE63ULL
+#define P5 0x27D4EB2F165667C5ULL
+
+struct xxh64
+{
+    uint64_t v[4];
+    uint64_t total;
+    unsigned char mem[32];
+    size_t memsize;
+};
+
+static uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t read64(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t read32(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t xxh_round(uint64_t acc, uint64_t input)
+{
+    acc += input * P2;
+    return rotl(acc, 31) * P1;
+}
+
+static uint64_t xxh_merge(uint64_t acc, uint64_t v)
+{
+    acc ^= xxh_round(0, v);
+    return acc * P1 + P4;
+}
+
+static void xxh64_init(struct xxh64 *s)
+{
+    s->v[0] = P1 + P2;
+    s->v[1] = P2;
+    s->v[2] = 0;
+    s->v[3] = -P1;
+    s->total = 0;
+    s->memsize = 0;
+}
+
+static void xxh64_stripe(struct xxh64 *s, const unsigned char *p)
+{
+    for (int i = 0; i < 4; i++)
+        s->v[i] = xxh_round(s->v[i], read64(p + 8 * i));
+}
+
+static void xxh64_update(struct xxh64 *s, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    size_t fill;
+    s->total += len;
+    // 先补满上次剩下的不足 32 字节的部分
+    if (s->memsize)
+    {
+        fill = 32 - s->memsize < len ? 32 - s->memsize : len;
+        memcpy(s->mem + s->memsize, p, fill);
+        s->memsize += fill;
+        p += fill;
+        len -= fill;
+        if (s->memsize < 32)
+            return;
+        xxh64_stripe(s, s->mem);
+        s->memsize = 0;
+    }
+    for (; len >= 32; p += 32, len -= 32)
+        xxh64_stripe(s, p);
+    memcpy(s->mem, p, len);
+    s->memsize = len;
+}
+
+static uint64_t xxh64_digest(const struct xxh64 *s)
+{
+    const unsigned char *p = s->mem;
+    size_t len = s->memsize;
+    uint64_t h;
+    if (s->total >= 32)
+    {
+        h = rotl(s->v[0], 1) + rotl(s->v[1], 7) + rotl(s->v[2], 12) + rotl(s->v[3], 18);
+        for (int i = 0; i < 4; i++)
+            h = xxh_merge(h, s->v[i]);
+    }
+    else
+        h = s->v[2] + P5;
+    h += s->total;
+    for (; len >= 8; p += 8, len -= 8)
+        h = rotl(h ^ xxh_round(0, read64(p)), 27) * P1 + P4;
+    if (len >= 4)
+    {
+        h = rotl(h ^ (uint64_t)read32(p) * P1, 23) * P2 + P3;
+        p += 4;
+        len -= 4;
+    }
+    for (; len; p++, len--)
+        h = rotl(h ^ *p * P5, 11) * P1;
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+struct dupes *dupes_create(void)
+{
+    struct dupes *dp = calloc(1, sizeof(struct dupes));
+    if (dp)
+        pthread_mutex_init(&dp->lock, NULL);
+    return dp;
+}
+
+// 释放 [from, to) 中文件的路径
+static void free_paths(struct dupes *dp, size_t from, size_t to)
+{
+    for (size_t i = from; i < to; i++)
+        free(dp->files[i].path);
+}
+
+void dupes_destroy(struct dupes *dp)
+{
+    if (!dp)
+        return;
+    free_paths(dp, 0, dp->count);
+    free(dp->files);
+    pthread_mutex_destroy(&dp->lock);
+    free(dp);
+}
+
+void dupes_add(struct data *d, struct node *n)
+{
+    struct dupes *dp = d->dupes;
+    struct dupe_file *f;
+    int follow = d->option == 2;
+    mode_t mode = follow ? node_r_type(n) : node_ftype(n);
+    // 空文件彼此都相同，不作为重复文件输出
+    if (!S_ISREG(mode) || node_attr(n, d->attr_mask, follow) || n->size == 0)
+        return;
+    pthread_mutex_lock(&dp->lock);
+    if (dp->count == dp->capacity)
+    {
+        size_t cap = dp->capacity ? dp->capacity * 2 : 1024;
+        f = realloc(dp->files, cap * sizeof(struct dupe_file));
+        if (!f)
+        {
+            pthread_mutex_unlock(&dp->lock);
+            perror("realloc");
+            exit(1);
+        }
+        dp->files = f;
+        dp->capacity = cap;
+    }
+    f = &dp->files[dp->count];
+    f->path = my_strcp(n->name);
+    f->size = n->size;
+    f->dev = n->dev;
+    f->ino = n->ino;
+    f->head = 0;
+    f->full = 0;
+    f->order = dp->count++;
+    f->err = 0;
+    pthread_mutex_unlock(&dp->lock);
+}
+
+// 读取 [off, off + len) 加入散列，返回实际读到的字节数；出错时返回 -1
+static ssize_t hash_range(int fd, struct xxh64 *s, char *buf, size_t cap, off_t off, size_t len)
+{
+    ssize_t got;
+    size_t total = 0;
+    while (total < len)
+    {
+        got = pread(fd, buf, len - total < cap ? len - total : cap, off + total);
+        if (got == -1 && errno == EINTR)
+            continue;
+        if (got == -1)
+            return -1;
+        if (got == 0)
+            break;
+        xxh64_update(s, buf, got);
+        total += got;
+    }
+    stats_local.scanned += total;
+    return total;
+}
+
+// 第二阶段只读取开头和结尾，第三阶段读取全部内容；文件在遍历之后变短时按读到的内容计算
+static void hash_file(struct dupe_file *f, int full, char *buf)
+{
+    struct xxh64 s;
+    ssize_t r;
+    int fd = open(f->path, O_RDONLY | O_CLOEXEC | O_NOCTTY);
+    if (fd == -1)
+    {
+        f->err = errno;
+        return;
+    }
+    xxh64_init(&s);
+    if (full)
+    {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        r = hash_range(fd, &s, buf, DUPES_BUF_SIZE, 0, f->size);
+    }
+    else if (f->size <= 2 * DUPES_PROBE)
+        r = hash_range(fd, &s, buf, DUPES_BUF_SIZE, 0, f->size);
+    else if ((r = hash_range(fd, &s, buf, DUPES_BUF_SIZE, 0, DUPES_PROBE)) != -1)
+        r = hash_range(fd, &s, buf, DUPES_BUF_SIZE, f->size - DUPES_PROBE, DUPES_PROBE);
+    if (r == -1)
+        f->err = errno;
+    else if (full)
+        f->full = xxh64_digest(&s);
+    else
+        f->head = xxh64_digest(&s);
+    close(fd);
+}
+
+struct hash_job
+{
+    struct dupe_file **work; // 需要读取的文件
+    size_t count;            // work 中的文件数
+    size_t next;             // 下一个要读取的下标，各线程原子地领取
+    int full;                // 是否读取全部内容
+};
+
+static void *hash_worker(void *arg)
+{
+    struct hash_job *job = arg;
+    char *buf = malloc(DUPES_BUF_SIZE);
+    size_t i;
+    if (!buf)
+    {
+        perror("malloc");
+        exit(1);
+    }
+    while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->count)
+        hash_file(job->work[i], job->full, buf);
+    free(buf);
+    // 线程局部的计数器在线程结束后失效
+    stats_merge();
+    return NULL;
+}
+
+// 用 jobs 个线程读取 work 中的文件；只有一个线程时在当前线程中读取
+static void hash_all(struct dupe_file **work, size_t count, int full, int jobs)
+{
+    struct hash_job job = {work, count, 0, full};
+    pthread_t *threads;
+    int started = 0;
+    if ((size_t)jobs > count)
+        jobs = count;
+    if (jobs <= 1)
+    {
+        hash_worker(&job);
+        return;
+    }
+    threads = malloc(jobs * sizeof(pthread_t));
+    for (; threads && started < jobs; started++)
+        if (pthread_create(&threads[started], NULL, hash_worker, &job))
+            break;
+    // 线程创建失败时由当前线程完成剩余的文件
+    if (started == 0)
+        hash_worker(&job);
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+}
+
+// 按大小、两级散列、(dev, ino) 和加入顺序排序，当前判断为内容相同的文件相邻，同一 inode 的硬链接相邻
+static int cmp_file(const void *a, const void *b)
+{
+    const struct dupe_file *x = a, *y = b;
+    if (x->size != y->size)
+        return x->size < y->size ? -1 : 1;
+    if (x->head != y->head)
+        return x->head < y->head ? -1 : 1;
+    if (x->full != y->full)
+        return x->full < y->full ? -1 : 1;
+    if (x->dev != y->dev)
+        return x->dev < y->dev ? -1 : 1;
+    if (x->ino != y->ino)
+        return x->ino < y->ino ? -1 : 1;
+    return x->order < y->order ? -1 : x->order > y->order;
+}
+
+// 输出顺序：较大的文件在前，同一组内按加入顺序
+static int cmp_output(const void *a, const void *b)
+{
+    const struct dupe_file *x = a, *y = b;
+    if (x->size != y->size)
+        return x->size > y->size ? -1 : 1;
+    if (x->head != y->head)
+        return x->head < y->head ? -1 : 1;
+    if (x->full != y->full)
+        return x->full < y->full ? -1 : 1;
+    return x->order < y->order ? -1 : x->order > y->order;
+}
+
+static int same_content(const struct dupe_file *x, const struct dupe_file *y)
+{
+    return x->size == y->size && x->head == y->head && x->full == y->full;
+}
+
+static int same_inode(const struct dupe_file *x, const struct dupe_file *y)
+{
+    return x->dev == y->dev && x->ino == y->ino;
+}
+
+// 只保留至少包含两个不同 inode 的组，返回需要读取的文件（每个 inode 的第一个硬链接）的数量；
+// full 为 1 时只读取在第二阶段没有读取全部内容的文件
+static size_t keep_groups(struct dupes *dp, struct dupe_file **work, int full)
+{
+    struct dupe_file *f = dp->files;
+    size_t kept = 0, count = 0, i = 0, j, inodes;
+    while (i < dp->count)
+    {
+        inodes = 1;
+        for (j = i + 1; j < dp->count && same_content(&f[i], &f[j]); j++)
+            inodes += !same_inode(&f[j - 1], &f[j]);
+        if (inodes < 2)
+        {
+            free_paths(dp, i, j);
+            i = j;
+            continue;
+        }
+        for (; i < j; i++)
+            f[kept++] = f[i];
+    }
+    dp->count = kept;
+    for (i = 0; work && i < kept; i++)
+        if ((!i || !same_inode(&f[i - 1], &f[i])) && (!full || f[i].size > 2 * DUPES_PROBE))
+            work[count++] = &f[i];
+    return count;
+}
+
+// 硬链接使用第一个链接的结果，读取失败的文件输出错误并去掉；返回是否有文件读取失败
+static int spread(struct dupes *dp)
+{
+    struct dupe_file *f = dp->files;
+    size_t kept = 0;
+    int failed = 0;
+    for (size_t i = 0; i < dp->count; i++)
+    {
+        if (i && same_inode(&f[i - 1], &f[i]))
+        {
+            f[i].head = f[i - 1].head;
+            f[i].full = f[i - 1].full;
+            f[i].err = f[i - 1].err;
+        }
+        if (f[i].err)
+        {
+            fprintf(stderr, "\'%s\' : %s\n", f[i].path, strerror(f[i].err));
+            failed = 1;
+            free(f[i].path);
+            continue;
+        }
+        f[kept++] = f[i];
+    }
+    // 读取失败的文件已经从数组中去掉，它的硬链接在上面复制 err 时也被去掉
+    dp->count = kept;
+    return failed;
+}
+
+int dupes_run(struct data *d)
+{
+    struct dupes *dp = d->dupes;
+    struct dupe_file **work;
+    size_t count;
+    int failed = 0;
+    work = malloc((dp->count ? dp->count : 1) * sizeof(struct dupe_file *));
+    if (!work)
+    {
+        perror("malloc");
+        return 1;
+    }
+    // 第一阶段：大小相同；第二阶段：开头和结尾相同；第三阶段：全部内容相同
+    for (int stage = 0; stage < 2; stage++)
+    {
+        qsort(dp->files, dp->count, sizeof(struct dupe_file), cmp_file);
+        count = keep_groups(dp, work, stage);
+        hash_all(work, count, stage, d->jobs);
+        failed |= spread(dp);
+    }
+    qsort(dp->files, dp->count, sizeof(struct dupe_file), cmp_file);
+    keep_groups(dp, NULL, 0);
+    free(work);
+    qsort(dp->files, dp->count, sizeof(struct dupe_file), cmp_output);
+    for (size_t i = 0; i < dp->count; i++)
+    {
+        print_path(d, dp->files[i].path, '\n');
+        if (i + 1 == dp->count || !same_content(&dp->files[i], &dp->files[i + 1]))
+            print_path(d, "", '\n');
+    }
+    return failed;
+}
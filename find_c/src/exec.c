@@ -0,0 +1,247 @@
+#include "exec.h"
+#include "lib/lib_str.h"
+#include "stats.h"
+
+#include <limits.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+size_t exec_arg_limit(void)
+{
+    long max = sysconf(_SC_ARG_MAX);
+    size_t env = 0;
+    if (max <= 0)
+        max = _POSIX_ARG_MAX;
+    // 环境变量与参数共享同一块空间
+    for (char **e = environ; *e; e++)
+        env += strlen(*e) + 1 + sizeof(char *);
+    if ((size_t)max < env + EXEC_HEADROOM + _POSIX_ARG_MAX)
+        return _POSIX_ARG_MAX;
+    return (size_t)max - env - EXEC_HEADROOM;
+}
+
+struct proc_pool *procs_create(int max)
+{
+    struct proc_pool *p = calloc(1, sizeof(struct proc_pool));
+    p->max = max;
+    p->children = calloc(max ? max : 1, sizeof(struct child));
+    p->fds = calloc(max ? max : 1, sizeof(struct pollfd));
+    pthread_mutex_init(&p->lock, NULL);
+    return p;
+}
+
+// 启动命令，不等待其结束；失败时输出错误信息并返回 -1
+static pid_t spawn(char **argv)
+{
+    pid_t pid;
+    int err;
+    // 使之前打印的路径出现在子进程输出之前
+    fflush(stdout);
+    // posix_spawnp 使用 vfork 语义创建子进程，不复制父进程的页表
+    err = posix_spawnp(&pid, argv[0], NULL, NULL, argv, environ);
+    if (err)
+    {
+        fprintf(stderr, "\'%s\' : %s\n", argv[0], strerror(err));
+        return -1;
+    }
+    STATS_INC(spawns);
+    return pid;
+}
+
+static int open_pidfd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    return -1;
+#endif
+}
+
+// 子进程已经结束：批处理以非 0 状态退出时记录失败，调用者持有锁
+static void finish(struct proc_pool *p, struct child *c, int status)
+{
+    if (c->batch && (!WIFEXITED(status) || WEXITSTATUS(status) != 0))
+        p->failed = 1;
+    if (c->pidfd != -1)
+        close(c->pidfd);
+}
+
+// 回收已经结束的子进程；池是满的时等待至少一个结束，调用者持有锁
+static void reap(struct proc_pool *p)
+{
+    int status;
+    int kept = 0;
+    int polled = 1; // 所有子进程都有 pidfd，可以用一次 poll 找出已经结束的子进程
+    for (int i = 0; i < p->count; i++)
+    {
+        p->fds[i].fd = p->children[i].pidfd;
+        p->fds[i].events = POLLIN;
+        p->fds[i].revents = 0;
+        if (p->children[i].pidfd == -1)
+            polled = 0;
+    }
+    if (polled && poll(p->fds, p->count, p->count == p->max ? -1 : 0) == -1)
+        polled = 0;
+    for (int i = 0; i < p->count; i++)
+    {
+        struct child *c = &p->children[i];
+        if ((!polled || (p->fds[i].revents & (POLLIN | POLLHUP))) && waitpid(c->pid, &status, WNOHANG) == c->pid)
+            finish(p, c, status);
+        else
+            p->children[kept++] = *c;
+    }
+    p->count = kept;
+    // 没有 pidfd 或 poll 被中断时，等待最早启动的子进程
+    if (p->count == p->max)
+    {
+        if (waitpid(p->children[0].pid, &status, 0) == p->children[0].pid)
+            finish(p, &p->children[0], status);
+        p->count--;
+        memmove(p->children, p->children + 1, p->count * sizeof(struct child));
+    }
+}
+
+int exec_run(char **argv)
+{
+    int status;
+    uint64_t start = stats_now();
+    pid_t pid = spawn(argv);
+    int ok = pid != -1 && waitpid(pid, &status, 0) == pid;
+    stats_local.exec_ns += stats_now() - start;
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+void procs_spawn(struct proc_pool *p, char **argv, int batch)
+{
+    pid_t pid;
+    int ok;
+    uint64_t start;
+    // 同步模式：等待子进程结束，期间不持有锁，其他线程的命令可以同时运行
+    if (!p->max)
+    {
+        ok = exec_run(argv);
+        if (batch && !ok)
+        {
+            pthread_mutex_lock(&p->lock);
+            p->failed = 1;
+            pthread_mutex_unlock(&p->lock);
+        }
+        return;
+    }
+    // 持有锁直到新的子进程加入池中，保证同时运行的数量不超过上限
+    start = stats_now();
+    pthread_mutex_lock(&p->lock);
+    reap(p);
+    pid = spawn(argv);
+    if (pid == -1)
+        p->failed |= batch;
+    else
+    {
+        p->children[p->count].pid = pid;
+        p->children[p->count].pidfd = open_pidfd(pid);
+        p->children[p->count].batch = batch;
+        p->count++;
+    }
+    pthread_mutex_unlock(&p->lock);
+    stats_local.exec_ns += stats_now() - start;
+}
+
+int procs_wait_all(struct proc_pool *p)
+{
+    int status;
+    int failed;
+    uint64_t start = stats_now();
+    pthread_mutex_lock(&p->lock);
+    for (int i = 0; i < p->count; i++)
+    {
+        struct child *c = &p->children[i];
+        if (waitpid(c->pid, &status, 0) == c->pid)
+            finish(p, c, status);
+    }
+    p->count = 0;
+    failed = p->failed;
+    pthread_mutex_unlock(&p->lock);
+    stats_local.exec_ns += stats_now() - start;
+    return failed;
+}
+
+void procs_destroy(struct proc_pool *p)
+{
+    if (!p)
+        return;
+    procs_wait_all(p);
+    free(p->children);
+    free(p->fds);
+    pthread_mutex_destroy(&p->lock);
+    free(p);
+}
+
+void batch_init(struct batch *b, char **args, size_t limit)
+{
+    b->fixed = 0;
+    b->bytes = sizeof(char *); // 结尾的 NULL
+    // 最后一个参数是 {}，由文件路径代替
+    while (args[b->fixed + 1])
+    {
+        b->bytes += my_strlen(args[b->fixed]) + 1 + sizeof(char *);
+        b->fixed++;
+    }
+    b->cap = b->fixed + 16;
+    b->argv = calloc(b->cap, sizeof(char *));
+    memcpy(b->argv, args, b->fixed * sizeof(char *));
+    b->argc = b->fixed;
+    b->limit = limit;
+}
+
+int batch_fits(struct batch *b, char *path)
+{
+    return b->argc == b->fixed || b->bytes + my_strlen(path) + 1 + sizeof(char *) <= b->limit;
+}
+
+void batch_add(struct batch *b, char *path)
+{
+    size_t cost = my_strlen(path) + 1 + sizeof(char *);
+    // 保留一个位置给结尾的 NULL
+    if (b->argc + 1 >= b->cap)
+    {
+        b->cap *= 2;
+        b->argv = realloc(b->argv, b->cap * sizeof(char *));
+    }
+    b->argv[b->argc++] = my_strcp(path);
+    b->bytes += cost;
+}
+
+// 释放累积的路径，保留命令和固定参数
+static void batch_clear(struct batch *b)
+{
+    for (size_t i = b->fixed; i < b->argc; i++)
+    {
+        b->bytes -= my_strlen(b->argv[i]) + 1 + sizeof(char *);
+        free(b->argv[i]);
+    }
+    b->argc = b->fixed;
+}
+
+void batch_flush(struct batch *b, struct proc_pool *p)
+{
+    if (b->argc == b->fixed)
+        return;
+    b->argv[b->argc] = NULL;
+    procs_spawn(p, b->argv, 1);
+    batch_clear(b);
+}
+
+void batch_free(struct batch *b)
+{
+    batch_clear(b);
+    free(b->argv);
+    b->argv = NULL;
+}
@@ -0,0 +1,500 @@
+#include "globmatch.h"
+#include "lib/lib_str.h"
+
+#include <ctype.h>
+#include <fnmatch.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 解析后的模式：依次匹配 m 个字节集合，loop[i] 表示匹配完前 i 个集合后可以再跳过任意字节（即 *）
+struct gpat
+{
+    unsigned char (*sets)[32];
+    unsigned char *loop;
+    size_t m;
+    size_t cap;
+};
+
+// 方括号表达式中的字符类
+static const struct
+{
+    const char *name;
+    int (*fn)(int);
+} char_classes[] = {
+    {"alnum", isalnum}, {"alpha", isalpha}, {"blank", isblank}, {"cntrl", iscntrl},
+    {"digit", isdigit}, {"graph", isgraph}, {"lower", islower}, {"print", isprint},
+    {"punct", ispunct}, {"space", isspace}, {"upper", isupper}, {"xdigit", isxdigit}};
+
+static void set_add(unsigned char *set, unsigned char c)
+{
+    set[c >> 3] |= 1 << (c & 7);
+}
+
+static int set_has(const unsigned char *set, unsigned char c)
+{
+    return (set[c >> 3] >> (c & 7)) & 1;
+}
+
+static void gpat_init(struct gpat *g)
+{
+    g->sets = NULL;
+    g->loop = calloc(1, 1);
+    g->m = 0;
+    g->cap = 0;
+}
+
+static void gpat_free(struct gpat *g)
+{
+    free(g->sets);
+    free(g->loop);
+}
+
+// 追加一个空的字节集合
+static unsigned char *gpat_push(struct gpat *g)
+{
+    if (g->m >= g->cap)
+    {
+        g->cap = g->cap ? g->cap * 2 : 8;
+        g->sets = realloc(g->sets, g->cap * sizeof(*g->sets));
+        g->loop = realloc(g->loop, g->cap + 1);
+    }
+    memset(g->sets[g->m], 0, sizeof(*g->sets));
+    g->m++;
+    g->loop[g->m] = 0;
+    return g->sets[g->m - 1];
+}
+
+// 解析 '[' 之后的方括号表达式，返回 ']' 之后的位置；未闭合或使用了不支持的语法时返回 NULL
+static const char *parse_bracket(const char *p, unsigned char *set)
+{
+    int neg = 0;
+    int first = 1;
+    unsigned char lo, hi;
+    if (*p == '!' || *p == '^')
+    {
+        neg = 1;
+        p++;
+    }
+    for (;;)
+    {
+        if (*p == '\0')
+            return NULL;
+        if (*p == ']' && !first)
+            break;
+        first = 0;
+        if (p[0] == '[' && p[1] == ':')
+        {
+            const char *end = strstr(p + 2, ":]");
+            size_t k, n = sizeof(char_classes) / sizeof(char_classes[0]);
+            if (!end)
+                return NULL;
+            for (k = 0; k < n; k++)
+                if (strlen(char_classes[k].name) == (size_t)(end - p - 2) && !strncmp(char_classes[k].name, p + 2, end - p - 2))
+                    break;
+            if (k == n)
+                return NULL;
+            for (int c = 0; c < 256; c++)
+                if (char_classes[k].fn(c))
+                    set_add(set, c);
+            p = end + 2;
+            continue;
+        }
+        // 等价类和排序元素只有 fnmatch 支持
+        if (p[0] == '[' && (p[1] == '=' || p[1] == '.'))
+            return NULL;
+        if (*p == '\\' && *++p == '\0')
+            return NULL;
+        lo = *p++;
+        if (p[0] == '-' && p[1] != ']' && p[1] != '\0')
+        {
+            p++;
+            if (*p == '[' || (*p == '\\' && *++p == '\0'))
+                return NULL;
+            hi = *p++;
+            if (lo > hi)
+                return NULL;
+            for (int c = lo; c <= hi; c++)
+                set_add(set, c);
+        }
+        else
+            set_add(set, lo);
+    }
+    if (neg)
+        for (int i = 0; i < 32; i++)
+            set[i] = ~set[i];
+    return p + 1;
+}
+
+// 解析通配符模式，语义与 fnmatch(pattern, name, 0) 相同；不支持时返回 -1
+static int parse_glob(const char *p, struct gpat *g)
+{
+    unsigned char *set;
+    while (*p)
+    {
+        if (*p == '*')
+        {
+            g->loop[g->m] = 1;
+            p++;
+        }
+        else if (*p == '?')
+        {
+            set = gpat_push(g);
+            memset(set, 0xff, 32);
+            p++;
+        }
+        else if (*p == '[')
+        {
+            set = gpat_push(g);
+            p = parse_bracket(p + 1, set);
+            if (!p)
+                return -1;
+        }
+        else
+        {
+            if (*p == '\\' && *++p == '\0')
+                return -1;
+            set = gpat_push(g);
+            set_add(set, *p);
+            p++;
+        }
+    }
+    return 0;
+}
+
+// 如果每个集合都只含一个字节且 * 只出现在首尾，返回去掉转义后的字面量
+static char *gpat_literal(struct gpat *g)
+{
+    char *lit = calloc(g->m + 1, 1);
+    for (size_t i = 0; i < g->m; i++)
+    {
+        int count = 0;
+        for (int c = 0; c < 256; c++)
+            if (set_has(g->sets[i], c))
+            {
+                lit[i] = c;
+                count++;
+            }
+        if (count != 1 || (i > 0 && g->loop[i]))
+        {
+            free(lit);
+            return NULL;
+        }
+    }
+    return lit;
+}
+
+// 子集构造：NFA 的状态集合用 W 个 64 位整数表示
+struct dfa_builder
+{
+    size_t total;           // NFA 状态数
+    size_t words;           // 每个状态集合占用的 64 位整数个数
+    unsigned char **elem;   // NFA 状态 s 读入一个字节后进入 s + 1 所需的字节集合，终止状态为 NULL
+    unsigned char *loop;    // NFA 状态 s 是否可以跳过任意字节
+    uint64_t *sets;         // 已发现的 DFA 状态对应的 NFA 状态集合
+    uint64_t *hashes;       // 每个 DFA 状态的集合哈希值
+    size_t nstates;
+    size_t capacity;
+};
+
+static uint64_t set_hash(uint64_t *set, size_t words)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < words; i++)
+    {
+        h ^= set[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// 查找或添加 DFA 状态，状态数超过上限时返回 -1
+static int builder_state(struct dfa_builder *b, uint64_t *set)
+{
+    uint64_t h = set_hash(set, b->words);
+    for (size_t i = 0; i < b->nstates; i++)
+        if (b->hashes[i] == h && !memcmp(&b->sets[i * b->words], set, b->words * sizeof(uint64_t)))
+            return i;
+    if (b->nstates >= GLOB_MAX_STATES)
+        return -1;
+    if (b->nstates >= b->capacity)
+    {
+        b->capacity = b->capacity ? b->capacity * 2 : 16;
+        b->sets = realloc(b->sets, b->capacity * b->words * sizeof(uint64_t));
+        b->hashes = realloc(b->hashes, b->capacity * sizeof(uint64_t));
+    }
+    memcpy(&b->sets[b->nstates * b->words], set, b->words * sizeof(uint64_t));
+    b->hashes[b->nstates] = h;
+    return b->nstates++;
+}
+
+static void builder_step(struct dfa_builder *b, uint64_t *from, unsigned char c, uint64_t *to)
+{
+    memset(to, 0, b->words * sizeof(uint64_t));
+    for (size_t s = 0; s < b->total; s++)
+    {
+        if (!((from[s >> 6] >> (s & 63)) & 1))
+            continue;
+        if (b->loop[s])
+            to[s >> 6] |= 1ULL << (s & 63);
+        if (b->elem[s] && set_has(b->elem[s], c))
+            to[(s + 1) >> 6] |= 1ULL << ((s + 1) & 63);
+    }
+}
+
+// 两个字节对所有 NFA 转移的行为是否相同
+static int same_class(struct dfa_builder *b, unsigned char x, unsigned char y)
+{
+    for (size_t s = 0; s < b->total; s++)
+        if (b->elem[s] && set_has(b->elem[s], x) != set_has(b->elem[s], y))
+            return 0;
+    return 1;
+}
+
+static void dfa_free(struct dfa *d)
+{
+    if (!d)
+        return;
+    free(d->trans);
+    free(d->accept);
+    free(d->flags);
+    free(d);
+}
+
+// 将多个模式合并为一个 DFA，状态数超过 GLOB_MAX_STATES 时返回 NULL
+static struct dfa *dfa_build(struct gpat *pats, size_t count)
+{
+    struct dfa_builder b;
+    struct dfa *d = calloc(1, sizeof(struct dfa));
+    unsigned char reps[256];
+    unsigned char *final;
+    uint64_t *cur, *next;
+    size_t trans_cap = 0;
+    size_t base = 0;
+    int ok = 1;
+
+    memset(&b, 0, sizeof(b));
+    for (size_t p = 0; p < count; p++)
+        b.total += pats[p].m + 1;
+    b.words = (b.total + 63) / 64;
+    b.elem = calloc(b.total, sizeof(unsigned char *));
+    b.loop = calloc(b.total, 1);
+    final = calloc(b.total, 1);
+    for (size_t p = 0; p < count; p++)
+    {
+        for (size_t i = 0; i <= pats[p].m; i++)
+        {
+            b.loop[base + i] = pats[p].loop[i];
+            if (i < pats[p].m)
+                b.elem[base + i] = pats[p].sets[i];
+        }
+        final[base + pats[p].m] = 1;
+        base += pats[p].m + 1;
+    }
+
+    // 字节等价类
+    for (int c = 0; c < 256; c++)
+    {
+        int k;
+        for (k = 0; k < d->nclasses; k++)
+            if (same_class(&b, c, reps[k]))
+                break;
+        if (k == d->nclasses)
+            reps[d->nclasses++] = c;
+        d->classes[c] = k;
+    }
+
+    // 状态 0 为空集合（死状态），初始状态包含每个模式的第一个 NFA 状态
+    cur = calloc(b.words, sizeof(uint64_t));
+    next = calloc(b.words, sizeof(uint64_t));
+    builder_state(&b, cur);
+    base = 0;
+    for (size_t p = 0; p < count; p++)
+    {
+        cur[base >> 6] |= 1ULL << (base & 63);
+        base += pats[p].m + 1;
+    }
+    d->start = builder_state(&b, cur);
+
+    for (size_t s = 0; ok && s < b.nstates; s++)
+    {
+        if (b.nstates * d->nclasses > trans_cap)
+        {
+            trans_cap = b.capacity * d->nclasses;
+            d->trans = realloc(d->trans, trans_cap * sizeof(int));
+        }
+        for (int k = 0; k < d->nclasses; k++)
+        {
+            memcpy(cur, &b.sets[s * b.words], b.words * sizeof(uint64_t));
+            builder_step(&b, cur, reps[k], next);
+            int t = builder_state(&b, next);
+            if (t < 0)
+            {
+                ok = 0;
+                break;
+            }
+            d->trans[s * d->nclasses + k] = t;
+        }
+    }
+
+    if (ok)
+    {
+        d->nstates = b.nstates;
+        d->accept = calloc(d->nstates, 1);
+        d->flags = calloc(d->nstates, 1);
+        d->flags[0] = DFA_DEAD;
+        for (size_t s = 0; s < b.nstates; s++)
+            for (size_t n = 0; n < b.total; n++)
+                if ((b.sets[s * b.words + (n >> 6)] >> (n & 63)) & 1 && final[n])
+                {
+                    d->accept[s] = 1;
+                    if (b.loop[n])
+                        d->flags[s] = DFA_ALL;
+                }
+    }
+    else
+    {
+        dfa_free(d);
+        d = NULL;
+    }
+    free(cur);
+    free(next);
+    free(final);
+    free(b.elem);
+    free(b.loop);
+    free(b.sets);
+    free(b.hashes);
+    return d;
+}
+
+static int dfa_run(struct dfa *d, const char *name)
+{
+    const unsigned char *p = (const unsigned char *)name;
+    int s = d->start;
+    if (d->flags[s])
+        return d->flags[s] == DFA_ALL;
+    for (; *p; p++)
+    {
+        s = d->trans[s * d->nclasses + d->classes[*p]];
+        if (d->flags[s])
+            return d->flags[s] == DFA_ALL;
+    }
+    return d->accept[s];
+}
+
+struct glob *glob_compile(const char *pattern)
+{
+    struct glob *g = calloc(1, sizeof(struct glob));
+    struct gpat gp;
+    int lead, trail;
+    g->pattern = my_strcp((char *)pattern);
+    gpat_init(&gp);
+    if (parse_glob(pattern, &gp) == -1)
+    {
+        g->kind = GLOB_FNMATCH;
+        gpat_free(&gp);
+        return g;
+    }
+    g->lit = gpat_literal(&gp);
+    if (g->lit)
+    {
+        g->len = gp.m;
+        lead = gp.loop[0];
+        trail = gp.m > 0 && gp.loop[gp.m];
+        if (gp.m == 0)
+            g->kind = lead ? GLOB_ANY : GLOB_EXACT;
+        else if (lead)
+            g->kind = trail ? GLOB_CONTAINS : GLOB_SUFFIX;
+        else
+            g->kind = trail ? GLOB_PREFIX : GLOB_EXACT;
+    }
+    else
+    {
+        g->dfa = dfa_build(&gp, 1);
+        g->kind = g->dfa ? GLOB_DFA : GLOB_FNMATCH;
+    }
+    gpat_free(&gp);
+    return g;
+}
+
+int glob_match(struct glob *g, const char *name)
+{
+    size_t n;
+    switch (g->kind)
+    {
+    case GLOB_EXACT:
+        return strcmp(name, g->lit) == 0;
+    case GLOB_PREFIX:
+        return strncmp(name, g->lit, g->len) == 0;
+    case GLOB_SUFFIX:
+        n = strlen(name);
+        return n >= g->len && memcmp(name + n - g->len, g->lit, g->len) == 0;
+    case GLOB_CONTAINS:
+        return strstr(name, g->lit) != NULL;
+    case GLOB_ANY:
+        return 1;
+    case GLOB_DFA:
+        return dfa_run(g->dfa, name);
+    default:
+        return !fnmatch(g->pattern, name, 0);
+    }
+}
+
+void glob_free(struct glob *g)
+{
+    if (!g)
+        return;
+    dfa_free(g->dfa);
+    free(g->lit);
+    free(g->pattern);
+    free(g);
+}
+
+struct globset *globset_compile(char **patterns, size_t count)
+{
+    struct globset *s = calloc(1, sizeof(struct globset));
+    struct gpat *pats = calloc(count, sizeof(struct gpat));
+    int ok = 1;
+    s->count = count;
+    for (size_t i = 0; i < count; i++)
+    {
+        gpat_init(&pats[i]);
+        if (parse_glob(patterns[i], &pats[i]) == -1)
+            ok = 0;
+    }
+    if (ok)
+        s->dfa = dfa_build(pats, count);
+    // 无法合并时逐个匹配
+    if (!s->dfa)
+    {
+        s->globs = calloc(count, sizeof(struct glob *));
+        for (size_t i = 0; i < count; i++)
+            s->globs[i] = glob_compile(patterns[i]);
+    }
+    for (size_t i = 0; i < count; i++)
+        gpat_free(&pats[i]);
+    free(pats);
+    return s;
+}
+
+int globset_match(struct globset *s, const char *name)
+{
+    if (s->dfa)
+        return dfa_run(s->dfa, name);
+    for (size_t i = 0; i < s->count; i++)
+        if (glob_match(s->globs[i], name))
+            return 1;
+    return 0;
+}
+
+void globset_free(struct globset *s)
+{
+    if (!s)
+        return;
+    dfa_free(s->dfa);
+    if (s->globs)
+        for (size_t i = 0; i < s->count; i++)
+            glob_free(s->globs[i]);
+    free(s->globs);
+    free(s);
+}
@@ -0,0 +1,891 @@
+#include "index.h"
+#include "dirread.h"
+#include "lib/lib_str.h"
+#include "stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 写入临时文件时使用的 stdio 缓冲区大小
+#define INDEX_IO_BUF (1024 * 1024)
+
+static size_t align8(size_t x)
+{
+    return (x + 7) & ~(size_t)7;
+}
+
+// 块头之后各列的偏移：5 个 uint64_t 列，mode 列，depth 列，最后是路径
+static size_t col_mode(size_t n)
+{
+    return 5 * n * sizeof(uint64_t);
+}
+
+static size_t col_depth(size_t n)
+{
+    return col_mode(n) + align8(n * sizeof(uint32_t));
+}
+
+static size_t col_paths(size_t n)
+{
+    return col_depth(n) + align8(n * sizeof(uint16_t));
+}
+
+int index_path_cmp(const char *a, size_t alen, const char *b, size_t blen)
+{
+    size_t n = alen < blen ? alen : blen;
+    size_t i = 0;
+    while (i < n && a[i] == b[i])
+        i++;
+    if (i == n)
+        return alen < blen ? -1 : alen > blen;
+    // '/' 排在最前面，使目录的子树紧跟在目录之后
+    if (a[i] == '/')
+        return -1;
+    if (b[i] == '/')
+        return 1;
+    return (unsigned char)a[i] - (unsigned char)b[i];
+}
+
+// path 是否在以 root 为根的子树中（不含 root 本身）
+static int in_subtree(const char *path, size_t len, const char *root, size_t rlen)
+{
+    return len > rlen && memcmp(path, root, rlen) == 0 && (root[rlen - 1] == '/' || path[rlen] == '/');
+}
+
+// 去掉路径末尾多余的 '/'，根目录保持不变
+static size_t strip_slashes(const char *path)
+{
+    size_t len = my_strlen((char *)path);
+    while (len > 1 && path[len - 1] == '/')
+        len--;
+    return len;
+}
+
+// 写入器
+
+static void put(struct index_writer *w, const void *p, size_t len)
+{
+    fwrite(p, 1, len, w->f);
+    w->off += len;
+}
+
+static void put_pad(struct index_writer *w)
+{
+    static const char zero[8];
+    put(w, zero, align8(w->off) - w->off);
+}
+
+static void put_varint(struct index_writer *w, uint64_t v)
+{
+    if (w->pa_size + 10 > w->pa_capacity)
+    {
+        w->pa_capacity = w->pa_capacity ? w->pa_capacity * 2 : 4096;
+        w->paths = realloc(w->paths, w->pa_capacity);
+    }
+    while (v >= 0x80)
+    {
+        w->paths[w->pa_size++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    w->paths[w->pa_size++] = (unsigned char)v;
+}
+
+static void flush_block(struct index_writer *w)
+{
+    struct index_block b = {(uint32_t)w->n, (uint32_t)w->pa_size};
+    uint64_t col[INDEX_BLOCK];
+    uint32_t mode[INDEX_BLOCK];
+    uint16_t depth[INDEX_BLOCK];
+    if (w->nblocks >= w->tb_capacity)
+    {
+        w->tb_capacity = w->tb_capacity ? w->tb_capacity * 2 : 1024;
+        w->table = realloc(w->table, w->tb_capacity * sizeof(uint64_t));
+    }
+    w->table[w->nblocks++] = w->off;
+    put(w, &b, sizeof(b));
+    for (int c = 0; c < 5; c++)
+    {
+        for (size_t i = 0; i < w->n; i++)
+        {
+            const struct index_rec *r = &w->recs[i];
+            col[i] = c == 0 ? r->size : c == 1 ? (uint64_t)r->mtime : c == 2 ? (uint64_t)r->ctime : c == 3 ? r->dev : r->ino;
+        }
+        put(w, col, w->n * sizeof(uint64_t));
+    }
+    for (size_t i = 0; i < w->n; i++)
+    {
+        mode[i] = w->recs[i].mode;
+        depth[i] = (uint16_t)w->recs[i].depth;
+    }
+    put(w, mode, w->n * sizeof(uint32_t));
+    put_pad(w);
+    put(w, depth, w->n * sizeof(uint16_t));
+    put_pad(w);
+    put(w, w->paths, w->pa_size);
+    put_pad(w);
+    w->n = 0;
+    w->pa_size = 0;
+}
+
+int index_writer_open(struct index_writer *w, char *path)
+{
+    struct index_header h;
+    memset(w, 0, sizeof(*w));
+    w->path = my_strcp(path);
+    w->tmp = malloc(my_strlen(path) + 5);
+    memcpy(w->tmp, path, my_strlen(path));
+    memcpy(w->tmp + my_strlen(path), ".tmp", 5);
+    if (!(w->f = fopen(w->tmp, "wb")))
+    {
+        int e = errno;
+        free(w->path);
+        free(w->tmp);
+        errno = e;
+        return -1;
+    }
+    setvbuf(w->f, NULL, _IOFBF, INDEX_IO_BUF);
+    // 文件头在关闭时才能填写，先占位
+    memset(&h, 0, sizeof(h));
+    put(w, &h, sizeof(h));
+    return 0;
+}
+
+int index_writer_add(struct index_writer *w, const struct index_rec *rec)
+{
+    size_t shared = 0;
+    if (rec->depth < 0 || rec->depth > UINT16_MAX)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    // 记录必须严格递增，否则二分查找和子树的跳过都会出错
+    if (w->count && index_path_cmp(w->prev, w->prev_len, rec->path, rec->len) >= 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (w->n)
+    {
+        while (shared < rec->len && shared < w->prev_len && w->prev[shared] == rec->path[shared])
+            shared++;
+    }
+    put_varint(w, shared);
+    put_varint(w, rec->len - shared);
+    if (w->pa_size + rec->len - shared > w->pa_capacity)
+    {
+        while (w->pa_size + rec->len - shared > w->pa_capacity)
+            w->pa_capacity *= 2;
+        w->paths = realloc(w->paths, w->pa_capacity);
+    }
+    memcpy(w->paths + w->pa_size, rec->path + shared, rec->len - shared);
+    w->pa_size += rec->len - shared;
+    if (rec->len + 1 > w->prev_capacity)
+    {
+        w->prev_capacity = rec->len + 1 > 2 * w->prev_capacity ? rec->len + 1 : 2 * w->prev_capacity;
+        w->prev = realloc(w->prev, w->prev_capacity);
+    }
+    memcpy(w->prev, rec->path, rec->len);
+    w->prev_len = rec->len;
+    w->recs[w->n++] = *rec;
+    w->count++;
+    if (w->n == INDEX_BLOCK)
+        flush_block(w);
+    return ferror(w->f) ? -1 : 0;
+}
+
+int index_writer_close(struct index_writer *w, int commit)
+{
+    struct index_header h;
+    int rv = 0;
+    if (commit)
+    {
+        if (w->n)
+            flush_block(w);
+        memcpy(h.magic, INDEX_MAGIC, sizeof(h.magic));
+        h.count = w->count;
+        h.nblocks = w->nblocks;
+        h.table = w->off;
+        put(w, w->table, w->nblocks * sizeof(uint64_t));
+        if (fseek(w->f, 0, SEEK_SET) == 0)
+            fwrite(&h, sizeof(h), 1, w->f);
+        if (fflush(w->f) || ferror(w->f))
+            rv = -1;
+    }
+    if (fclose(w->f))
+        rv = -1;
+    if (commit && rv == 0 && rename(w->tmp, w->path) == -1)
+        rv = -1;
+    if (!commit || rv)
+    {
+        int e = errno;
+        unlink(w->tmp);
+        errno = e;
+    }
+    free(w->path);
+    free(w->tmp);
+    free(w->table);
+    free(w->paths);
+    free(w->prev);
+    return commit ? rv : 0;
+}
+
+void index_rec_stat(struct index_rec *rec, const struct stat *sb)
+{
+    rec->mode = sb->st_mode;
+    rec->size = sb->st_size;
+    rec->mtime = (int64_t)sb->st_mtim.tv_sec * 1000000000 + sb->st_mtim.tv_nsec;
+    rec->ctime = (int64_t)sb->st_ctim.tv_sec * 1000000000 + sb->st_ctim.tv_nsec;
+    rec->dev = sb->st_dev;
+    rec->ino = sb->st_ino;
+}
+
+// 读取
+
+int index_open(struct index *ix, char *path)
+{
+    struct stat sb;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+    if (fstat(fd, &sb) == -1)
+    {
+        close(fd);
+        return -1;
+    }
+    ix->size = sb.st_size;
+    ix->map = ix->size >= sizeof(struct index_header) ? mmap(NULL, ix->size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (ix->map == MAP_FAILED)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    ix->head = (const struct index_header *)ix->map;
+    if (memcmp(ix->head->magic, INDEX_MAGIC, sizeof(ix->head->magic)) != 0 || ix->head->table % 8 || ix->head->table > ix->size ||
+        ix->head->nblocks > (ix->size - ix->head->table) / sizeof(uint64_t))
+    {
+        munmap(ix->map, ix->size);
+        errno = EINVAL;
+        return -1;
+    }
+    ix->table = (const uint64_t *)(ix->map + ix->head->table);
+    // 查询按顺序读取记录
+    madvise(ix->map, ix->size, MADV_SEQUENTIAL);
+    return 0;
+}
+
+void index_close(struct index *ix)
+{
+    munmap(ix->map, ix->size);
+}
+
+// 检查块的偏移和大小，返回块头；块损坏时返回 NULL
+static const struct index_block *block_at(const struct index *ix, uint64_t b)
+{
+    uint64_t off = ix->table[b];
+    const struct index_block *blk;
+    if (off % 8 || off < sizeof(struct index_header) || off + sizeof(struct index_block) > ix->head->table)
+        return NULL;
+    blk = (const struct index_block *)(ix->map + off);
+    if (blk->count == 0 || blk->count > INDEX_BLOCK || off + sizeof(*blk) + col_paths(blk->count) + blk->bytes > ix->head->table)
+        return NULL;
+    return blk;
+}
+
+static const unsigned char *get_varint(const unsigned char *p, const unsigned char *end, uint64_t *v)
+{
+    *v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7)
+    {
+        *v |= (uint64_t)(*p & 0x7f) << shift;
+        if (!(*p++ & 0x80))
+            return p;
+    }
+    return NULL;
+}
+
+void index_cursor_init(struct index_cursor *c, const struct index *ix, uint64_t block)
+{
+    c->ix = ix;
+    c->block = block;
+    c->i = 0;
+    c->n = 0;
+    c->blk = NULL;
+    c->bad = 0;
+    c->len = 0;
+    c->capacity = 256;
+    c->path = malloc(c->capacity);
+}
+
+void index_cursor_free(struct index_cursor *c)
+{
+    free(c->path);
+}
+
+int index_next(struct index_cursor *c, struct index_rec *rec)
+{
+    const char *cols;
+    uint64_t shared, rest;
+    size_t n;
+    if (c->i == c->n)
+    {
+        if (c->n)
+            c->block++;
+        if (c->block >= c->ix->head->nblocks)
+            return 0;
+        if (!(c->blk = block_at(c->ix, c->block)))
+        {
+            c->bad = 1;
+            return 0;
+        }
+        c->i = 0;
+        c->n = c->blk->count;
+        c->p = (const unsigned char *)(c->blk + 1) + col_paths(c->n);
+        c->end = c->p + c->blk->bytes;
+    }
+    c->p = get_varint(c->p, c->end, &shared);
+    if (c->p)
+        c->p = get_varint(c->p, c->end, &rest);
+    // 块中第一条路径不共享前缀，共享的部分不能超过上一条路径
+    if (!c->p || shared > (c->i ? c->len : 0) || rest > (uint64_t)(c->end - c->p))
+    {
+        c->n = c->i = 0;
+        c->block = c->ix->head->nblocks;
+        c->bad = 1;
+        return 0;
+    }
+    if (shared + rest + 1 > c->capacity)
+    {
+        while (shared + rest + 1 > c->capacity)
+            c->capacity *= 2;
+        c->path = realloc(c->path, c->capacity);
+    }
+    memcpy(c->path + shared, c->p, rest);
+    c->p += rest;
+    c->len = shared + rest;
+    c->path[c->len] = '\0';
+    n = c->n;
+    cols = (const char *)(c->blk + 1);
+    rec->path = c->path;
+    rec->len = c->len;
+    rec->size = ((const uint64_t *)cols)[c->i];
+    rec->mtime = (int64_t)((const uint64_t *)cols)[n + c->i];
+    rec->ctime = (int64_t)((const uint64_t *)cols)[2 * n + c->i];
+    rec->dev = ((const uint64_t *)cols)[3 * n + c->i];
+    rec->ino = ((const uint64_t *)cols)[4 * n + c->i];
+    rec->mode = ((const uint32_t *)(cols + col_mode(n)))[c->i];
+    rec->depth = ((const uint16_t *)(cols + col_depth(n)))[c->i];
+    c->i++;
+    return 1;
+}
+
+uint64_t index_seek(const struct index *ix, const char *path, size_t len)
+{
+    uint64_t lo = 0, hi = ix->head->nblocks, mid;
+    const struct index_block *blk;
+    const unsigned char *p, *end;
+    uint64_t shared, rest;
+    // 找到第一条路径在 path 之后的第一个块，返回它的前一个块
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (!(blk = block_at(ix, mid)))
+            return mid;
+        p = (const unsigned char *)(blk + 1) + col_paths(blk->count);
+        end = p + blk->bytes;
+        if (!(p = get_varint(p, end, &shared)) || !(p = get_varint(p, end, &rest)) || rest > (uint64_t)(end - p))
+            return mid;
+        if (index_path_cmp((const char *)p, rest, path, len) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo ? lo - 1 : 0;
+}
+
+// --build-index 和 --refresh-index
+
+/**
+ * 建立或刷新索引的状态。刷新时 `old` 是旧索引中下一条还没有处理的记录，与写入的新记录按相同的顺序前进；
+ * 建立索引时没有旧索引，`valid` 总是为 0。
+ */
+struct builder
+{
+    struct data *d;
+    struct index_writer w;
+    struct index_cursor c;
+    struct index_rec old;
+    int valid;
+};
+
+static void old_next(struct builder *b)
+{
+    b->valid = b->valid && index_next(&b->c, &b->old);
+}
+
+// 跳过旧索引中比 depth 深的记录，即刚处理完的目录项的子树
+static void old_skip(struct builder *b, int depth)
+{
+    while (b->valid && b->old.depth > depth)
+        old_next(b);
+}
+
+// 旧记录的名称，dir 是它所在目录的路径
+static char *old_name(struct builder *b, char *dir, size_t dlen)
+{
+    return b->old.path + dlen + (dir[dlen - 1] != '/');
+}
+
+// 目录的 mtime 和 ctime 与旧记录相同时，目录中的名称没有变化
+static int same_time(const struct index_rec *prev, const struct stat *sb)
+{
+    struct index_rec rec;
+    index_rec_stat(&rec, sb);
+    return S_ISDIR(prev->mode) && prev->mtime == rec.mtime && prev->ctime == rec.ctime;
+}
+
+static int name_cmp(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int add_entry(struct index_writer *w, char *path, size_t len, int depth, struct stat *sb)
+{
+    struct index_rec rec;
+    rec.path = path;
+    rec.len = len;
+    rec.depth = depth;
+    index_rec_stat(&rec, sb);
+    return index_writer_add(w, &rec);
+}
+
+static int update_dir(struct builder *b, int fd, char *path, size_t len, int depth, int changed);
+
+// 写入目录 path 中的目录项 name；matched 表示旧索引正位于同名的记录。写入失败返回 -1
+static int update_entry(struct builder *b, int fd, char *path, size_t len, char *name, int depth, int matched)
+{
+    struct data *d = b->d;
+    struct index_rec prev = {0};
+    struct stat sb;
+    char *child = arena_path(&d->arena, path, len, name);
+    int sub;
+    if (matched)
+    {
+        prev = b->old;
+        old_next(b);
+    }
+    STATS_INC(lstats);
+    if (fstatat(fd, name, &sb, AT_SYMLINK_NOFOLLOW) == -1)
+    {
+        fprintf(stderr, "\'%s\' : %s\n", child, strerror(errno));
+        d->return_value = 1;
+        old_skip(b, depth);
+        return 0;
+    }
+    if (add_entry(&b->w, child, my_strlen(child), depth, &sb))
+        return -1;
+    if (!S_ISDIR(sb.st_mode) || (sub = open_subdir(d, fd, name, child)) == -1)
+    {
+        old_skip(b, depth);
+        return 0;
+    }
+    return update_dir(b, sub, child, my_strlen(child), depth + 1, !matched || !same_time(&prev, &sb));
+}
+
+// 写入目录 path 中的目录项，fd 由函数关闭；depth 为目录项的深度，旧索引位于该目录的第一个目录项（如果有）。
+// changed 为 0 时目录中的名称与旧索引相同，不读取目录而是复制旧记录，只对子目录调用 fstatat 检查它们是否变化；
+// 否则读出目录中的所有名称并排序，与旧索引中的名称合并。写入失败返回 -1
+static int update_dir(struct builder *b, int fd, char *path, size_t len, int depth, int changed)
+{
+    struct data *d = b->d;
+    struct dir_reader r;
+    struct dir_entry e;
+    struct arena_mark m = arena_mark(&d->arena);
+    struct arena_mark entry;
+    char **names = NULL;
+    size_t size = 0, capacity = 0, nlen;
+    char *name;
+    int rv = 0;
+    if (!changed)
+    {
+        while (rv == 0 && b->valid && b->old.depth == depth)
+        {
+            // 文件的元数据沿用旧索引，不调用 fstatat
+            if (!S_ISDIR(b->old.mode))
+            {
+                rv = index_writer_add(&b->w, &b->old);
+                old_next(b);
+                continue;
+            }
+            nlen = my_strlen(old_name(b, path, len));
+            name = arena_alloc(&d->arena, nlen + 1);
+            memcpy(name, old_name(b, path, len), nlen + 1);
+            rv = update_entry(b, fd, path, len, name, depth, 1);
+            arena_release(&d->arena, m);
+        }
+        close(fd);
+        return rv;
+    }
+    if (dir_open(&r, fd, d->dirbuf) == -1)
+    {
+        fprintf(stderr, "\'%s\' : %s\n", path, strerror(errno));
+        d->return_value = 1;
+        old_skip(b, depth - 1);
+        return 0;
+    }
+    while (dir_next(&r, &e))
+    {
+        if (size == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64;
+            names = realloc(names, capacity * sizeof(char *));
+        }
+        nlen = my_strlen(e.name);
+        names[size] = arena_alloc(&d->arena, nlen + 1);
+        memcpy(names[size++], e.name, nlen + 1);
+    }
+    // 名称中没有 '/'，按字节排序即为索引的顺序
+    qsort(names, size, sizeof(char *), name_cmp);
+    entry = arena_mark(&d->arena);
+    for (size_t i = 0; i < size && rv == 0; i++)
+    {
+        // 旧索引中已经删除的名称连同子树一起跳过
+        while (b->valid && b->old.depth == depth && strcmp(old_name(b, path, len), names[i]) < 0)
+        {
+            old_next(b);
+            old_skip(b, depth);
+        }
+        rv = update_entry(b, r.fd, path, len, names[i], depth,
+                          b->valid && b->old.depth == depth && strcmp(old_name(b, path, len), names[i]) == 0);
+        arena_release(&d->arena, entry);
+    }
+    old_skip(b, depth - 1);
+    dir_close(&r);
+    free(names);
+    arena_release(&d->arena, m);
+    return rv;
+}
+
+static int root_cmp(const void *a, const void *b)
+{
+    char *ra = *(char *const *)a;
+    char *rb = *(char *const *)b;
+    return index_path_cmp(ra, strip_slashes(ra), rb, strip_slashes(rb));
+}
+
+int index_build(struct data *d, char *path)
+{
+    struct builder b;
+    struct stat sb;
+    char **roots = malloc(d->spl_size * sizeof(char *));
+    char *root, *last = NULL;
+    size_t len, last_len = 0;
+    int fd, err, rv = 0;
+    if (index_writer_open(&b.w, path) == -1)
+    {
+        fprintf(stderr, "\'%s\' : %s\n", path, strerror(errno));
+        free(roots);
+        return 1;
+    }
+    b.d = d;
+    b.valid = 0;
+    // 查找路径也按索引的顺序写入
+    memcpy(roots, d->search_path_list, d->spl_size * sizeof(char *));
+    qsort(roots, d->spl_size, sizeof(char *), root_cmp);
+    for (size_t i = 0; i < d->spl_size && rv == 0; i++)
+    {
+        root = roots[i];
+        len = strip_slashes(root);
+        root[len] = '\0';
+        if (last && (index_path_cmp(last, last_len, root, len) == 0 || in_subtree(root, len, last, last_len)))
+        {
+            fprintf(stderr, "warning: \'%s\' is already indexed\n", root);
+            continue;
+        }
+        STATS_INC(lstats);
+        if (lstat(root, &sb) == -1)
+        {
+            fprintf(stderr, "\'%s\' : No such file or directory\n", root);
+            d->return_value = 1;
+            continue;
+        }
+        // -H 和 -L 跟随作为查找路径的符号链接
+        if (S_ISLNK(sb.st_mode) && (d->option == 1 || d->option == 2))
+        {
+            stat(root, &sb);
+            STATS_INC(stats);
+        }
+        last = root;
+        last_len = len;
+        if (add_entry(&b.w, root, len, 0, &sb))
+            rv = -1;
+        else if (S_ISDIR(sb.st_mode))
+        {
+            fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd == -1)
+            {
+                fprintf(stderr, "\'%s\' : %s\n", root, strerror(errno));
+                d->return_value = 1;
+            }
+            else
+                rv = update_dir(&b, fd, root, len, 1, 1);
+        }
+    }
+    free(roots);
+    if (rv == 0 && index_writer_close(&b.w, 1) == 0)
+        return 0;
+    err = errno ? errno : EIO;
+    if (rv)
+        index_writer_close(&b.w, 0);
+    fprintf(stderr, "\'%s\' : %s\n", path, strerror(err));
+    return 1;
+}
+
+int index_refresh(struct data *d, char *path)
+{
+    struct index ix;
+    struct builder b;
+    struct index_rec prev;
+    struct stat sb, st;
+    struct arena_mark m;
+    char *root;
+    int fd, err, rv = 0;
+    if (index_open(&ix, path) == -1)
+    {
+        fprintf(stderr, "\'%s\' : %s\n", path, errno == EINVAL ? "not a valid index" : strerror(errno));
+        return 1;
+    }
+    if (index_writer_open(&b.w, path) == -1)
+    {
+        fprintf(stderr, "\'%s\' : %s\n", path, strerror(errno));
+        index_close(&ix);
+        return 1;
+    }
+    b.d = d;
+    b.valid = 1;
+    index_cursor_init(&b.c, &ix, 0);
+    old_next(&b);
+    // 旧索引中深度为 0 的记录是建立索引时的查找路径
+    while (rv == 0 && b.valid)
+    {
+        m = arena_mark(&d->arena);
+        prev = b.old;
+        root = arena_alloc(&d->arena, prev.len + 1);
+        memcpy(root, prev.path, prev.len + 1);
+        old_next(&b);
+        if (prev.depth != 0 || lstat(root, &sb) == -1)
+        {
+            fprintf(stderr, "\'%s\' : No such file or directory\n", root);
+            d->return_value = 1;
+            old_skip(&b, 0);
+        }
+        else
+        {
+            // 建立索引时跟随了作为查找路径的符号链接
+            if (S_ISLNK(sb.st_mode) && S_ISDIR(prev.mode) && stat(root, &st) == 0)
+                sb = st;
+            if (add_entry(&b.w, root, prev.len, 0, &sb))
+                rv = -1;
+            else if (!S_ISDIR(sb.st_mode))
+                old_skip(&b, 0);
+            else if ((fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1)
+            {
+                fprintf(stderr, "\'%s\' : %s\n", root, strerror(errno));
+                d->return_value = 1;
+                old_skip(&b, 0);
+            }
+            else
+                rv = update_dir(&b, fd, root, prev.len, 1, !same_time(&prev, &sb));
+        }
+        arena_release(&d->arena, m);
+    }
+    if (rv == 0 && b.c.bad)
+    {
+        errno = EINVAL;
+        rv = -1;
+    }
+    index_cursor_free(&b.c);
+    if (rv == 0 && index_writer_close(&b.w, 1) == 0)
+    {
+        index_close(&ix);
+        return 0;
+    }
+    err = errno ? errno : EIO;
+    if (rv)
+        index_writer_close(&b.w, 0);
+    index_close(&ix);
+    fprintf(stderr, "\'%s\' : %s\n", path, err == EINVAL ? "not a valid index" : strerror(err));
+    return 1;
+}
+
+// --use-index
+
+/**
+ * 后序遍历时等待子树结束的目录，路径保存在竞技场中，按栈的顺序释放。
+ */
+struct pending
+{
+    struct arena_mark mark;
+    struct index_rec rec; // path 指向竞技场中的副本
+};
+
+// 对一条记录求值，path 为输出的路径，返回是否进入该目录
+static int eval_rec(struct data *d, char *path, const struct index_rec *rec)
+{
+    struct node n;
+    mode_t mode = rec->mode;
+    char *slash = my_strrchr(path, '/');
+    n.name = path;
+    // 与 generate_nodes 相同，"/" 等查找路径的名称就是路径本身
+    n.name_wp = slash && slash[1] ? slash + 1 : path;
+    n.type = mode;
+    n.r_type = mode;
+    n.dirfd = AT_FDCWD;
+    // 符号链接的目标没有记录，只有 -L 需要时才调用 stat
+    n.flags = NODE_FTYPE | NODE_LSTAT | (S_ISLNK(mode) ? 0 : NODE_STAT);
+    // 属性同样来自 lstat，-L 时符号链接的属性需要跟随它获取
+    n.size = rec->size;
+    n.mtime = rec->mtime;
+    n.dev = rec->dev;
+    n.ino = rec->ino;
+    if (!S_ISLNK(mode) || d->option != 2)
+        n.flags |= NODE_ATTR;
+    eval_node(d, &n);
+    return S_ISDIR(mode) && node_descend(d, &n);
+}
+
+static void pop_pending(struct data *d, struct pending *p, int base)
+{
+    d->depth = p->rec.depth - base;
+    eval_rec(d, p->rec.path, &p->rec);
+    arena_release(&d->arena, p->mark);
+}
+
+// 查找路径末尾有多余的 '/' 时，与 find 一致，输出的路径以命令行中给出的查找路径开头
+static char *shown_path(char **buf, size_t *capacity, struct index_rec *rec, const char *shown, size_t rlen)
+{
+    size_t slen = my_strlen((char *)shown);
+    const char *rest = rec->path + rlen;
+    size_t len;
+    if (slen == rlen)
+        return rec->path;
+    if (*rest == '/' && shown[slen - 1] == '/')
+        rest++;
+    len = slen + (rec->path + rec->len - rest);
+    if (len + 1 > *capacity)
+    {
+        *capacity = 2 * len + 1;
+        *buf = realloc(*buf, *capacity);
+    }
+    memcpy(*buf, shown, slen);
+    memcpy(*buf + slen, rest, len - slen + 1);
+    return *buf;
+}
+
+// 对查找路径 shown 的子树（shown 为 NULL 时为整个索引）中的记录求值，root 为去掉末尾 '/' 后的前 rlen 个字节。
+// 返回 0 表示成功，1 表示索引中没有 root，-1 表示索引损坏
+static int scan(struct data *d, struct index_cursor *c, const char *shown, size_t rlen)
+{
+    struct index_rec rec;
+    struct pending *stack = NULL;
+    size_t size = 0, capacity = 0, bcap = 0;
+    char *buf = NULL, *path;
+    int base = shown ? -1 : 0; // 查找路径的深度
+    int skip = INT_MAX;        // 比它深的记录在被跳过的子树中
+    int cmp, found = !shown;
+    while (!quit_requested() && index_next(c, &rec))
+    {
+        if (!found)
+        {
+            // 第一条不在 root 之前的记录必须是 root 本身
+            if ((cmp = index_path_cmp(rec.path, rec.len, shown, rlen)) < 0)
+                continue;
+            if (cmp > 0)
+                break;
+            found = 1;
+            base = rec.depth;
+        }
+        else if (shown && !in_subtree(rec.path, rec.len, shown, rlen))
+            break;
+        if (rec.depth > skip)
+            continue;
+        skip = INT_MAX;
+        // 后序遍历：子树已经结束的目录
+        while (size && stack[size - 1].rec.depth >= rec.depth)
+            pop_pending(d, &stack[--size], base);
+        d->depth = rec.depth - base;
+        path = shown ? shown_path(&buf, &bcap, &rec, shown, rlen) : rec.path;
+        if (!d->d_checked)
+        {
+            if (!eval_rec(d, path, &rec))
+                skip = rec.depth;
+        }
+        else if (S_ISDIR(rec.mode) && (d->maxdepth < 0 || d->depth < d->maxdepth))
+        {
+            if (size == capacity)
+            {
+                capacity = capacity ? capacity * 2 : 16;
+                stack = realloc(stack, capacity * sizeof(struct pending));
+            }
+            stack[size].mark = arena_mark(&d->arena);
+            stack[size].rec = rec;
+            stack[size].rec.path = arena_alloc(&d->arena, my_strlen(path) + 1);
+            memcpy(stack[size].rec.path, path, my_strlen(path) + 1);
+            size++;
+        }
+        else
+        {
+            eval_rec(d, path, &rec);
+            skip = rec.depth;
+        }
+    }
+    cmp = c->bad ? -1 : !found;
+    while (size)
+        pop_pending(d, &stack[--size], base);
+    free(stack);
+    free(buf);
+    return cmp;
+}
+
+int index_query(struct data *d, char *path)
+{
+    struct index ix;
+    struct index_cursor c;
+    size_t len;
+    int rv = 0;
+    if (index_open(&ix, path) == -1)
+    {
+        fprintf(stderr, "\'%s\' : %s\n", path, errno == EINVAL ? "not a valid index" : strerror(errno));
+        return 1;
+    }
+    if (!d->spl_size)
+    {
+        index_cursor_init(&c, &ix, 0);
+        rv = scan(d, &c, NULL, 0);
+        index_cursor_free(&c);
+    }
+    for (size_t i = 0; i < d->spl_size && rv != -1 && !quit_requested(); i++)
+    {
+        len = strip_slashes(d->search_path_list[i]);
+        index_cursor_init(&c, &ix, index_seek(&ix, d->search_path_list[i], len));
+        if ((rv = scan(d, &c, d->search_path_list[i], len)) == 1)
+        {
+            fprintf(stderr, "\'%s\' : not in index\n", d->search_path_list[i]);
+            d->return_value = 1;
+        }
+        index_cursor_free(&c);
+    }
+    index_close(&ix);
+    if (rv == -1)
+    {
+        fprintf(stderr, "\'%s\' : not a valid index\n", path);
+        return 1;
+    }
+    return 0;
+}
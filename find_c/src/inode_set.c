@@ -0,0 +1,101 @@
+#include "inode_set.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// 集合的初始容量
+#define ISET_MIN 16
+
+// 将设备号和 inode 编号混合成 64 位哈希值（splitmix64 的终结步骤）
+static size_t iset_hash(dev_t dev, ino_t ino)
+{
+    uint64_t h = (uint64_t)ino ^ ((uint64_t)dev * 0x9e3779b97f4a7c15ULL);
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return (size_t)h;
+}
+
+// 返回 (dev, ino) 所在的槽位，不存在时返回探测序列中第一个空槽位
+static size_t iset_find(struct inode_set *s, dev_t dev, ino_t ino)
+{
+    size_t mask = s->capacity - 1;
+    size_t i = iset_hash(dev, ino) & mask;
+    while (s->slots[i].used && (s->slots[i].dev != dev || s->slots[i].ino != ino))
+        i = (i + 1) & mask;
+    return i;
+}
+
+static void iset_grow(struct inode_set *s)
+{
+    struct inode_key *old = s->slots;
+    size_t old_capacity = s->capacity;
+    s->capacity *= 2;
+    s->slots = calloc(s->capacity, sizeof(struct inode_key));
+    for (size_t i = 0; i < old_capacity; i++)
+        if (old[i].used)
+            s->slots[iset_find(s, old[i].dev, old[i].ino)] = old[i];
+    free(old);
+}
+
+void iset_init(struct inode_set *s)
+{
+    s->capacity = ISET_MIN;
+    s->size = 0;
+    s->slots = calloc(s->capacity, sizeof(struct inode_key));
+}
+
+void iset_free(struct inode_set *s)
+{
+    free(s->slots);
+    s->slots = NULL;
+    s->size = 0;
+    s->capacity = 0;
+}
+
+int iset_insert(struct inode_set *s, dev_t dev, ino_t ino)
+{
+    size_t i;
+    if ((s->size + 1) * 4 > s->capacity * 3)
+        iset_grow(s);
+    i = iset_find(s, dev, ino);
+    if (s->slots[i].used)
+        return 0;
+    s->slots[i].dev = dev;
+    s->slots[i].ino = ino;
+    s->slots[i].used = 1;
+    s->size++;
+    return 1;
+}
+
+int iset_contains(struct inode_set *s, dev_t dev, ino_t ino)
+{
+    return s->slots[iset_find(s, dev, ino)].used;
+}
+
+void iset_remove(struct inode_set *s, dev_t dev, ino_t ino)
+{
+    size_t mask = s->capacity - 1;
+    size_t i = iset_find(s, dev, ino);
+    size_t j = i;
+    size_t home;
+    if (!s->slots[i].used)
+        return;
+    s->slots[i].used = 0;
+    s->size--;
+    // 后移法：把后续槽位中理想位置不在 (i, j] 之间的元素移到空出的位置
+    for (;;)
+    {
+        j = (j + 1) & mask;
+        if (!s->slots[j].used)
+            return;
+        home = iset_hash(s->slots[j].dev, s->slots[j].ino) & mask;
+        if (((j - home) & mask) < ((j - i) & mask))
+            continue;
+        s->slots[i] = s->slots[j];
+        s->slots[j].used = 0;
+        i = j;
+    }
+}
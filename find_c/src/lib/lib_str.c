@@ -1,77 +1,325 @@
 #include "lib/lib_str.h"
 
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
-size_t my_strlen(char *str)
+#if defined(__x86_64__) && defined(__GNUC__)
+#define LIB_STR_X86 1
+#include <immintrin.h>
+#endif
+
+// 向量读取不能越过页边界，否则可能读到未映射的页
+#define STR_PAGE_SIZE 4096
+
+// 逐字节的实现，在没有 SSE2 的平台上使用，也是向量实现的参照
+
+static size_t strlen_scalar(char *str)
 {
-    if (!str)
-        return 0;
     size_t i = 0;
     while (str[i])
         i++;
     return i;
 }
 
-int my_strcmp(char *str1, char *str2)
+static int strcmp_scalar(char *str1, char *str2)
+{
+    size_t i = 0;
+    while (str1[i] && str1[i] == str2[i])
+        i++;
+    return str1[i] != str2[i];
+}
+
+static char *strrchr_scalar(char *str, char ch)
 {
-    size_t s1 = my_strlen(str1);
-    size_t s2 = my_strlen(str2);
-    if (s1 != s2)
-        return 1;
-    for (size_t i = 0; i < s1; i++)
+    char *last = NULL;
+    for (; *str; str++)
     {
-        if (str1[i] != str2[i])
-            return 1;
+        if (*str == ch)
+            last = str;
     }
-    return 0;
+    return last;
 }
 
-char *my_strcp(char *str)
+#ifdef LIB_STR_X86
+
+// strlen 和 strrchr 每次检查对齐的 64 字节（4 个 SSE2 或 2 个 AVX2 寄存器），结果合并为 64 位的掩码；
+// 对齐的读取不会跨页，第一块中字符串开头之前的字节用移位去掉。
+// strcmp 的两个字符串对齐方式不同，只在两者离页尾都足够远时做非对齐读取，页尾的几个字节逐字节比较。
+
+// 两个字符串中较早到达页尾的那个还剩多少字节
+static size_t page_room(char *str1, char *str2)
 {
-    size_t size = my_strlen(str);
-    char *new_str = calloc(size + 1, 1);
-    for (size_t i = 0; i < size; i++)
-        new_str[i] = str[i];
-    return new_str;
+    size_t r1 = STR_PAGE_SIZE - ((uintptr_t)str1 & (STR_PAGE_SIZE - 1));
+    size_t r2 = STR_PAGE_SIZE - ((uintptr_t)str2 & (STR_PAGE_SIZE - 1));
+    return r1 < r2 ? r1 : r2;
+}
+
+// 对齐的 64 字节中等于 x 的字节，每个字节对应掩码中的一位
+static inline uint64_t sse2_match(const char *p, __m128i x)
+{
+    uint64_t m0 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)p), x));
+    uint64_t m1 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)(p + 16)), x));
+    uint64_t m2 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)(p + 32)), x));
+    uint64_t m3 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)(p + 48)), x));
+    return m0 | m1 << 16 | m2 << 32 | m3 << 48;
 }
 
-char* my_strrchr(char* str, int ch) {
-    char* last_occurrence = NULL;
+static size_t strlen_sse2(char *str)
+{
+    const __m128i zero = _mm_setzero_si128();
+    uintptr_t off = (uintptr_t)str & 63;
+    const char *p = str - off;
+    uint64_t z = sse2_match(p, zero) >> off;
+    if (z)
+        return __builtin_ctzll(z);
+    for (;;)
+    {
+        p += 64;
+        if ((z = sse2_match(p, zero)))
+            return p + __builtin_ctzll(z) - str;
+    }
+}
 
-    while (*str) {
-        if (*str == (char)ch) {
-            last_occurrence = str;
+static int strcmp_sse2(char *str1, char *str2)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a, b;
+    unsigned mask;
+    size_t room;
+    for (;;)
+    {
+        for (room = page_room(str1, str2); room >= 16; room -= 16)
+        {
+            a = _mm_loadu_si128((const __m128i *)str1);
+            b = _mm_loadu_si128((const __m128i *)str2);
+            // 第一个不同的字节或第一个结束符
+            mask = (~_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) | _mm_movemask_epi8(_mm_cmpeq_epi8(a, zero))) & 0xffff;
+            if (mask)
+                return str1[__builtin_ctz(mask)] != str2[__builtin_ctz(mask)];
+            str1 += 16;
+            str2 += 16;
+        }
+        for (; room; room--, str1++, str2++)
+        {
+            if (*str1 != *str2)
+                return 1;
+            if (!*str1)
+                return 0;
         }
-        str++;
     }
+}
 
-    if (ch == '\0')
-        return (char*)str;
+static char *strrchr_sse2(char *str, char ch)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c = _mm_set1_epi8(ch);
+    uintptr_t off = (uintptr_t)str & 63;
+    const char *p = str - off;
+    const char *lastp = p;
+    uint64_t lastm = 0;
+    uint64_t z = sse2_match(p, zero) >> off << off;
+    uint64_t m = sse2_match(p, c) >> off << off;
+    for (;;)
+    {
+        if (z)
+        {
+            // 只保留结束符之前的匹配
+            m &= (z & -z) - 1;
+            if (m)
+                return (char *)p + 63 - __builtin_clzll(m);
+            return lastm ? (char *)lastp + 63 - __builtin_clzll(lastm) : NULL;
+        }
+        // 只记录最后一个有匹配的块，返回前才计算位置
+        if (m)
+        {
+            lastp = p;
+            lastm = m;
+        }
+        p += 64;
+        z = sse2_match(p, zero);
+        m = sse2_match(p, c);
+    }
+}
 
-    return (char*)last_occurrence;
+__attribute__((target("avx2"))) static inline uint64_t avx2_match(const char *p, __m256i x)
+{
+    uint64_t m0 = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *)p), x));
+    uint64_t m1 = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *)(p + 32)), x));
+    return m0 | m1 << 32;
 }
 
-char *my_concate(char *dir, char *file)
+__attribute__((target("avx2"))) static size_t strlen_avx2(char *str)
 {
-    size_t ds = my_strlen(dir);
-    size_t fs = my_strlen(file);
-    char *new_str = calloc(ds + fs + 2, 1); // + 1 for \0 +1 for eventual '/'
-    size_t i = 0;
-    while (i < ds)
+    const __m256i zero = _mm256_setzero_si256();
+    uintptr_t off = (uintptr_t)str & 63;
+    const char *p = str - off;
+    uint64_t z = avx2_match(p, zero) >> off;
+    if (z)
+        return __builtin_ctzll(z);
+    for (;;)
     {
-        new_str[i] = dir[i];
-        i++;
+        p += 64;
+        if ((z = avx2_match(p, zero)))
+            return p + __builtin_ctzll(z) - str;
     }
-    if (dir[ds - 1] != '/')
+}
+
+__attribute__((target("avx2"))) static int strcmp_avx2(char *str1, char *str2)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i a, b;
+    unsigned mask;
+    size_t room;
+    for (;;)
     {
-        new_str[i] = '/';
-        i++;
-        ds++;
+        for (room = page_room(str1, str2); room >= 32; room -= 32)
+        {
+            a = _mm256_loadu_si256((const __m256i *)str1);
+            b = _mm256_loadu_si256((const __m256i *)str2);
+            mask = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)) | (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, zero));
+            if (mask)
+                return str1[__builtin_ctz(mask)] != str2[__builtin_ctz(mask)];
+            str1 += 32;
+            str2 += 32;
+        }
+        for (; room; room--, str1++, str2++)
+        {
+            if (*str1 != *str2)
+                return 1;
+            if (!*str1)
+                return 0;
+        }
     }
-    while (i - ds < fs)
+}
+
+__attribute__((target("avx2"))) static char *strrchr_avx2(char *str, char ch)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i c = _mm256_set1_epi8(ch);
+    uintptr_t off = (uintptr_t)str & 63;
+    const char *p = str - off;
+    const char *lastp = p;
+    uint64_t lastm = 0;
+    uint64_t z = avx2_match(p, zero) >> off << off;
+    uint64_t m = avx2_match(p, c) >> off << off;
+    for (;;)
     {
-        new_str[i] = file[i - ds];
-        i++;
+        if (z)
+        {
+            // 只保留结束符之前的匹配
+            m &= (z & -z) - 1;
+            if (m)
+                return (char *)p + 63 - __builtin_clzll(m);
+            return lastm ? (char *)lastp + 63 - __builtin_clzll(lastm) : NULL;
+        }
+        // 只记录最后一个有匹配的块，返回前才计算位置
+        if (m)
+        {
+            lastp = p;
+            lastm = m;
+        }
+        p += 64;
+        z = avx2_match(p, zero);
+        m = avx2_match(p, c);
     }
+}
+
+#endif
+
+// 可用的实现，越靠后越快；不支持的指令集在运行时跳过
+static const struct str_impl impls[] = {
+    {"scalar", strlen_scalar, strcmp_scalar, strrchr_scalar},
+#ifdef LIB_STR_X86
+    {"sse2", strlen_sse2, strcmp_sse2, strrchr_sse2},
+    {"avx2", strlen_avx2, strcmp_avx2, strrchr_avx2},
+#endif
+};
+
+static const struct str_impl *impl = &impls[0];
+
+static int impl_supported(const struct str_impl *i)
+{
+#ifdef LIB_STR_X86
+    if (i->len == strlen_avx2)
+        return __builtin_cpu_supports("avx2");
+#endif
+    (void)i;
+    return 1;
+}
+
+// 程序启动时选择当前 CPU 支持的最快实现
+__attribute__((constructor)) static void str_dispatch(void)
+{
+    size_t n = sizeof(impls) / sizeof(impls[0]);
+#ifdef LIB_STR_X86
+    __builtin_cpu_init();
+#endif
+    while (n > 1 && !impl_supported(&impls[n - 1]))
+        n--;
+    impl = &impls[n - 1];
+}
+
+const struct str_impl *my_str_impl(size_t i)
+{
+    if (i >= sizeof(impls) / sizeof(impls[0]) || !impl_supported(&impls[i]))
+        return NULL;
+    return &impls[i];
+}
+
+const struct str_impl *my_str_use(const struct str_impl *i)
+{
+    const struct str_impl *old = impl;
+    impl = i;
+    return old;
+}
+
+size_t my_strlen(char *str)
+{
+    if (!str)
+        return 0;
+    return impl->len(str);
+}
+
+int my_strcmp(char *str1, char *str2)
+{
+    // NULL 与空字符串相同
+    if (!str1 || !str2)
+        return my_strlen(str1) != my_strlen(str2);
+    return impl->cmp(str1, str2);
+}
+
+char *my_strcp(char *str)
+{
+    size_t size = my_strlen(str);
+    char *new_str = malloc(size + 1);
+    if (!new_str)
+        return NULL;
+    if (size)
+        memcpy(new_str, str, size);
+    new_str[size] = '\0';
     return new_str;
-}
\ No newline at end of file
+}
+
+char *my_strrchr(char *str, int ch)
+{
+    if ((char)ch == '\0')
+        return str + my_strlen(str);
+    return impl->rchr(str, (char)ch);
+}
+
+char *my_concate(char *dir, char *file)
+{
+    size_t ds = my_strlen(dir);
+    size_t fs = my_strlen(file);
+    int sep = ds == 0 || dir[ds - 1] != '/';
+    char *new_str = malloc(ds + sep + fs + 1);
+    if (!new_str)
+        return NULL;
+    memcpy(new_str, dir, ds);
+    if (sep)
+        new_str[ds] = '/';
+    memcpy(new_str + ds + sep, file, fs);
+    new_str[ds + sep + fs] = '\0';
+    return new_str;
+}
@@ -14,4 +14,38 @@ int octal_to_dec(int n)
     int d = (n - c * 100) / 10;
     int u = (n - c * 100 - d * 10);
     return c * 8 * 8 + d * 8 + u;
-}
\ No newline at end of file
+}
+
+size_t parse_size(char *str)
+{
+    size_t n = 0;
+    size_t i = 0;
+    if (!str || str[0] < '0' || str[0] > '9')
+        return 0;
+    while (str[i] >= '0' && str[i] <= '9')
+    {
+        n = n * 10 + (str[i] - '0');
+        i++;
+    }
+    if (str[i] == 'k' || str[i] == 'K')
+        n <<= 10;
+    else if (str[i] == 'm' || str[i] == 'M')
+        n <<= 20;
+    else if (str[i] == 'g' || str[i] == 'G')
+        n <<= 30;
+    else if (str[i] != '\0')
+        return 0;
+    else
+        return n;
+    return str[i + 1] == '\0' ? n : 0;
+}
+
+int is_number(char *str)
+{
+    size_t i = 0;
+    if (!str || !str[0])
+        return 0;
+    while (str[i] >= '0' && str[i] <= '9')
+        i++;
+    return str[i] == '\0';
+}
@@ -1,36 +1,89 @@
 #include "myfind.h"
+#include "bytecode.h"
+#include "content.h"
+#include "dirread.h"
+#include "dupes.h"
+#include "exec.h"
+#include "globmatch.h"
+#include "index.h"
 #include "lib/lib_str.h"
 #include "lib/lib_util.h"
+#include "optimize.h"
+#include "output.h"
+#include "stats.h"
+#include "uring.h"
+#include "walk.h"
+#include "watch.h"
 
 #include <dirent.h>
 #include <err.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <fnmatch.h>
+#include <linux/stat.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
 #include <sys/types.h>
-#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
-#define MAX_BATCH_SIZE 4096
+// 一秒的纳秒数
+#define NSEC 1000000000LL
 
+// -quit 或 -limit 请求结束遍历，所有线程共享
+static int quit_flag;
+
+#ifndef MYFIND_NO_MAIN
 int main(int argc, char *argv[])
 {
     // 初始化
     struct data d;
+    stats_phase(PHASE_PARSE);
     init_data(&d);
 
     int index = 1;
-    // 解析选项，如-d、-P、-H、-L
-    for (; index < argc && argv[index][0] == '-'; index++)
-        if (!update_option(&d, argv[index]))
+    int used;
+    // 解析选项，如-d、-P、-H、-L、-j
+    for (; index < argc && argv[index][0] == '-'; index += used)
+        if (!(used = update_option(&d, argv[index], index + 1 < argc ? argv[index + 1] : NULL)))
             break;
     // 解析查找路径
     for (; index < argc && argv[index][0] != '-' && argv[index][0] != '(' && argv[index][0] != '!'; index++)
         add_search_path(&d, argv[index]);
-    // 如果查找路径未指出，查找当前目录
-    if (d.spl_size == 0)
+    if (!!d.index_build + !!d.index_use + !!d.index_refresh > 1)
+    {
+        fprintf(stderr, "only one of --build-index, --use-index and --refresh-index can be used\n");
+        free_data(&d);
+        return 1;
+    }
+    if (d.dupes && (d.watch || d.index_build || d.index_refresh))
+    {
+        fprintf(stderr, "--dupes cannot be used with --watch, --build-index or --refresh-index\n");
+        free_data(&d);
+        return 1;
+    }
+    if (d.watch && (d.index_build || d.index_use || d.index_refresh))
+    {
+        fprintf(stderr, "--watch cannot be used with an index\n");
+        free_data(&d);
+        return 1;
+    }
+    // 监视表不加锁，初始遍历使用单线程
+    if (d.watch)
+        d.jobs = 1;
+    // 刷新索引时查找路径取自索引本身
+    if (d.index_refresh && d.spl_size)
+    {
+        fprintf(stderr, "--refresh-index does not take search paths\n");
+        free_data(&d);
+        return 1;
+    }
+    // 如果查找路径未指出，查找当前目录；使用索引时对索引中的所有记录求值
+    if (d.spl_size == 0 && !d.index_use && !d.index_refresh)
     {
         d.spl_size = 1;
         d.search_path_list[0] = my_strcp(".");
@@ -41,44 +94,72 @@ int main(int argc, char *argv[])
         char *exp = my_strcp(argv[index]);
         add_exp(&d, exp);
     }
-    // 创建命令列表并检查错误
-    if (create_c_list(&d))
+    // 解析并检查表达式
+    stats_phase(PHASE_COMPILE);
+    if (compile_expression(&d))
     {
         int rv = d.return_value;
-        d.ast->c_list = d.c_list;
         free_data(&d);
         return rv;
     }
-    // 创建抽象语法树
-    d.ast->c_list = d.c_list;
-    d.ast->cl_size = d.cl_size;
-    build_ast(d.ast);
-    reset_rvalues(d.ast);
-    // 检查抽象语法树
-    if (is_ast_valid(&d, NULL, d.ast, 0))
+    // 表达式为真的文件是重复文件的候选，不能同时有输出或执行命令的动作
+    if (d.dupes && d.actions)
     {
-        free(d.c_list);
+        fprintf(stderr, "--dupes cannot be used with actions\n");
         free_data(&d);
-        fprintf(stderr, "Expressions error\n");
         return 1;
     }
+    stats_phase(PHASE_WALK);
+    // 建立和刷新索引时不求值
+    if (d.index_build || d.index_refresh)
+    {
+        if (d.el_size)
+        {
+            fprintf(stderr, "%s does not take an expression\n", d.index_build ? "--build-index" : "--refresh-index");
+            d.return_value = 1;
+        }
+        else if (d.index_build ? index_build(&d, d.index_build) : index_refresh(&d, d.index_refresh))
+            d.return_value = 1;
+        if (d.show_stats)
+            stats_report(d.show_stats == 2);
+        int rv = d.return_value;
+        free_data(&d);
+        return rv;
+    }
+    if (d.use_uring && !d.index_use)
+        d.uring = uring_create(URING_DEPTH);
 
-    generate_nodes(&d);
-    if (d.bfl_size)
-        d.return_value = deal_batch_remaining(&d);
-    // for (int i = 0; i < d.no_size; i++)
-    // {
-    //     if (d.ast->left)
-    //         exec_ast(d.ast, d.ast, d.nodes[i], 0);
-    //     if (!d.actions && d.ast->rvalue[0] == 1 && d.ast->rvalue[1] == 1)
-    //         printf("%s\n", d.nodes[i]->name);
-    //     reset_rvalues(d.ast);
-    // }
+    if (d.index_use)
+    {
+        if (index_query(&d, d.index_use))
+            d.return_value = 1;
+    }
+    else
+        generate_nodes(&d);
+    if (d.watch)
+        watch_run(&d);
+    if (d.dupes)
+    {
+        stats_phase(PHASE_DUPES);
+        if (dupes_run(&d))
+            d.return_value = 1;
+    }
+    stats_phase(PHASE_EXEC);
+    if (deal_batch_remaining(&d))
+        d.return_value = 1;
+    if (out_flush(d.out))
+    {
+        fprintf(stderr, "write error\n");
+        d.return_value = 1;
+    }
+    if (d.show_stats)
+        stats_report(d.show_stats == 2);
     int rvalue = 0;
     rvalue = d.return_value;
     free_data(&d);
     return (rvalue);
 }
+#endif
 
 void init_data(struct data *d)
 {
@@ -87,29 +168,49 @@ void init_data(struct data *d)
     d->d_checked = 0;
     d->search_path_list = calloc(10, sizeof(char *));
     d->exp_list = calloc(10, sizeof(char *));
-    d->nodes = calloc(10, sizeof(struct node *));
-    d->inode_list = calloc(10, sizeof(int));
+    iset_init(&d->ancestors);
     d->c_list = calloc(10, sizeof(struct compound *));
-    d->batch_file_list = calloc(10, sizeof(char *));
     d->spl_size = 0;
     d->el_size = 0;
-    d->no_size = 0;
-    d->il_size = 0;
     d->cl_size = 0;
-    d->bfl_size = 0;
     d->spl_capacity = 10;
     d->el_capacity = 10;
-    d->no_capacity = 10;
-    d->il_capacity = 10;
     d->cl_capacity = 10;
-    d->bfl_capacity = 10;
     d->actions = 0;
+    d->opt_level = OPT_LEVEL_DEFAULT;
+    d->debug_opt = 0;
+    d->jobs = 1;
+    d->ordered = 0;
+    d->depth = 0;
+    d->mindepth = 0;
+    d->maxdepth = -1;
+    d->dirbuf = 0;
+    d->use_uring = 0;
+    d->uring = NULL;
+    d->need_mode = 0;
+    d->attr_mask = 0;
+    d->skip_binary = 0;
+    d->walk = NULL;
+    d->task = NULL;
     d->ast = calloc(1, sizeof(struct ast));
     d->ast->left = NULL;
     d->ast->right = NULL;
+    d->prog = NULL;
+    d->batches = NULL;
+    d->nbatches = 0;
+    d->procs = NULL;
+    d->exec_jobs = 0;
+    d->out = out_create(OUT_BUF_SIZE);
+    arena_init(&d->arena);
+    d->index_build = NULL;
+    d->index_use = NULL;
+    d->index_refresh = NULL;
+    d->watch = NULL;
+    d->dupes = NULL;
+    d->show_stats = 0;
 }
 
-int update_option(struct data *d, char *opt)
+int update_option(struct data *d, char *opt, char *arg)
 {
     // 启用深度优先搜索
     if (my_strcmp("-d", opt) == 0)
@@ -132,6 +233,126 @@ int update_option(struct data *d, char *opt)
         d->option = 2;
         return 1;
     }
+    // 表达式的优化级别：-O0 到 -O9，2 以上与 -O2 相同
+    else if (opt[1] == 'O' && opt[2] >= '0' && opt[2] <= '9' && !opt[3])
+    {
+        d->opt_level = opt[2] - '0';
+        return 1;
+    }
+    // 调试输出：-D opt 输出优化前后的 AST
+    else if (my_strcmp("-D", opt) == 0)
+    {
+        if (!arg || my_strcmp("opt", arg) != 0)
+        {
+            fprintf(stderr, "-D requires a debug option: opt\n");
+            exit(1);
+        }
+        d->debug_opt = 1;
+        return 2;
+    }
+    // 并行遍历的线程数：-j N 或 -jN
+    else if (opt[1] == 'j')
+    {
+        char *n = opt[2] ? opt + 2 : arg;
+        if (!n || atoi(n) < 1)
+        {
+            fprintf(stderr, "-j requires a positive thread count\n");
+            exit(1);
+        }
+        d->jobs = atoi(n);
+        return opt[2] ? 1 : 2;
+    }
+    else if (my_strcmp("--skip-binary", opt) == 0)
+    {
+        d->skip_binary = 1;
+        return 1;
+    }
+    else if (my_strcmp("--ordered", opt) == 0)
+    {
+        d->ordered = 1;
+        return 1;
+    }
+    else if (my_strcmp("--uring", opt) == 0)
+    {
+        d->use_uring = 1;
+        return 1;
+    }
+    // getdents64 缓冲区的最大容量：--dirbuf SIZE 或 --dirbuf=SIZE
+    else if (my_strcmp("--dirbuf", opt) == 0 || (my_strlen(opt) > 9 && strncmp("--dirbuf=", opt, 9) == 0))
+    {
+        char *size = opt[8] == '=' ? opt + 9 : arg;
+        if (!size || !(d->dirbuf = parse_size(size)))
+        {
+            fprintf(stderr, "--dirbuf requires a buffer size such as 1M\n");
+            exit(1);
+        }
+        return opt[8] == '=' ? 1 : 2;
+    }
+    // 同时运行的批处理数量：--exec-jobs N 或 --exec-jobs=N
+    else if (my_strcmp("--exec-jobs", opt) == 0 || (my_strlen(opt) > 12 && strncmp("--exec-jobs=", opt, 12) == 0))
+    {
+        char *n = opt[11] == '=' ? opt + 12 : arg;
+        if (!n || atoi(n) < 1)
+        {
+            fprintf(stderr, "--exec-jobs requires a positive process count\n");
+            exit(1);
+        }
+        d->exec_jobs = atoi(n);
+        return opt[11] == '=' ? 1 : 2;
+    }
+    // 索引文件：--build-index FILE、--use-index FILE 或 --xxx-index=FILE
+    else if (my_strcmp("--build-index", opt) == 0 || (my_strlen(opt) > 14 && strncmp("--build-index=", opt, 14) == 0))
+    {
+        if (!(d->index_build = opt[13] == '=' ? opt + 14 : arg))
+        {
+            fprintf(stderr, "--build-index requires an index file\n");
+            exit(1);
+        }
+        return opt[13] == '=' ? 1 : 2;
+    }
+    else if (my_strcmp("--use-index", opt) == 0 || (my_strlen(opt) > 12 && strncmp("--use-index=", opt, 12) == 0))
+    {
+        if (!(d->index_use = opt[11] == '=' ? opt + 12 : arg))
+        {
+            fprintf(stderr, "--use-index requires an index file\n");
+            exit(1);
+        }
+        return opt[11] == '=' ? 1 : 2;
+    }
+    else if (my_strcmp("--refresh-index", opt) == 0 || (my_strlen(opt) > 16 && strncmp("--refresh-index=", opt, 16) == 0))
+    {
+        if (!(d->index_refresh = opt[15] == '=' ? opt + 16 : arg))
+        {
+            fprintf(stderr, "--refresh-index requires an index file\n");
+            exit(1);
+        }
+        return opt[15] == '=' ? 1 : 2;
+    }
+    else if (my_strcmp("--stats", opt) == 0 || my_strcmp("--stats=json", opt) == 0)
+    {
+        d->show_stats = opt[7] ? 2 : 1;
+        return 1;
+    }
+    else if (my_strcmp("--dupes", opt) == 0)
+    {
+        if (!d->dupes && !(d->dupes = dupes_create()))
+        {
+            perror("--dupes");
+            exit(1);
+        }
+        // 候选文件的大小和 (dev, ino) 与属性谓词的字段一起获取
+        d->attr_mask |= STATX_SIZE | STATX_INO;
+        return 1;
+    }
+    else if (my_strcmp("--watch", opt) == 0)
+    {
+        if (!d->watch && !(d->watch = watch_create()))
+        {
+            fprintf(stderr, "--watch : %s\n", strerror(errno));
+            exit(1);
+        }
+        return 1;
+    }
     return 0;
 }
 
@@ -139,91 +360,176 @@ void generate_nodes(struct data *d)
 {
     struct stat sb;  // 用于保存文件信息
     struct stat sbl; // 用于保存符号链接信息
-    mode_t types[2]; // 存储文件和符号链接的类型
     int srl;         // 存储lstat()的返回值
+    int srs;         // 存储stat()的返回值
     int islnk;       // 存储该文件是否是符号链接
-    for (size_t i = 0; i < d->spl_size; i++)
+    int fd;          // 查找路径作为目录打开后的文件描述符
+    char *f_name;    // 查找路径的名称，不包含路径
+    struct node n;   // 查找路径本身对应的节点
+    for (size_t i = 0; i < d->spl_size && !quit_requested(); i++)
     {
         // lstat系统调用：lstat会获取符号链接本身的状态信息，而不是符号链接指向的目标文件的信息
         // stat系统调用：stat系统调用用于获取文件或目录的状态信息，如果该文件是一个符号链接，stat会返回符号链接所指向的目标文件的信息，而不是符号链接本身的信息
         srl = lstat(d->search_path_list[i], &sbl);
+        STATS_INC(lstats);
         if (srl == -1)
         {
             fprintf(stderr, "\'%s\' : No such file or directory\n", d->search_path_list[i]);
             d->return_value = 1;
             continue;
         }
-        stat(d->search_path_list[i], &sb);
+        srs = stat(d->search_path_list[i], &sb);
+        STATS_INC(stats);
         islnk = S_ISLNK(sbl.st_mode);
-        types[0] = sbl.st_mode;
-        types[1] = sb.st_mode;
-        // 深度优先搜索
-        if (d->d_checked)
+        // 传入的name_wp应该是目录/文件名，不包含路径
+        if (my_strcmp(d->search_path_list[i], ".") == 0 || my_strcmp(d->search_path_list[i], "..") == 0 || my_strcmp(d->search_path_list[i], "/") == 0)
+            f_name = my_strcp(d->search_path_list[i]);
+        else
+        {
+            char *last_slash = my_strrchr(d->search_path_list[i], '/');
+            f_name = my_strcp(last_slash ? last_slash + 1 : d->search_path_list[i]);
+        }
+        n.name = d->search_path_list[i];
+        n.name_wp = f_name;
+        n.type = sbl.st_mode;
+        n.r_type = sb.st_mode;
+        n.dirfd = AT_FDCWD;
+        n.flags = NODE_FTYPE | NODE_LSTAT | NODE_STAT | NODE_ATTR;
+        // 与 find 一致，-H 和 -L 时查找路径本身的属性来自它指向的文件（指向不存在的文件时除外）
+        if (islnk && d->option && srs == 0)
+            sbl = sb;
+        n.size = sbl.st_size;
+        n.mtime = (int64_t)sbl.st_mtim.tv_sec * NSEC + sbl.st_mtim.tv_nsec;
+        n.dev = sbl.st_dev;
+        n.ino = sbl.st_ino;
+        fd = -1;
+        d->depth = 0;
+        if (S_ISDIR(sb.st_mode) && (!islnk || d->option == 1 || d->option == 2) && d->maxdepth != 0)
         {
-            if (S_ISDIR(sb.st_mode) && (!islnk || d->option == 1 || d->option == 2))
+            fd = open(d->search_path_list[i], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd == -1)
             {
-                add_inode(d, sb.st_ino);
-                parse_dir(d->search_path_list[i], d);
+                fprintf(stderr, "\'%s\' : %s\n", d->search_path_list[i], strerror(errno));
+                d->return_value = 1;
             }
-            // 传入的name_wp应该是目录/文件名，不包含路径
-            if (my_strcmp(d->search_path_list[i], ".") == 0 || my_strcmp(d->search_path_list[i], "..") == 0 || my_strcmp(d->search_path_list[i], "/") == 0)
-                add_node(d->search_path_list[i], my_strcp(d->search_path_list[i]), types[0], types[1], d);
-            else
+        }
+        // 广度优先搜索：先处理查找路径本身，-prune 作用于它时不再进入
+        if (!d->d_checked)
+        {
+            eval_node(d, &n);
+            if (fd != -1 && (n.flags & NODE_PRUNE))
             {
-                char *last_slash = my_strrchr(d->search_path_list[i], '/');
-                char *f_name = my_strcp(last_slash + 1);
-                add_node(d->search_path_list[i], f_name, types[0], types[1], d);
+                close(fd);
+                fd = -1;
             }
-            free_il(d);
         }
-        // 广度优先搜索
+        // 并行遍历，深度优先搜索时由 walk_root 在子树完成后处理查找路径本身
+        if (fd != -1 && d->jobs > 1)
+        {
+            close(fd);
+            walk_root(d, &n);
+        }
         else
         {
-            // 传入的name_wp应该是目录/文件名，不包含路径
-            if (my_strcmp(d->search_path_list[i], ".") == 0 || my_strcmp(d->search_path_list[i], "..") == 0 || my_strcmp(d->search_path_list[i], "/") == 0)
-                add_node(d->search_path_list[i], my_strcp(d->search_path_list[i]), types[0], types[1], d);
-            else
-            {
-                char *last_slash = my_strrchr(d->search_path_list[i], '/');
-                char *f_name = my_strcp(last_slash + 1);
-                add_node(d->search_path_list[i], f_name, types[0], types[1], d);
-            }
-            if (S_ISDIR(sb.st_mode) && (!islnk || d->option == 1 || d->option == 2))
-            {
-                add_inode(d, sb.st_ino);
-                parse_dir(d->search_path_list[i], d);
-            }
-            free_il(d);
+            if (fd != -1)
+                parse_dir(fd, d->search_path_list[i], d);
+            // 深度优先搜索：最后处理查找路径本身
+            if (d->d_checked)
+                eval_node(d, &n);
         }
+        free(f_name);
     }
 }
 
-int deal_batch_remaining(struct data *d) {
-    char **args_batch = calloc(d->bfl_size + 2, sizeof(char *));
-    int ret = 0;
-    // TODO: 如果需要批处理，必然有-exec，此时c_list[0]->args[0]就是批处理命令
-    args_batch[0] = my_strcp(d->batch_command);
-    for (int i = 0; i < d->bfl_size; i++)
-        args_batch[i + 1] = my_strcp(d->batch_file_list[i]);
-    args_batch[d->bfl_size + 1] = NULL;
-    pid_t pid = fork();
-    // child
-    if (pid == 0)
+int deal_batch_remaining(struct data *d)
+{
+    if (!d->procs)
+        return 0;
+    out_flush(d->out);
+    for (size_t i = 0; i < d->nbatches; i++)
+        batch_flush(&d->batches[i], d->procs);
+    return procs_wait_all(d->procs);
+}
+
+void init_batches(struct data *d)
+{
+    size_t limit;
+    if (!d->nbatches)
+        return;
+    limit = exec_arg_limit();
+    d->batches = calloc(d->nbatches, sizeof(struct batch));
+    for (size_t i = 0; i < d->cl_size; i++)
+        if (d->c_list[i]->et == EXECP)
+            batch_init(&d->batches[d->c_list[i]->batch], d->c_list[i]->args, limit);
+}
+
+void free_batches(struct data *d)
+{
+    if (!d->batches)
+        return;
+    for (size_t i = 0; i < d->nbatches; i++)
+        batch_free(&d->batches[i]);
+    free(d->batches);
+    d->batches = NULL;
+}
+
+int compile_expression(struct data *d)
+{
+    // 创建命令列表并检查错误，此后由 AST 负责释放 c_list
+    int err = create_c_list(d);
+    d->ast->c_list = d->c_list;
+    if (err)
+        return 1;
+    // 记录表达式是否需要完整的文件模式（如 -perm），io_uring 据此预取 statx
+    int has_exec = 0;
+    int has_prune = 0;
+    for (size_t i = 0; i < d->cl_size; i++)
     {
-        execvp(args_batch[0], args_batch);
-        fprintf(stderr, "An error occured while execvp\n");
-        exit(1);
+        // 属性谓词需要的 statx 字段合并在一起，第一次获取属性时一次请求
+        if (d->c_list[i]->et == CONDITION)
+            d->attr_mask |= d->c_list[i]->pred.mask;
+        if (d->c_list[i]->et == CONDITION && d->c_list[i]->pred.kind == PRED_PERM)
+            d->need_mode = 1;
+        if (d->c_list[i]->et == CONDITION && d->c_list[i]->pred.kind == PRED_PRUNE)
+            has_prune = 1;
+        if (d->c_list[i]->et == EXEC || d->c_list[i]->et == EXECP)
+            has_exec = 1;
     }
-    // father
-    else
+    for (size_t i = 0; i < d->cl_size; i++)
+        if (d->c_list[i]->et == CONDITION && d->c_list[i]->pred.mask)
+            d->c_list[i]->pred.mask = d->attr_mask;
+    // 创建抽象语法树
+    d->ast->cl_size = d->cl_size;
+    build_ast(d->ast);
+    // 检查抽象语法树
+    if (is_ast_valid(d, NULL, d->ast, 0))
     {
-        waitpid(pid, &ret, 0);
-        for (size_t i = 0; i < d->bfl_size + 2; i++)
-            free(args_batch[i]);
-        free(args_batch);
+        fprintf(stderr, "Expressions error\n");
+        d->return_value = 1;
+        return 1;
     }
-    free_bfl(d);
-    return ret;    
+    // 与 find 一致，后序遍历时目录在其内容之后才求值，-prune 不起作用
+    if (has_prune && d->d_checked)
+        fprintf(stderr, "warning: -prune has no effect with -d\n");
+    // 按估计的代价重新排列没有副作用的操作数
+    if (d->debug_opt)
+    {
+        fprintf(stderr, "Original tree:\n");
+        print_ast(d->ast, 0, 0);
+    }
+    optimize_ast(d->ast, d->opt_level);
+    if (d->debug_opt)
+    {
+        fprintf(stderr, "Optimized tree (-O%d):\n", d->opt_level);
+        print_ast(d->ast, 0, 0);
+    }
+    // 编译成字节码，求值时不再遍历 AST
+    d->prog = compile_ast(d->ast);
+    // 每个 -exec ... + 子句一个参数缓冲区，所有 -exec 共享一个子进程池
+    init_batches(d);
+    if (has_exec)
+        d->procs = procs_create(d->exec_jobs);
+    return 0;
 }
 
 int create_c_list(struct data *d)
@@ -231,7 +537,7 @@ int create_c_list(struct data *d)
     char **args;
     for (size_t i = 0; i < d->el_size; i++)
     {
-        if (my_strcmp("-print", d->exp_list[i]) == 0)
+        if (my_strcmp("-print", d->exp_list[i]) == 0 || my_strcmp("-print0", d->exp_list[i]) == 0)
             add_compound(d, d->exp_list[i], NULL, PRINT);
         else if (my_strcmp("-a", d->exp_list[i]) == 0)
             add_compound(d, d->exp_list[i], NULL, AND);
@@ -243,6 +549,97 @@ int create_c_list(struct data *d)
             add_compound(d, d->exp_list[i], NULL, PAO);
         else if (my_strcmp(")", d->exp_list[i]) == 0)
             add_compound(d, d->exp_list[i], NULL, PAC);
+        else if (my_strcmp("-prune", d->exp_list[i]) == 0)
+        {
+            add_compound(d, d->exp_list[i], NULL, CONDITION);
+            d->c_list[d->cl_size]->pred.kind = PRED_PRUNE;
+        }
+        else if (my_strcmp("-quit", d->exp_list[i]) == 0)
+        {
+            add_compound(d, d->exp_list[i], NULL, CONDITION);
+            d->c_list[d->cl_size]->pred.kind = PRED_QUIT;
+        }
+        else if (my_strcmp("-limit", d->exp_list[i]) == 0)
+        {
+            if (i >= d->el_size - 1 || !is_number(d->exp_list[i + 1]) || atol(d->exp_list[i + 1]) < 1)
+            {
+                d->return_value = 1;
+                fprintf(stderr, "-limit requires a positive count\n");
+                return 1;
+            }
+            args = calloc(2, sizeof(char *));
+            args[0] = d->exp_list[i + 1];
+            add_compound(d, d->exp_list[i], args, CONDITION);
+            d->c_list[d->cl_size]->pred.kind = PRED_LIMIT;
+            d->c_list[d->cl_size]->pred.limit = atol(d->exp_list[i + 1]);
+            i++;
+        }
+        // 与 find 一致，深度选项可以出现在表达式中的任何位置，求值时总是为真
+        else if (my_strcmp("-maxdepth", d->exp_list[i]) == 0 || my_strcmp("-mindepth", d->exp_list[i]) == 0)
+        {
+            if (i >= d->el_size - 1 || !is_number(d->exp_list[i + 1]))
+            {
+                d->return_value = 1;
+                fprintf(stderr, "%s requires a non-negative depth\n", d->exp_list[i]);
+                return 1;
+            }
+            if (d->exp_list[i][1] == 'm' && d->exp_list[i][2] == 'a')
+                d->maxdepth = atoi(d->exp_list[i + 1]);
+            else
+                d->mindepth = atoi(d->exp_list[i + 1]);
+            args = calloc(2, sizeof(char *));
+            args[0] = d->exp_list[i + 1];
+            add_compound(d, d->exp_list[i], args, CONDITION);
+            d->c_list[d->cl_size]->pred.kind = PRED_TRUE;
+            i++;
+        }
+        else if (my_strcmp("-empty", d->exp_list[i]) == 0)
+        {
+            add_compound(d, d->exp_list[i], NULL, CONDITION);
+            parse_attr_predicate(d, d->c_list[d->cl_size]);
+        }
+        else if (my_strcmp("-size", d->exp_list[i]) == 0 ||
+                 my_strcmp("-mtime", d->exp_list[i]) == 0 ||
+                 my_strcmp("-mmin", d->exp_list[i]) == 0 ||
+                 my_strcmp("-newer", d->exp_list[i]) == 0)
+        {
+            if (i >= d->el_size - 1)
+            {
+                d->return_value = 1;
+                fprintf(stderr, "%s requires an argument\n", d->exp_list[i]);
+                return 1;
+            }
+            args = calloc(2, sizeof(char *));
+            args[0] = d->exp_list[i + 1];
+            add_compound(d, d->exp_list[i], args, CONDITION);
+            if (parse_attr_predicate(d, d->c_list[d->cl_size]))
+            {
+                d->cl_size++;
+                d->return_value = 1;
+                return 1;
+            }
+            i++;
+        }
+        else if (my_strcmp("-contains", d->exp_list[i]) == 0 ||
+                 my_strcmp("-contains-regex", d->exp_list[i]) == 0)
+        {
+            if (i >= d->el_size - 1)
+            {
+                d->return_value = 1;
+                fprintf(stderr, "%s requires an argument\n", d->exp_list[i]);
+                return 1;
+            }
+            args = calloc(2, sizeof(char *));
+            args[0] = d->exp_list[i + 1];
+            add_compound(d, d->exp_list[i], args, CONDITION);
+            if (parse_contains_predicate(d, d->c_list[d->cl_size]))
+            {
+                d->cl_size++;
+                d->return_value = 1;
+                return 1;
+            }
+            i++;
+        }
         else if (my_strcmp("-type", d->exp_list[i]) == 0 ||
                  my_strcmp("-name", d->exp_list[i]) == 0 ||
                  my_strcmp("-perm", d->exp_list[i]) == 0)
@@ -256,21 +653,25 @@ int create_c_list(struct data *d)
             args = calloc(2, sizeof(char *));
             args[0] = d->exp_list[i + 1];
             add_compound(d, d->exp_list[i], args, CONDITION);
+            parse_predicate(d->c_list[d->cl_size]);
             i++;
         }
         else
         {
             size_t index = 1;
-            // Need handle wrong commands
-            while (my_strcmp(";", d->exp_list[i + index]) && my_strcmp("+", d->exp_list[i + index]))
+            // 与 find 一致，只有紧跟在 {} 之后的 + 才结束命令
+            for (;; index++)
             {
-                index++;
-                if (index >= d->el_size)
+                if (i + index >= d->el_size || (index == 1 && my_strcmp(";", d->exp_list[i + index]) == 0))
                 {
                     d->return_value = 1;
                     fprintf(stderr, "-exec invalid syntaxe\n");
                     return 1;
                 }
+                if (my_strcmp(";", d->exp_list[i + index]) == 0)
+                    break;
+                if (index > 1 && my_strcmp("+", d->exp_list[i + index]) == 0 && my_strcmp("{}", d->exp_list[i + index - 1]) == 0)
+                    break;
             }
             args = calloc(index, sizeof(char *));
             for (size_t j = 0; j < index - 1; j++)
@@ -278,7 +679,19 @@ int create_c_list(struct data *d)
             if (my_strcmp(";", d->exp_list[index + i]) == 0)
                 add_compound(d, d->exp_list[i], args, EXEC);
             else
+            {
                 add_compound(d, d->exp_list[i], args, EXECP);
+                d->c_list[d->cl_size]->batch = d->nbatches++;
+                // 路径只能追加在参数末尾，{} 不能出现在其他参数中
+                for (size_t j = 0; j + 2 < index; j++)
+                    if (brackets_finder(args[j]) == 0)
+                    {
+                        d->cl_size++;
+                        d->return_value = 1;
+                        fprintf(stderr, "Only one instance of {} is supported with -exec ... +\n");
+                        return 1;
+                    }
+            }
             i += index;
         }
         d->cl_size++;
@@ -347,208 +760,306 @@ void build_ast(struct ast *ast)
     }
 }
 
-int exec_ast(struct data *d, struct ast *parent, struct ast *ast, struct node *n, int child)
+// -type 的类型字母对应的 S_IF* 位图中的一位
+#define TYPE_BIT(mode) (1u << (((mode) & S_IFMT) >> 12))
+
+void parse_predicate(struct compound *c)
 {
-    int status = 0;
-    switch (ast->et)
+    static const char letters[] = "bcdflps";
+    static const mode_t modes[] = {S_IFBLK, S_IFCHR, S_IFDIR, S_IFREG, S_IFLNK, S_IFIFO, S_IFSOCK};
+    char *arg = c->args[0];
+    c->pred.pattern = arg;
+    c->pred.types = 0;
+    c->pred.perm = -1;
+    c->pred.glob = NULL;
+    if (my_strcmp("-name", c->name) == 0)
     {
-    case THEN:
-        if (ast->left->et == NO)
-        {
-            if (exec_ast(d, ast, ast->right, n, 1))
-            {
-                parent->rvalue[child] = 0;
-                return 0;
-            }
-            else
-            {
-                parent->rvalue[0] = 1;
-                parent->rvalue[1] = 1;
-                return 1;
-            }
-        }
-        else if (exec_ast(d, ast, ast->left, n, 0))
-        {
-            if (ast->right)
-                exec_ast(d, ast, ast->right, n, 1);
-            else
-                ast->rvalue[1] = 1;
-        }
-        if (ast->rvalue[0] == 1 && ast->rvalue[1] == 1)
-        {
-            parent->rvalue[child] = 1;
-            return 1;
-        }
-        else
-        {
-            parent->rvalue[child] = 0;
-            return 0;
-        }
-        break;
-    case AND:
-        if (exec_ast(d, ast, ast->left, n, 0) && exec_ast(d, ast, ast->right, n, 1))
-        {
-            parent->rvalue[child] = 1;
-            return 1;
-        }
-        else
-        {
-            parent->rvalue[child] = 0;
-            return 1;
-        }
-        break;
-    case OR:
-        if (exec_ast(d, ast, ast->left, n, 0) || exec_ast(d, ast, ast->right, n, 1))
-        {
-            parent->rvalue[child] = 1;
-            return 1;
-        }
-        else
+        c->pred.kind = PRED_NAME;
+        c->pred.glob = glob_compile(arg);
+    }
+    else if (my_strcmp("-type", c->name) == 0)
+    {
+        c->pred.kind = PRED_TYPE;
+        for (int i = 0; letters[i]; i++)
+            if (arg[0] == letters[i] && arg[1] == '\0')
+                c->pred.types = TYPE_BIT(modes[i]);
+    }
+    else
+    {
+        c->pred.kind = PRED_PERM;
+        if (!fnmatch("[0-7][0-7][0-7]", arg, 0))
+            c->pred.perm = octal_to_dec(my_stroi(arg, 0));
+    }
+}
+
+// -size 的单位后缀对应的字节数，默认为 512 字节的块；无效的后缀返回 0
+static int64_t size_unit(char suffix)
+{
+    switch (suffix)
+    {
+    case '\0':
+    case 'b':
+        return 512;
+    case 'c':
+        return 1;
+    case 'w':
+        return 2;
+    case 'k':
+        return 1024;
+    case 'M':
+        return 1024 * 1024;
+    case 'G':
+        return 1024 * 1024 * 1024;
+    default:
+        return 0;
+    }
+}
+
+// 解析 [+-]N，返回 N 之后的字符；不是数字时返回 NULL
+static char *parse_cmp_num(char *arg, struct predicate *p)
+{
+    char *end;
+    p->cmp = 0;
+    if (*arg == '+' || *arg == '-')
+        p->cmp = *arg++ == '+' ? 1 : -1;
+    if (*arg < '0' || *arg > '9')
+        return NULL;
+    errno = 0;
+    p->num = strtoll(arg, &end, 10);
+    return errno ? NULL : end;
+}
+
+int parse_attr_predicate(struct data *d, struct compound *c)
+{
+    struct predicate *p = &c->pred;
+    struct timespec now;
+    struct stat sb;
+    char *arg = c->args ? c->args[0] : NULL;
+    char *rest;
+    p->pattern = arg;
+    p->types = 0;
+    p->perm = -1;
+    p->glob = NULL;
+    p->follow = d->option == 2;
+    p->exact = 0;
+    p->unit = 1;
+    if (my_strcmp("-empty", c->name) == 0)
+    {
+        p->kind = PRED_EMPTY;
+        p->mask = STATX_SIZE;
+        return 0;
+    }
+    if (my_strcmp("-newer", c->name) == 0)
+    {
+        p->kind = PRED_NEWER;
+        p->mask = STATX_MTIME;
+        // 参考文件只在解析时获取一次；与 find 一致，-H 和 -L 时跟随符号链接
+        if ((d->option ? stat(arg, &sb) : lstat(arg, &sb)) == -1)
         {
-            parent->rvalue[child] = 0;
+            fprintf(stderr, "\'%s\' : %s\n", arg, strerror(errno));
             return 1;
         }
-        break;
-    case PRINT:
-        printf("%s\n", n->name);
-        parent->rvalue[child] = 1;
+        p->ref = (int64_t)sb.st_mtim.tv_sec * NSEC + sb.st_mtim.tv_nsec;
+        return 0;
+    }
+    rest = parse_cmp_num(arg, p);
+    if (my_strcmp("-size", c->name) == 0)
+    {
+        p->kind = PRED_SIZE;
+        p->mask = STATX_SIZE;
+        if (rest && (p->unit = size_unit(*rest)) && *rest)
+            rest++;
+    }
+    else
+    {
+        p->kind = PRED_MTIME;
+        p->mask = STATX_MTIME;
+        p->exact = my_strcmp("-mmin", c->name) == 0;
+        p->unit = (p->exact ? 60 : 86400) * NSEC;
+        clock_gettime(CLOCK_REALTIME, &now);
+        p->ref = (int64_t)now.tv_sec * NSEC + now.tv_nsec;
+    }
+    if (!rest || !p->unit || *rest)
+    {
+        fprintf(stderr, "%s : invalid argument \'%s\'\n", c->name, arg);
         return 1;
-        break;
-    case CONDITION:
-        if ((my_strcmp("-name", ast->c_list[0]->name) == 0 &&
-             !fnmatch(ast->c_list[0]->args[0], n->name_wp, 0)) ||
-            (my_strcmp("-type", ast->c_list[0]->name) == 0 &&
-             ((my_strcmp("b", ast->c_list[0]->args[0]) == 0 && S_ISBLK(n->type)) ||
-              (my_strcmp("c", ast->c_list[0]->args[0]) == 0 && S_ISCHR(n->type)) ||
-              (my_strcmp("d", ast->c_list[0]->args[0]) == 0 && S_ISDIR(n->type)) ||
-              (my_strcmp("f", ast->c_list[0]->args[0]) == 0 && S_ISREG(n->type)) ||
-              (my_strcmp("l", ast->c_list[0]->args[0]) == 0 && S_ISLNK(n->type)) ||
-              (my_strcmp("p", ast->c_list[0]->args[0]) == 0 && S_ISFIFO(n->type)) ||
-              (my_strcmp("s", ast->c_list[0]->args[0]) == 0 && S_ISSOCK(n->type)))))
-        {
-            parent->rvalue[child] = 1;
-            return 1;
-        }
-        else if (my_strcmp("-perm", ast->c_list[0]->name) == 0)
-        {
-            int m = n->type & (S_IRWXU | S_IRWXG | S_IRWXO);
-            if (!fnmatch("???", ast->c_list[0]->args[0], 0))
-            {
-                int arg_mod = my_stroi(ast->c_list[0]->args[0], 0);
-                int arg_dec = octal_to_dec(arg_mod);
-                if (m == arg_dec)
-                {
-                    parent->rvalue[child] = 1;
-                    return 1;
-                }
-                else
-                {
-                    parent->rvalue[child] = 0;
-                    return 0;
-                }
-            }
-            else
-            {
-                parent->rvalue[child] = 0;
-                return 0;
-            }
-        }
-        else
-        {
-            parent->rvalue[child] = 0;
-            return 0;
-        }
-        break;
-    case EXECP:
-        if (ast->cl_size > 0)
-        {
-            size_t i = 0;
-            while (ast->c_list[0]->args[i] != NULL)
-                i++;
-            char **new_args = calloc(i + 1, sizeof(char *));
-            for (size_t j = 0; j < i; j++)
-                if (brackets_finder(ast->c_list[0]->args[j]) == 0)
-                    // 进入该if，保证已经存在一对紧密相连的大括号{}
-                    new_args[j] = replace_echo(ast->c_list[0]->args[j], n->name);
-                else
-                    new_args[j] = my_strcp(ast->c_list[0]->args[j]);\
-            // 用于记录exec命令，用于处理未到达批处理临界的最后一批次数据
-            d->batch_command = my_strcp(new_args[0]);
-            for (size_t j = 1; j < i; j++)
-            {
-                // 考虑到垃圾回收机制，字符串拷贝时需要使用my_strcp，而不能直接赋值
-                if (!add_batch_file(d, new_args[1]))
-                {
-                    char **new_args_batch = calloc(d->bfl_size + 2, sizeof(char *));
-                    new_args_batch[0] = my_strcp(new_args[0]);
-                    for (int k = 1; k <= d->bfl_size; k++)
-                        new_args_batch[k] = my_strcp(d->batch_file_list[k - 1]);
-                    new_args_batch[d->bfl_size + 1] = NULL;
-                    pid_t pid = fork();
-                    // child
-                    if (pid == 0)
-                    {
-                        execvp(new_args_batch[0], new_args_batch);
-                        fprintf(stderr, "An error occured while execvp\n");
-                        exit(1);
-                    }
-                    // father
-                    else
-                    {
-                        waitpid(pid, &status, 0);
-                        for (size_t k = 0; k < d->bfl_size + 2; k++)
-                            free(new_args_batch[k]);
-                        free(new_args_batch);
-                    }
-                    free_bfl(d);
-                    add_batch_file(d, new_args[i]);
-                }
-            }
-            for (size_t j = 0; j < i; j++)
-                free(new_args[j]);
-            free(new_args);
-        }
-        return status;
-        break;
-    case EXEC:
-        if (ast->cl_size > 0)
-        {
-            size_t i = 0;
-            while (ast->c_list[0]->args[i] != NULL)
-                i++;
-            char **new_args = calloc(i + 1, sizeof(char *));
-            for (size_t j = 0; j < i; j++)
-                if (brackets_finder(ast->c_list[0]->args[j]) == 0)
-                    // 进入该if，保证已经存在一对紧密相连的大括号{}
-                    new_args[j] = replace_echo(ast->c_list[0]->args[j], n->name);
-                else
-                    new_args[j] = my_strcp(ast->c_list[0]->args[j]);
-            pid_t pid = fork();
-            // child
-            if (pid == 0)
-            {
-                execvp(new_args[0], new_args);
-                fprintf(stderr, "An error occured while execvp\n");
-                exit(1);
-            }
-            // father
-            else
-            {
-                waitpid(pid, &status, 0);
-                for (size_t j = 0; j < i + 1; j++)
-                    free(new_args[j]);
-                free(new_args);
-            }
-        }
-        return status;
-        break;
-    default:
+    }
+    return 0;
+}
+
+// 按 +N、-N、N 比较
+static int cmp_num(int cmp, int64_t value, int64_t n)
+{
+    if (cmp > 0)
+        return value > n;
+    if (cmp < 0)
+        return value < n;
+    return value == n;
+}
+
+int match_size(struct compound *c, struct node *n)
+{
+    if (node_attr(n, c->pred.mask, c->pred.follow))
         return 0;
-        break;
+    return cmp_num(c->pred.cmp, (int64_t)((n->size + c->pred.unit - 1) / c->pred.unit), c->pred.num);
+}
+
+int match_mtime(struct compound *c, struct node *n)
+{
+    int64_t age, units;
+    if (node_attr(n, c->pred.mask, c->pred.follow))
+        return 0;
+    age = c->pred.ref - n->mtime;
+    // -mmin N 表示 (N-1, N] 分钟之前
+    if (c->pred.exact)
+    {
+        units = c->pred.num * c->pred.unit;
+        if (c->pred.cmp)
+            return c->pred.cmp > 0 ? age > units : age < units;
+        return age > units - c->pred.unit && age <= units;
     }
+    // 向下取整，修改时间在将来时为负数
+    units = age >= 0 ? age / c->pred.unit : -((-age + c->pred.unit - 1) / c->pred.unit);
+    return cmp_num(c->pred.cmp, units, c->pred.num);
+}
+
+int match_newer(struct compound *c, struct node *n)
+{
+    return node_attr(n, c->pred.mask, c->pred.follow) == 0 && n->mtime > c->pred.ref;
+}
+
+int match_empty(struct compound *c, struct node *n)
+{
+    struct dir_reader r;
+    struct dir_entry e;
+    mode_t mode = c->pred.follow ? node_r_type(n) : node_ftype(n);
+    int fd, empty;
+    if (S_ISREG(mode))
+        return node_attr(n, c->pred.mask, c->pred.follow) == 0 && n->size == 0;
+    if (!S_ISDIR(mode))
+        return 0;
+    // 只需要知道是否有第一个目录项
+    fd = openat(n->dirfd, n->dirfd == AT_FDCWD ? n->name : n->name_wp, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1 || dir_open(&r, fd, 0) == -1)
+        return 0;
+    empty = !dir_next(&r, &e);
+    dir_close(&r);
+    return empty;
+}
+
+int parse_contains_predicate(struct data *d, struct compound *c)
+{
+    struct predicate *p = &c->pred;
+    p->kind = PRED_CONTAINS;
+    p->pattern = c->args[0];
+    p->perm = -1;
+    p->follow = d->option == 2;
+    p->content.needle = p->pattern;
+    p->content.len = my_strlen(p->pattern);
+    p->content.skip_binary = d->skip_binary;
+    if (my_strcmp("-contains-regex", c->name) == 0)
+        return content_compile_regex(&p->content, p->pattern);
     return 0;
 }
 
+int match_contains(struct compound *c, struct node *n)
+{
+    // 类型通常来自 d_type，不是普通文件时不需要打开
+    mode_t mode = c->pred.follow ? node_r_type(n) : node_ftype(n);
+    if (!S_ISREG(mode))
+        return 0;
+    return content_match(n->dirfd, n->dirfd == AT_FDCWD ? n->name : n->name_wp, &c->pred.content) == 1;
+}
+
+int match_name(struct compound *c, struct node *n)
+{
+    return glob_match(c->pred.glob, n->name_wp);
+}
+
+int match_type(struct compound *c, struct node *n)
+{
+    return (c->pred.types & TYPE_BIT(node_ftype(n))) != 0;
+}
+
+int match_perm(struct compound *c, struct node *n)
+{
+    return c->pred.perm >= 0 && (int)(node_type(n) & (S_IRWXU | S_IRWXG | S_IRWXO)) == c->pred.perm;
+}
+
+int match_limit(struct compound *c)
+{
+    size_t hits = __atomic_add_fetch(&c->pred.hits, 1, __ATOMIC_ACQ_REL);
+    if (hits >= c->pred.limit)
+        request_quit();
+    return hits <= c->pred.limit;
+}
+
+void request_quit(void)
+{
+    __atomic_store_n(&quit_flag, 1, __ATOMIC_RELEASE);
+}
+
+int quit_requested(void)
+{
+    return __atomic_load_n(&quit_flag, __ATOMIC_ACQUIRE);
+}
+
+int exec_batch(struct data *d, struct compound *c, struct node *n)
+{
+    struct batch *b = &d->batches[c->batch];
+    // 超过参数字节预算时先执行已经累积的一批
+    if (!batch_fits(b, n->name))
+    {
+        out_flush(d->out);
+        batch_flush(b, d->procs);
+    }
+    batch_add(b, n->name);
+    // 与 find 一致，-exec ... + 总是为真
+    return 1;
+}
+
+// 将参数中的 {} 替换为节点路径，返回以 NULL 结尾的新参数数组
+static char **exec_args(struct compound *c, struct node *n)
+{
+    size_t i = 0;
+    while (c->args[i] != NULL)
+        i++;
+    char **new_args = calloc(i + 1, sizeof(char *));
+    for (size_t j = 0; j < i; j++)
+        if (brackets_finder(c->args[j]) == 0)
+            // 进入该if，保证已经存在一对紧密相连的大括号{}
+            new_args[j] = replace_echo(c->args[j], n->name);
+        else
+            new_args[j] = my_strcp(c->args[j]);
+    return new_args;
+}
+
+static void free_args(char **args)
+{
+    for (size_t j = 0; args[j]; j++)
+        free(args[j]);
+    free(args);
+}
+
+int exec_command(struct data *d, struct compound *c, struct node *n)
+{
+    char **new_args = exec_args(c, n);
+    out_flush(d->out);
+    int r = exec_run(new_args);
+    free_args(new_args);
+    return r;
+}
+
+int exec_spawn(struct data *d, struct compound *c, struct node *n)
+{
+    char **new_args = exec_args(c, n);
+    out_flush(d->out);
+    procs_spawn(d->procs, new_args, 0);
+    free_args(new_args);
+    // 结果不被使用
+    return 1;
+}
+
 void my_realloc(struct data *d, int id)
 {
     if (id == 0)
@@ -561,26 +1072,11 @@ void my_realloc(struct data *d, int id)
         d->el_capacity *= 2;
         d->exp_list = realloc(d->exp_list, d->el_capacity * sizeof(char *));
     }
-    else if (id == 2)
-    {
-        d->no_capacity *= 2;
-        d->nodes = realloc(d->nodes, d->no_capacity * sizeof(struct node *));
-    }
-    else if (id == 3)
-    {
-        d->il_capacity *= 2;
-        d->inode_list = realloc(d->inode_list, d->il_capacity * sizeof(int));
-    }
     else if (id == 4)
     {
         d->cl_capacity *= 2;
         d->c_list = realloc(d->c_list, d->cl_capacity * sizeof(struct compound *));
     }
-    else if (id == 5)
-    {
-        d->bfl_capacity *= 2;
-        d->batch_file_list = realloc(d->batch_file_list, d->bfl_capacity * sizeof(char *));
-    }
 }
 
 void add_search_path(struct data *d, char *name)
@@ -611,45 +1107,30 @@ void add_exp(struct data *d, char *exp)
     }
 }
 
-void add_inode(struct data *d, int ino)
+void eval_node(struct data *d, struct node *n)
 {
-    if (d->il_size < d->il_capacity)
-    {
-        d->inode_list[d->il_size] = ino;
-        d->il_size++;
-    }
-    else
+    // 比 -mindepth 浅的节点仍然遍历，但不求值；请求结束遍历之后不再求值
+    if (d->depth < d->mindepth || quit_requested())
+        return;
+    if (run_program(d, d->prog, n) && !d->actions)
     {
-        my_realloc(d, 3);
-        add_inode(d, ino);
+        if (d->dupes)
+            dupes_add(d, n);
+        else
+            print_path(d, n->name, '\n');
     }
 }
 
-int inode_exists(struct data *d, int ino)
-{
-    for (size_t i = 0; i < d->il_size; i++)
-        if (d->inode_list[i] == ino)
-            return 1;
-    return 0;
-}
-
-void add_node(char *name, char *name_wp, mode_t type, mode_t r_type,
-              struct data *d)
+void print_path(struct data *d, char *name, char term)
 {
-    struct node *n = calloc(sizeof(struct node), 1);
-    n->name = name;
-    n->name_wp = name_wp;
-    n->type = type;
-    n->r_type = r_type;
-    if (d->no_size >= d->no_capacity)
-        my_realloc(d, 2);
-    d->nodes[d->no_size] = n;
-    d->no_size++;
-    if (d->ast->left)
-        exec_ast(d, d->ast, d->ast, n, 0);
-    if (!d->actions && d->ast->rvalue[0] == 1 && d->ast->rvalue[1] == 1)
-        printf("%s\n", n->name);
-    reset_rvalues(d->ast);
+    stats_local.bytes += my_strlen(name) + 1;
+    if (d->task && d->ordered)
+    {
+        task_append(d->task, name, my_strlen(name));
+        task_append(d->task, &term, 1);
+    }
+    else
+        out_record(d->out, name, my_strlen(name), term);
 }
 
 void add_compound(struct data *d, char *name, char **args, enum enum_type et)
@@ -663,82 +1144,276 @@ void add_compound(struct data *d, char *name, char **args, enum enum_type et)
     d->c_list[d->cl_size] = c;
 }
 
-int add_batch_file(struct data *d, char *batch_file)
+void parse_dir(int fd, char *name, struct data *d)
 {
-    if (d->bfl_size < d->bfl_capacity)
+    struct dir_reader r;
+    struct stat sb;
+    int tracked = 0; // 是否已将该目录加入祖先链
+    // 只有 -L 会跟随符号链接形成循环，此时检查目录是否已经在祖先链上
+    if (d->option == 2 && fstat(fd, &sb) == 0)
     {
-        d->batch_file_list[d->bfl_size] = my_strcp(batch_file);
-        d->bfl_size++;
-        return 1;
+        if (!iset_insert(&d->ancestors, sb.st_dev, sb.st_ino))
+        {
+            fprintf(stderr, "\'%s\' : File system loop detected\n", name);
+            d->return_value = 1;
+            close(fd);
+            return;
+        }
+        tracked = 1;
+    }
+    if (d->watch)
+        watch_add(d->watch, name, d->depth);
+    // 目录项比目录本身深一层
+    d->depth++;
+    if (dir_open(&r, fd, d->dirbuf) == -1)
+    {
+        fprintf(stderr, "\'%s\' : %s\n", name, strerror(errno));
+        d->return_value = 1;
+    }
+    else if (d->uring)
+    {
+        parse_dir_uring(&r, fd, name, d);
+        dir_close(&r);
     }
     else
     {
-        if (d->bfl_size >= MAX_BATCH_SIZE)
-            return 0;
-        else
-        {
-            my_realloc(d, 5);
-            add_batch_file(d, batch_file);
-            return 1;
-        }
+        parse_dir_entries(&r, fd, name, d);
+        dir_close(&r);
     }
+    d->depth--;
+    if (tracked)
+        iset_remove(&d->ancestors, sb.st_dev, sb.st_ino);
 }
 
-void parse_dir(char *name, struct data *d)
+void parse_dir_entries(struct dir_reader *r, int fd, char *name, struct data *d)
 {
-    DIR *di = opendir(name);
-    struct dirent *dir;
-    struct stat sb;  // 用于保存符号链接指向的目标文件的信息
-    struct stat sbl; // 用于保存符号链接本身的信息
-    mode_t types[2]; // 存储文件和符号链接的类型
-    int islnk;       // 记录文件是否是符号链接
-    char *new_name;
-    while ((dir = readdir(di)) != NULL)
+    struct dir_entry e;
+    struct node n; // 当前目录项对应的节点，求值后立即释放
+    int sub;       // 需要递归解析的子目录的文件描述符，不需要时为 -1
+    size_t len = my_strlen(name);
+    struct arena_mark m = arena_mark(&d->arena);
+    while (!quit_requested() && dir_next(r, &e))
     {
-        if (my_strcmp(dir->d_name, ".") == 0 || my_strcmp(dir->d_name, "..") == 0)
-            continue;
-        new_name = my_concate(name, dir->d_name);
-        lstat(new_name, &sbl); // 获取符号链接本身的信息
-        stat(new_name, &sb);   // 获取的是符号链接指向的目标文件的信息
-        islnk = S_ISLNK(sbl.st_mode);
-        types[0] = sbl.st_mode;
-        types[1] = sb.st_mode;
-        // 深度优先搜索
+        // 路径在竞技场中拼接，处理完该目录项（包括子目录）后回退，下一个目录项复用同一块内存
+        n.name = arena_path(&d->arena, name, len, e.name);
+        n.name_wp = e.name;
+        n.dirfd = fd;
+        n.type = dtype_to_mode(e.type);
+        n.flags = n.type ? NODE_FTYPE : 0;
+        // 广度优先搜索：先处理目录本身，求值结果（-prune）决定是否进入
+        if (!d->d_checked)
+            eval_node(d, &n);
+        // 如果是目录，检查是否符号链接或选项允许递归解析
+        sub = node_descend(d, &n) ? open_subdir(d, fd, e.name, n.name) : -1;
+        if (sub != -1)
+            parse_dir(sub, n.name, d);
+        // 深度优先搜索：最后处理目录本身
         if (d->d_checked)
+            eval_node(d, &n);
+        arena_release(&d->arena, m);
+    }
+}
+
+// 先序遍历时节点的类型信息一就绪就求值
+static void eval_ready(struct data *d, struct node *n, void *arg)
+{
+    (void)arg;
+    if (!d->d_checked)
+        eval_node(d, n);
+}
+
+void parse_dir_uring(struct dir_reader *r, int fd, char *name, struct data *d)
+{
+    struct node batch[URING_DEPTH];
+    struct dir_entry e;
+    size_t count;
+    size_t len = my_strlen(name);
+    size_t prefix = len;
+    int sub;
+    struct arena_mark m = arena_mark(&d->arena);
+    // arena_path 只在目录名不以 '/' 结尾时插入分隔符
+    if (prefix == 0 || name[prefix - 1] != '/')
+        prefix++;
+    do
+    {
+        for (count = 0; count < URING_DEPTH && dir_next(r, &e); count++)
         {
-            // 如果是目录，检查是否符号链接或选项允许递归解析
-            if (S_ISDIR(sb.st_mode) && (!islnk || d->option == 2))
-            {
-                // 检查是否已解析过该inode
-                if (inode_exists(d, sb.st_ino))
-                    d->return_value = 1;
-                else
-                {
-                    add_inode(d, sb.st_ino);
-                    parse_dir(new_name, d);
-                }
-            }
-            add_node(new_name, my_strcp(dir->d_name), types[0], types[1], d);
+            // 名称在下一次 dir_next 之后失效，因此指向完整路径中的文件名部分
+            batch[count].name = arena_path(&d->arena, name, len, e.name);
+            batch[count].name_wp = batch[count].name + prefix;
+            batch[count].dirfd = fd;
+            batch[count].type = dtype_to_mode(e.type);
+            batch[count].flags = batch[count].type ? NODE_FTYPE : 0;
+        }
+        uring_stat_batch(d->uring, d, batch, count, eval_ready, NULL);
+        // 队列已清空，再依次进入子目录
+        for (size_t i = 0; i < count; i++)
+        {
+            sub = node_descend(d, &batch[i]) ? open_subdir(d, fd, batch[i].name_wp, batch[i].name) : -1;
+            if (sub != -1)
+                parse_dir(sub, batch[i].name, d);
+            if (d->d_checked)
+                eval_node(d, &batch[i]);
         }
-        // 广度优先搜索
+        arena_release(&d->arena, m);
+    } while (count == URING_DEPTH && !quit_requested());
+}
+
+mode_t dtype_to_mode(unsigned char d_type)
+{
+    switch (d_type)
+    {
+    case DT_REG:
+        return S_IFREG;
+    case DT_DIR:
+        return S_IFDIR;
+    case DT_LNK:
+        return S_IFLNK;
+    case DT_BLK:
+        return S_IFBLK;
+    case DT_CHR:
+        return S_IFCHR;
+    case DT_FIFO:
+        return S_IFIFO;
+    case DT_SOCK:
+        return S_IFSOCK;
+    default:
+        return 0;
+    }
+}
+
+mode_t node_ftype(struct node *n)
+{
+    if (n->flags & (NODE_FTYPE | NODE_LSTAT))
+        return n->type & S_IFMT;
+    return node_type(n) & S_IFMT;
+}
+
+mode_t node_type(struct node *n)
+{
+    struct stat sb;
+    if (!(n->flags & NODE_LSTAT))
+    {
+        char *at_name = n->dirfd == AT_FDCWD ? n->name : n->name_wp;
+        n->type = fstatat(n->dirfd, at_name, &sb, AT_SYMLINK_NOFOLLOW) == 0 ? sb.st_mode : 0;
+        STATS_INC(lstats);
+        n->flags |= NODE_FTYPE | NODE_LSTAT;
+    }
+    return n->type;
+}
+
+mode_t node_r_type(struct node *n)
+{
+    struct stat sb;
+    if (!(n->flags & NODE_STAT))
+    {
+        if (!S_ISLNK(node_ftype(n)))
+            n->r_type = node_type(n);
         else
         {
-            add_node(new_name, my_strcp(dir->d_name), types[0], types[1], d);
-            // 如果是目录，检查是否符号链接或选项允许递归解析
-            if (S_ISDIR(sb.st_mode) && (!islnk || d->option == 2))
-            {
-                // 检查是否已解析过该inode
-                if (inode_exists(d, sb.st_ino))
-                    d->return_value = 1;
-                else
-                {
-                    add_inode(d, sb.st_ino);
-                    parse_dir(new_name, d);
-                }
-            }
+            char *at_name = n->dirfd == AT_FDCWD ? n->name : n->name_wp;
+            n->r_type = fstatat(n->dirfd, at_name, &sb, 0) == 0 ? sb.st_mode : 0;
+            STATS_INC(stats);
         }
+        n->flags |= NODE_STAT;
+    }
+    return n->r_type;
+}
+
+// glibc 只在 _GNU_SOURCE 下声明 statx，直接使用系统调用
+static int sys_statx(int dirfd, char *name, int flags, unsigned int mask, struct statx *stx)
+{
+#ifdef SYS_statx
+    return syscall(SYS_statx, dirfd, name, flags, mask, stx);
+#else
+    (void)dirfd;
+    (void)name;
+    (void)flags;
+    (void)mask;
+    (void)stx;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+int node_attr(struct node *n, unsigned int mask, int follow)
+{
+    struct statx stx;
+    struct stat sb;
+    char *at_name = n->dirfd == AT_FDCWD ? n->name : n->name_wp;
+    mode_t mode;
+    if (n->flags & (NODE_ATTR | NODE_NOATTR))
+        return n->flags & NODE_NOATTR ? -1 : 0;
+    if (follow)
+        STATS_INC(stats);
+    else
+        STATS_INC(lstats);
+    // 文件类型和模式总是一起请求，不跟随符号链接时可以代替之后的 lstat
+    // 与 find 一致，跟随指向不存在的文件的符号链接时使用链接本身的属性
+    if (sys_statx(n->dirfd, at_name, follow ? 0 : AT_SYMLINK_NOFOLLOW, mask | STATX_TYPE | STATX_MODE, &stx) == 0 ||
+        (follow && errno == ENOENT &&
+         sys_statx(n->dirfd, at_name, AT_SYMLINK_NOFOLLOW, mask | STATX_TYPE | STATX_MODE, &stx) == 0))
+    {
+        mode = stx.stx_mode;
+        n->size = stx.stx_size;
+        n->dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+        n->ino = stx.stx_ino;
+        n->mtime = (int64_t)stx.stx_mtime.tv_sec * NSEC + stx.stx_mtime.tv_nsec;
+    }
+    else if (errno == ENOSYS && fstatat(n->dirfd, at_name, &sb, follow ? 0 : AT_SYMLINK_NOFOLLOW) == 0)
+    {
+        mode = sb.st_mode;
+        n->size = sb.st_size;
+        n->dev = sb.st_dev;
+        n->ino = sb.st_ino;
+        n->mtime = (int64_t)sb.st_mtim.tv_sec * NSEC + sb.st_mtim.tv_nsec;
+    }
+    else
+    {
+        n->flags |= NODE_NOATTR;
+        return -1;
+    }
+    n->flags |= NODE_ATTR;
+    if (!follow && !(n->flags & NODE_LSTAT))
+    {
+        n->type = mode;
+        n->flags |= NODE_FTYPE | NODE_LSTAT;
+    }
+    else if (follow && !(n->flags & NODE_STAT))
+    {
+        n->r_type = mode;
+        n->flags |= NODE_STAT;
+    }
+    return 0;
+}
+
+int node_is_dir(struct data *d, struct node *n)
+{
+    mode_t ftype = node_ftype(n);
+    if (S_ISDIR(ftype))
+        return 1;
+    // 只有 -L 才跟随遍历过程中遇到的符号链接
+    return S_ISLNK(ftype) && d->option == 2 && S_ISDIR(node_r_type(n));
+}
+
+int node_descend(struct data *d, struct node *n)
+{
+    if ((n->flags & NODE_PRUNE) || quit_requested())
+        return 0;
+    if (d->maxdepth >= 0 && d->depth >= d->maxdepth)
+        return 0;
+    return node_is_dir(d, n);
+}
+
+int open_subdir(struct data *d, int fd, char *name, char *path)
+{
+    int sub = openat(fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (sub == -1)
+    {
+        fprintf(stderr, "\'%s\' : %s\n", path, strerror(errno));
+        d->return_value = 1;
     }
-    closedir(di);
+    return sub;
 }
 
 int find_close(struct ast *ast, int i)
@@ -780,7 +1455,7 @@ int search_OR_AND(struct ast *ast, unsigned int type)
             return 1;
         }
         else if (ast->c_list[i]->et == PAO)
-            i += find_close(ast, i);
+            i = find_close(ast, i);
     }
     return 0;
 }
@@ -845,40 +1520,17 @@ int is_ast_valid(struct data *d, struct ast *parent, struct ast *ast, int child)
     case EXECP:
         d->actions = 1;
         break;
+    // 与 find 一致，-quit 是一个动作，表达式中有它时不再默认打印
+    case CONDITION:
+        if (ast->c_list[0]->pred.kind == PRED_QUIT)
+            d->actions = 1;
+        break;
     default:
         break;
     }
     return is_ast_valid(d, ast, ast->left, 0) + is_ast_valid(d, ast, ast->right, 1);
 }
 
-void reset_rvalues(struct ast *root)
-{
-    if (!root)
-        return;
-    root->rvalue[0] = 1;
-    root->rvalue[1] = 1;
-    reset_rvalues(root->left);
-    reset_rvalues(root->right);
-}
-
-void free_il(struct data *d)
-{
-    free(d->inode_list);
-    d->inode_list = calloc(10, sizeof(int));
-    d->il_size = 0;
-    d->il_capacity = 10;
-}
-
-void free_bfl(struct data *d)
-{
-    for (int i = 0; i < d->bfl_size; i++)
-        free(d->batch_file_list[i]);
-    free(d->batch_file_list);
-    d->batch_file_list = calloc(10, sizeof(char *));
-    d->bfl_size = 0;
-    d->bfl_capacity = 10;
-}
-
 void free_ast(struct ast *ast)
 {
     if (ast)
@@ -892,74 +1544,89 @@ void free_ast(struct ast *ast)
 
 void free_data(struct data *d)
 {
-    for (size_t i = 0; i < d->no_size; i++)
-    {
-        free(d->nodes[i]->name);
-        free(d->nodes[i]->name_wp);
-        free(d->nodes[i]);
-    }
-    free(d->nodes);
-    
     for (size_t i = 0; i < d->el_size; i++)
         free(d->exp_list[i]);
     free(d->exp_list);
     
-    free(d->inode_list);
+    iset_free(&d->ancestors);
     
     for (size_t i = 0; i < d->spl_size; i++)
         free(d->search_path_list[i]);
     free(d->search_path_list);
     
-    free(d->batch_file_list);
+    free_batches(d);
+    procs_destroy(d->procs);
     
     for (size_t i = 0; i < d->cl_size; i++)
     {
+        glob_free(d->c_list[i]->pred.glob);
+        content_free(&d->c_list[i]->pred.content);
         free(d->c_list[i]->args);
         free(d->c_list[i]);
     }
     free_ast(d->ast);
+    free_program(d->prog);
+    uring_destroy(d->uring);
+    out_destroy(d->out);
+    arena_free(&d->arena);
+    watch_destroy(d->watch);
+    dupes_destroy(d->dupes);
+    content_release();
 }
 
 void print_ast(struct ast *ast, int i, int side)
 {
+    struct estimate e;
     if (!ast)
         return;
-    printf("%i | %i) ", i, side);
+    fprintf(stderr, "%*s%i | %i) ", 2 * i, "", i, side);
     switch (ast->et)
     {
     case THEN:
-        printf("THEN ");
+        fprintf(stderr, "THEN");
         break;
     case AND:
-        printf("AND ");
+        fprintf(stderr, "AND");
         break;
     case OR:
-        printf("OR ");
+        fprintf(stderr, "OR");
         break;
     case NO:
-        printf("NO ");
+        fprintf(stderr, "NO");
         break;
     case PRINT:
-        printf("PRINT ");
+        fprintf(stderr, "PRINT");
         break;
     case CONDITION:
-        printf("condition ");
+        fprintf(stderr, "condition");
         break;
     case EXECP:
     case EXEC:
-        printf("EXEC ");
+        fprintf(stderr, "EXEC");
         break;
     case PAO:
-        printf("PAO ");
+        fprintf(stderr, "PAO");
         break;
     case PAC:
-        printf("PAC ");
+        fprintf(stderr, "PAC");
         break;
     case FAPA:
-        printf("FAPA ");
+        fprintf(stderr, "FAPA");
         break;
     }
-    printf("\n");
+    // 叶子节点输出谓词或动作本身
+    if (ast->et == CONDITION || ast->et == PRINT || ast->et == EXEC || ast->et == EXECP)
+    {
+        fprintf(stderr, " %s", ast->c_list[0]->name);
+        for (char **arg = ast->c_list[0]->args; arg && *arg; arg++)
+            fprintf(stderr, " %s", *arg);
+    }
+    if (ast->et != NO && (ast->et != THEN || ast->left))
+    {
+        e = ast_estimate(ast, OPT_LEVEL_DEFAULT);
+        fprintf(stderr, "  [cost %.2f, p %.3f%s]", e.cost, e.p, e.pure ? "" : ", side effects");
+    }
+    fprintf(stderr, "\n");
     print_ast(ast->left, i + 1, 0);
     print_ast(ast->right, i + 1, 1);
-}
\ No newline at end of file
+}
@@ -0,0 +1,343 @@
+#include "optimize.h"
+#include "globmatch.h"
+
+#include <stdlib.h>
+#include <sys/stat.h>
+
+// 各类测试的代价，单位约为一次名称比较：d_type 可能不可用，stat 是一次系统调用，
+// -empty 对目录还要读取目录项，读取文件内容和启动子进程依次高出一到两个数量级
+#define COST_NAME 1.0
+#define COST_TYPE 2.0
+#define COST_STAT 20.0
+#define COST_EMPTY 25.0
+#define COST_CONTENT 200.0
+#define COST_EXEC 20000.0
+
+// 排序时概率的下限，避免总是为真（或总是为假）的测试的排序键除以 0
+#define MIN_SHARE 1e-6
+
+// 按求值顺序收集的操作数或中间节点
+struct vec
+{
+    struct ast **v;
+    size_t n;
+    size_t cap;
+};
+
+// 链中的一个操作数：ops 中从 start 开始的 len 个元素，即若干个 ! 和它们作用的操作数
+struct unit
+{
+    size_t start;
+    size_t len;
+    struct estimate e;
+    double key;
+};
+
+static void push(struct vec *a, struct ast *x)
+{
+    if (a->n >= a->cap)
+    {
+        a->cap = a->cap ? a->cap * 2 : 8;
+        a->v = realloc(a->v, a->cap * sizeof(struct ast *));
+    }
+    a->v[a->n++] = x;
+}
+
+// -type 接受的各种类型在一般目录树中所占的比例之和
+static double type_share(unsigned int types)
+{
+    double p = 0;
+    for (unsigned int t = 0; t < 16; t++)
+    {
+        if (!(types & (1u << t)))
+            continue;
+        if (t == S_IFREG >> 12)
+            p += 0.85;
+        else if (t == S_IFDIR >> 12)
+            p += 0.1;
+        else if (t == S_IFLNK >> 12)
+            p += 0.03;
+        else
+            p += 0.005;
+    }
+    return p;
+}
+
+static struct estimate leaf_estimate(struct compound *c, int level)
+{
+    struct estimate e = {0, 1, 1};
+    switch (c->et)
+    {
+    case PRINT:
+    case EXECP:
+        e.cost = COST_NAME;
+        e.pure = 0;
+        break;
+    case EXEC:
+        e.cost = COST_EXEC;
+        e.p = 0.5;
+        e.pure = level >= 2;
+        break;
+    case CONDITION:
+        switch (c->pred.kind)
+        {
+        case PRED_NAME:
+            e.cost = COST_NAME;
+            e.p = c->pred.glob && c->pred.glob->kind == GLOB_EXACT ? 0.01 : 0.1;
+            break;
+        case PRED_TYPE:
+            e.cost = COST_TYPE;
+            e.p = type_share(c->pred.types);
+            break;
+        case PRED_PERM:
+            e.cost = COST_STAT;
+            e.p = c->pred.perm < 0 ? 0 : 0.2;
+            break;
+        case PRED_SIZE:
+        case PRED_MTIME:
+        case PRED_NEWER:
+            e.cost = COST_STAT;
+            e.p = 0.3;
+            break;
+        case PRED_EMPTY:
+            e.cost = COST_EMPTY;
+            e.p = 0.05;
+            break;
+        case PRED_CONTAINS:
+            e.cost = COST_CONTENT;
+            e.p = 0.1;
+            break;
+        case PRED_PRUNE:
+        case PRED_QUIT:
+        case PRED_LIMIT:
+            e.pure = 0;
+            break;
+        default:
+            break;
+        }
+        break;
+    default:
+        break;
+    }
+    return e;
+}
+
+// a 为真时才求值 b
+static struct estimate both(struct estimate a, struct estimate b)
+{
+    a.cost += a.p * b.cost;
+    a.p *= b.p;
+    a.pure = a.pure && b.pure;
+    return a;
+}
+
+// a 为假时才求值 b
+static struct estimate either(struct estimate a, struct estimate b)
+{
+    a.cost += (1 - a.p) * b.cost;
+    a.p = 1 - (1 - a.p) * (1 - b.p);
+    a.pure = a.pure && b.pure;
+    return a;
+}
+
+struct estimate ast_estimate(struct ast *ast, int level)
+{
+    struct estimate e = {0, 1, 1};
+    int negate = 0;
+    switch (ast->et)
+    {
+    case AND:
+        return both(ast_estimate(ast->left, level), ast_estimate(ast->right, level));
+    case OR:
+        return either(ast_estimate(ast->left, level), ast_estimate(ast->right, level));
+    case THEN:
+        if (!ast->left)
+            return e;
+        // 与 compile_then 相同：连续的 ! 只作用于其后的一个操作数
+        while (ast->left && ast->left->et == NO && ast->right)
+        {
+            negate = !negate;
+            ast = ast->right;
+        }
+        if (ast->et != THEN)
+        {
+            e = ast_estimate(ast, level);
+            if (negate)
+                e.p = 1 - e.p;
+            return e;
+        }
+        e = ast_estimate(ast->left, level);
+        if (negate)
+            e.p = 1 - e.p;
+        return ast->right ? both(e, ast_estimate(ast->right, level)) : e;
+    case NO:
+        return e;
+    default:
+        return leaf_estimate(ast->c_list[0], level);
+    }
+}
+
+// 按求值顺序展开 THEN 链和 -a，ops 中的 ! 作用于紧随其后的元素
+static void flatten_and(struct ast *ast, struct vec *ops, struct vec *shells)
+{
+    if (ast->et == AND)
+    {
+        flatten_and(ast->left, ops, shells);
+        flatten_and(ast->right, ops, shells);
+        push(shells, ast);
+    }
+    else if (ast->et == THEN && ast->left)
+    {
+        push(ops, ast->left);
+        push(shells, ast);
+        if (ast->right)
+            flatten_and(ast->right, ops, shells);
+    }
+    else
+        push(ops, ast);
+}
+
+// 按求值顺序展开 -o，穿过只有一个操作数的括号
+static void flatten_or(struct ast *ast, struct vec *ops, struct vec *shells)
+{
+    struct ast *inner = ast;
+    while (inner->et == THEN && inner->left && !inner->right)
+        inner = inner->left;
+    if (inner->et != OR)
+    {
+        push(ops, ast);
+        return;
+    }
+    for (; ast != inner; ast = ast->left)
+        push(shells, ast);
+    flatten_or(inner->left, ops, shells);
+    flatten_or(inner->right, ops, shells);
+    push(shells, inner);
+}
+
+// 把 ops 分成操作数，先递归优化每个操作数，再在屏障之间按 key 稳定排序
+static size_t sort_units(struct vec *ops, struct unit *units, int level, int disjunction)
+{
+    size_t count = 0, i, j;
+    struct unit u;
+    double q;
+    for (i = 0; i < ops->n; i++)
+    {
+        u.start = i;
+        while (i + 1 < ops->n && ops->v[i]->et == NO)
+            i++;
+        u.len = i - u.start + 1;
+        optimize_ast(ops->v[i], level);
+        u.e = ast_estimate(ops->v[i], level);
+        if ((u.len - 1) % 2)
+            u.e.p = 1 - u.e.p;
+        // 合取链中先求值容易为假的测试，析取链中先求值容易为真的测试
+        q = disjunction ? u.e.p : 1 - u.e.p;
+        u.key = u.e.cost / (q > MIN_SHARE ? q : MIN_SHARE);
+        units[count++] = u;
+    }
+    for (i = 1; i < count; i++)
+    {
+        if (!units[i].e.pure)
+            continue;
+        u = units[i];
+        for (j = i; j > 0 && units[j - 1].e.pure && units[j - 1].key > u.key; j--)
+            units[j] = units[j - 1];
+        units[j] = u;
+    }
+    return count;
+}
+
+// 取出第 k 个节点：先用 target，再重新使用展开时留下的中间节点，不够时分配新节点
+static struct ast *take_node(struct ast *target, struct vec *shells, size_t *next, size_t k)
+{
+    struct ast *node;
+    if (k == 0)
+        return target;
+    while (*next < shells->n && shells->v[*next] == target)
+        (*next)++;
+    if (*next < shells->n)
+        node = shells->v[(*next)++];
+    else
+        node = calloc(1, sizeof(struct ast));
+    return node;
+}
+
+// 释放没有被重新使用的中间节点，它们的子节点已经移到新的链中
+static void free_shells(struct ast *target, struct vec *shells, size_t next)
+{
+    for (; next < shells->n; next++)
+    {
+        if (shells->v[next] == target)
+            continue;
+        free(shells->v[next]->c_list);
+        free(shells->v[next]);
+    }
+}
+
+static void optimize_and(struct ast *ast, int level)
+{
+    struct vec ops = {NULL, 0, 0}, shells = {NULL, 0, 0};
+    struct ast **order, *node, *prev = NULL;
+    struct unit *units;
+    size_t count, n = 0, next = 0;
+    flatten_and(ast, &ops, &shells);
+    units = malloc(ops.n * sizeof(struct unit));
+    order = malloc(ops.n * sizeof(struct ast *));
+    count = sort_units(&ops, units, level, 0);
+    for (size_t i = 0; i < count; i++)
+        for (size_t j = 0; j < units[i].len; j++)
+            order[n++] = ops.v[units[i].start + j];
+    // 重建为向右展开的 THEN 链：第 i 个节点的左子节点是第 i 个元素
+    for (size_t i = 0; i < n; i++)
+    {
+        node = take_node(ast, &shells, &next, i);
+        node->et = THEN;
+        node->left = order[i];
+        node->right = NULL;
+        if (prev)
+            prev->right = node;
+        prev = node;
+    }
+    free_shells(ast, &shells, next);
+    free(order);
+    free(units);
+    free(ops.v);
+    free(shells.v);
+}
+
+static void optimize_or(struct ast *ast, int level)
+{
+    struct vec ops = {NULL, 0, 0}, shells = {NULL, 0, 0};
+    struct ast *node, *prev = NULL;
+    struct unit *units;
+    size_t count, next = 0;
+    flatten_or(ast, &ops, &shells);
+    units = malloc(ops.n * sizeof(struct unit));
+    count = sort_units(&ops, units, level, 1);
+    // 重建为向右展开的 OR 树：最后一个节点的右子节点是最后一个操作数
+    for (size_t i = 0; i + 1 < count; i++)
+    {
+        node = take_node(ast, &shells, &next, i);
+        node->et = OR;
+        node->left = ops.v[units[i].start];
+        node->right = i + 2 < count ? NULL : ops.v[units[i + 1].start];
+        if (prev)
+            prev->right = node;
+        prev = node;
+    }
+    free_shells(ast, &shells, next);
+    free(units);
+    free(ops.v);
+    free(shells.v);
+}
+
+void optimize_ast(struct ast *ast, int level)
+{
+    if (!ast || level < 1)
+        return;
+    if (ast->et == OR)
+        optimize_or(ast, level);
+    else if (ast->et == AND || (ast->et == THEN && ast->left))
+        optimize_and(ast, level);
+}
@@ -0,0 +1,112 @@
+#include "output.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// 所有缓冲区写出时共用的锁，保证一次写出的记录不与其他线程交错
+static pthread_mutex_t out_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// 写出全部数据，处理被信号中断和部分写入的情况，调用者持有锁
+static int write_all(struct iovec *iov, int count)
+{
+    ssize_t n;
+    while (count > 0)
+    {
+        n = writev(STDOUT_FILENO, iov, count);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        while (count > 0 && (size_t)n >= iov->iov_len)
+        {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+// 将缓冲区内容放在 iov 之前一起写出
+static void write_out(struct out_buf *o, struct iovec *iov, int count)
+{
+    struct iovec head;
+    pthread_mutex_lock(&out_lock);
+    if (o->len && !o->error)
+    {
+        head.iov_base = o->buf;
+        head.iov_len = o->len;
+        if (write_all(&head, 1) == -1)
+            o->error = 1;
+    }
+    if (count && !o->error && write_all(iov, count) == -1)
+        o->error = 1;
+    pthread_mutex_unlock(&out_lock);
+    o->len = 0;
+}
+
+struct out_buf *out_create(size_t cap)
+{
+    struct out_buf *o = calloc(1, sizeof(struct out_buf));
+    o->buf = malloc(cap);
+    o->cap = cap;
+    o->line = isatty(STDOUT_FILENO);
+    return o;
+}
+
+void out_record(struct out_buf *o, const char *str, size_t len, char term)
+{
+    struct iovec iov[2];
+    if (o->len + len + 1 > o->cap)
+    {
+        // 记录比缓冲区还大，不复制，直接写出
+        if (len + 1 > o->cap)
+        {
+            iov[0].iov_base = (char *)str;
+            iov[0].iov_len = len;
+            iov[1].iov_base = &term;
+            iov[1].iov_len = 1;
+            write_out(o, iov, 2);
+            return;
+        }
+        write_out(o, NULL, 0);
+    }
+    memcpy(o->buf + o->len, str, len);
+    o->buf[o->len + len] = term;
+    o->len += len + 1;
+    if (o->line)
+        write_out(o, NULL, 0);
+}
+
+void out_writev(struct out_buf *o, struct iovec *iov, int count)
+{
+    write_out(o, iov, count);
+}
+
+int out_flush(struct out_buf *o)
+{
+    if (o->len)
+        write_out(o, NULL, 0);
+    return o->error ? -1 : 0;
+}
+
+int out_destroy(struct out_buf *o)
+{
+    int r;
+    if (!o)
+        return 0;
+    r = out_flush(o);
+    free(o->buf);
+    free(o);
+    return r;
+}
@@ -0,0 +1,147 @@
+#include "stats.h"
+#include "bytecode.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <time.h>
+
+// 操作码的数量必须放得进 ops 数组
+typedef char stats_ops_check[OP_END < STATS_OPS ? 1 : -1];
+
+__thread struct stats stats_local;
+
+// 已经结束的工作线程的计数器之和
+static struct stats total;
+static pthread_mutex_t total_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// 各阶段的耗时，以纳秒为单位
+static uint64_t phase_wall[PHASE_COUNT];
+static uint64_t phase_cpu[PHASE_COUNT];
+static enum stats_phase phase_cur;
+static uint64_t phase_wall_start;
+static uint64_t phase_cpu_start;
+static int phase_started;
+
+static const char *phase_names[PHASE_COUNT] = {"parse", "compile", "walk", "dupes", "exec"};
+
+// 以操作码为下标的谓词和动作名称，跳转等内部指令为 NULL，不输出
+static const char *op_names[STATS_OPS] = {
+    [OP_NAME] = "-name",
+    [OP_NAMESET] = "-name (set)",
+    [OP_TYPE] = "-type",
+    [OP_PERM] = "-perm",
+    [OP_SIZE] = "-size",
+    [OP_MTIME] = "-mtime/-mmin",
+    [OP_NEWER] = "-newer",
+    [OP_EMPTY] = "-empty",
+    [OP_CONTAINS] = "-contains",
+    [OP_PRUNE] = "-prune",
+    [OP_LIMIT] = "-limit",
+    [OP_QUIT] = "-quit",
+    [OP_PRINT] = "-print",
+    [OP_PRINT0] = "-print0",
+    [OP_EXEC] = "-exec ;",
+    [OP_EXECA] = "-exec ; (async)",
+    [OP_EXECP] = "-exec +",
+};
+
+static uint64_t clock_ns(clockid_t id)
+{
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint64_t stats_now(void)
+{
+    return clock_ns(CLOCK_MONOTONIC);
+}
+
+void stats_phase(enum stats_phase ph)
+{
+    uint64_t wall = stats_now();
+    uint64_t cpu = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    if (phase_started)
+    {
+        phase_wall[phase_cur] += wall - phase_wall_start;
+        phase_cpu[phase_cur] += cpu - phase_cpu_start;
+    }
+    phase_started = 1;
+    phase_cur = ph;
+    phase_wall_start = wall;
+    phase_cpu_start = cpu;
+}
+
+void stats_merge(void)
+{
+    struct stats *s = &stats_local;
+    pthread_mutex_lock(&total_lock);
+    total.dirs += s->dirs;
+    total.entries += s->entries;
+    total.lstats += s->lstats;
+    total.stats += s->stats;
+    total.spawns += s->spawns;
+    total.bytes += s->bytes;
+    total.scanned += s->scanned;
+    total.exec_ns += s->exec_ns;
+    for (int i = 0; i < STATS_OPS; i++)
+        total.ops[i] += s->ops[i];
+    pthread_mutex_unlock(&total_lock);
+    *s = (struct stats){0};
+}
+
+static double sec(uint64_t ns)
+{
+    return ns / 1e9;
+}
+
+static double tv_sec(struct timeval *tv)
+{
+    return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+void stats_report(int json)
+{
+    struct rusage ru;
+    double child = 0;
+    const char *sep = "";
+    // 阶段时间会一直累加到这里，之后的清理不计入
+    stats_phase(phase_cur);
+    stats_merge();
+    if (getrusage(RUSAGE_CHILDREN, &ru) == 0)
+        child = tv_sec(&ru.ru_utime) + tv_sec(&ru.ru_stime);
+    if (json)
+    {
+        fprintf(stderr, "{\"dirs\":%llu,\"entries\":%llu,\"lstat\":%llu,\"stat\":%llu,\"spawns\":%llu,\"bytes\":%llu,\"scanned\":%llu,\"evals\":{",
+                (unsigned long long)total.dirs, (unsigned long long)total.entries, (unsigned long long)total.lstats,
+                (unsigned long long)total.stats, (unsigned long long)total.spawns, (unsigned long long)total.bytes,
+                (unsigned long long)total.scanned);
+        for (int i = 0; i < STATS_OPS; i++)
+            if (op_names[i] && total.ops[i])
+            {
+                fprintf(stderr, "%s\"%s\":%llu", sep, op_names[i], (unsigned long long)total.ops[i]);
+                sep = ",";
+            }
+        fprintf(stderr, "},\"phases\":{");
+        for (int i = 0; i < PHASE_COUNT; i++)
+            fprintf(stderr, "%s\"%s\":{\"wall\":%.6f,\"cpu\":%.6f}", i ? "," : "", phase_names[i], sec(phase_wall[i]), sec(phase_cpu[i]));
+        fprintf(stderr, "},\"exec_wait\":%.6f,\"children_cpu\":%.6f}\n", sec(total.exec_ns), child);
+        return;
+    }
+    fprintf(stderr, "directories opened  %12llu\n", (unsigned long long)total.dirs);
+    fprintf(stderr, "entries read        %12llu\n", (unsigned long long)total.entries);
+    fprintf(stderr, "lstat calls         %12llu\n", (unsigned long long)total.lstats);
+    fprintf(stderr, "stat calls          %12llu\n", (unsigned long long)total.stats);
+    fprintf(stderr, "exec spawns         %12llu\n", (unsigned long long)total.spawns);
+    fprintf(stderr, "bytes printed       %12llu\n", (unsigned long long)total.bytes);
+    fprintf(stderr, "content bytes read  %12llu\n", (unsigned long long)total.scanned);
+    for (int i = 0; i < STATS_OPS; i++)
+        if (op_names[i] && total.ops[i])
+            fprintf(stderr, "%-20s%12llu\n", op_names[i], (unsigned long long)total.ops[i]);
+    fprintf(stderr, "%-20s%12s%12s\n", "phase", "wall (s)", "cpu (s)");
+    for (int i = 0; i < PHASE_COUNT; i++)
+        fprintf(stderr, "%-20s%12.6f%12.6f\n", phase_names[i], sec(phase_wall[i]), sec(phase_cpu[i]));
+    fprintf(stderr, "%-20s%12.6f\n", "exec wait", sec(total.exec_ns));
+    fprintf(stderr, "%-20s%12s%12.6f\n", "children cpu", "", child);
+}
@@ -0,0 +1,274 @@
+#include "uring.h"
+#include "stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_URING 1
+#endif
+#endif
+
+#ifdef HAVE_URING
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#include <sys/mman.h>
+#include <sys/sysmacros.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * @struct uring
+ * @brief 映射到用户空间的 io_uring 提交队列和完成队列。
+ */
+struct uring
+{
+    int fd;                     /**< io_uring 的文件描述符。 */
+    unsigned int entries;       /**< 队列深度。 */
+    unsigned int *sq_tail;      /**< 提交队列尾指针，由用户空间更新。 */
+    unsigned int *sq_mask;      /**< 提交队列掩码。 */
+    unsigned int *sq_array;     /**< 提交队列的索引数组。 */
+    struct io_uring_sqe *sqes;  /**< 提交队列项数组。 */
+    unsigned int *cq_head;      /**< 完成队列头指针，由用户空间更新。 */
+    unsigned int *cq_tail;      /**< 完成队列尾指针，由内核更新。 */
+    unsigned int *cq_mask;      /**< 完成队列掩码。 */
+    struct io_uring_cqe *cqes;  /**< 完成队列项数组。 */
+    void *sq_ptr;               /**< 提交队列环的映射。 */
+    size_t sq_size;             /**< `sq_ptr` 的映射长度。 */
+    void *cq_ptr;               /**< 完成队列环的映射，单次映射时与 `sq_ptr` 相同。 */
+    size_t cq_size;             /**< `cq_ptr` 的映射长度。 */
+    size_t sqes_size;           /**< `sqes` 的映射长度。 */
+    unsigned int sq_local;      /**< 下一个要填写的提交队列位置。 */
+    unsigned int to_submit;     /**< 已填写但尚未提交的请求数量。 */
+    int broken;                 /**< `io_uring_enter` 失败后不再使用该实例。 */
+    struct statx *stx;          /**< 每个请求的 `statx` 结果缓冲区。 */
+};
+
+struct uring *uring_create(unsigned int entries)
+{
+    struct io_uring_params p;
+    struct uring *u = calloc(1, sizeof(struct uring));
+    memset(&p, 0, sizeof(p));
+    u->fd = syscall(SYS_io_uring_setup, entries, &p);
+    if (u->fd < 0)
+    {
+        free(u);
+        return NULL;
+    }
+    u->entries = p.sq_entries;
+    u->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    u->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (u->cq_size > u->sq_size)
+            u->sq_size = u->cq_size;
+        u->cq_size = u->sq_size;
+    }
+    u->sq_ptr = mmap(NULL, u->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+    if (u->sq_ptr == MAP_FAILED)
+        goto fail;
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        u->cq_ptr = u->sq_ptr;
+    else
+    {
+        u->cq_ptr = mmap(NULL, u->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+        if (u->cq_ptr == MAP_FAILED)
+        {
+            munmap(u->sq_ptr, u->sq_size);
+            goto fail;
+        }
+    }
+    u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED)
+    {
+        if (u->cq_ptr != u->sq_ptr)
+            munmap(u->cq_ptr, u->cq_size);
+        munmap(u->sq_ptr, u->sq_size);
+        goto fail;
+    }
+    u->sq_tail = (unsigned int *)((char *)u->sq_ptr + p.sq_off.tail);
+    u->sq_mask = (unsigned int *)((char *)u->sq_ptr + p.sq_off.ring_mask);
+    u->sq_array = (unsigned int *)((char *)u->sq_ptr + p.sq_off.array);
+    u->cq_head = (unsigned int *)((char *)u->cq_ptr + p.cq_off.head);
+    u->cq_tail = (unsigned int *)((char *)u->cq_ptr + p.cq_off.tail);
+    u->cq_mask = (unsigned int *)((char *)u->cq_ptr + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)((char *)u->cq_ptr + p.cq_off.cqes);
+    u->sq_local = *u->sq_tail;
+    u->stx = calloc(u->entries, sizeof(struct statx));
+    return u;
+fail:
+    close(u->fd);
+    free(u);
+    return NULL;
+}
+
+void uring_destroy(struct uring *u)
+{
+    if (!u)
+        return;
+    munmap(u->sqes, u->sqes_size);
+    if (u->cq_ptr != u->sq_ptr)
+        munmap(u->cq_ptr, u->cq_size);
+    munmap(u->sq_ptr, u->sq_size);
+    close(u->fd);
+    free(u->stx);
+    free(u);
+}
+
+// 为第 i 个节点填写一个 statx 请求，follow 表示是否跟随符号链接，mask 为属性谓词额外需要的字段
+static void queue_statx(struct uring *u, struct node *n, size_t i, int follow, unsigned int mask)
+{
+    unsigned int idx = u->sq_local & *u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = n->dirfd;
+    sqe->addr = (unsigned long)(n->dirfd == AT_FDCWD ? n->name : n->name_wp);
+    sqe->len = STATX_TYPE | STATX_MODE | mask;
+    sqe->off = (unsigned long)&u->stx[i];
+    sqe->statx_flags = follow ? 0 : AT_SYMLINK_NOFOLLOW;
+    sqe->user_data = ((unsigned long long)i << 1) | (follow ? 1 : 0);
+    u->sq_array[idx] = idx;
+    u->sq_local++;
+    if (follow)
+        STATS_INC(stats);
+    else
+        STATS_INC(lstats);
+    u->to_submit++;
+}
+
+// 提交所有已填写的请求，并至少等待 wait_nr 个完成
+static int submit_and_wait(struct uring *u, unsigned int wait_nr)
+{
+    long ret;
+    __atomic_store_n(u->sq_tail, u->sq_local, __ATOMIC_RELEASE);
+    do
+        ret = syscall(SYS_io_uring_enter, u->fd, u->to_submit, wait_nr, wait_nr ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    while (ret < 0 && errno == EINTR);
+    if (ret < 0)
+        return -1;
+    u->to_submit -= ret;
+    return 0;
+}
+
+// 节点是否需要 lstat
+static int needs_lstat(struct data *d, struct node *n)
+{
+    return !(n->flags & NODE_LSTAT) && (d->need_mode || d->attr_mask || !(n->flags & NODE_FTYPE));
+}
+
+// 节点是否需要跟随符号链接的 stat
+static int needs_stat(struct data *d, struct node *n)
+{
+    return !(n->flags & NODE_STAT) && d->option == 2 && (n->flags & NODE_FTYPE) && S_ISLNK(n->type);
+}
+
+void uring_stat_batch(struct uring *u, struct data *d, struct node *nodes, size_t count,
+                      void (*ready)(struct data *d, struct node *n, void *arg), void *arg)
+{
+    unsigned int inflight = 0;
+    if (u->broken)
+    {
+        for (size_t i = 0; i < count; i++)
+            ready(d, &nodes[i], arg);
+        return;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        if (needs_lstat(d, &nodes[i]))
+            queue_statx(u, &nodes[i], i, 0, d->attr_mask);
+        else if (needs_stat(d, &nodes[i]))
+            queue_statx(u, &nodes[i], i, 1, d->attr_mask);
+        else
+            continue;
+        inflight++;
+    }
+    // 不需要系统调用的节点在等待期间先求值
+    for (size_t i = 0; i < count; i++)
+        if (!needs_lstat(d, &nodes[i]) && !needs_stat(d, &nodes[i]))
+            ready(d, &nodes[i], arg);
+    while (inflight)
+    {
+        if (submit_and_wait(u, 1) == -1)
+        {
+            // 提交失败时退回同步路径，由 node_type/node_r_type 按需获取
+            u->broken = 1;
+            for (size_t i = 0; i < count; i++)
+                if (needs_lstat(d, &nodes[i]) || needs_stat(d, &nodes[i]))
+                    ready(d, &nodes[i], arg);
+            return;
+        }
+        unsigned int head = *u->cq_head;
+        unsigned int tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++)
+        {
+            struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+            size_t i = cqe->user_data >> 1;
+            int follow = cqe->user_data & 1;
+            struct node *n = &nodes[i];
+            mode_t mode = cqe->res == 0 ? u->stx[i].stx_mode : 0;
+            inflight--;
+            if (follow)
+            {
+                n->r_type = mode;
+                n->flags |= NODE_STAT;
+            }
+            else
+            {
+                n->type = mode;
+                n->flags |= NODE_FTYPE | NODE_LSTAT;
+                if (!S_ISLNK(mode))
+                {
+                    n->r_type = mode;
+                    n->flags |= NODE_STAT;
+                }
+            }
+            // 属性谓词需要的字段已经一起请求；-L 时符号链接的属性取自之后跟随它的请求
+            if (cqe->res == 0 && d->attr_mask && (follow || d->option != 2 || !S_ISLNK(mode)))
+            {
+                n->size = u->stx[i].stx_size;
+                n->dev = makedev(u->stx[i].stx_dev_major, u->stx[i].stx_dev_minor);
+                n->ino = u->stx[i].stx_ino;
+                n->mtime = (int64_t)u->stx[i].stx_mtime.tv_sec * 1000000000 + u->stx[i].stx_mtime.tv_nsec;
+                n->flags |= NODE_ATTR;
+            }
+            // lstat 之后才发现是符号链接，还需要跟随它；请求结束遍历之后只回收已经提交的请求
+            if (needs_stat(d, n) && !quit_requested())
+            {
+                queue_statx(u, n, i, 1, d->attr_mask);
+                inflight++;
+            }
+            else
+                ready(d, n, arg);
+        }
+        __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    }
+}
+
+#else
+
+struct uring *uring_create(unsigned int entries)
+{
+    (void)entries;
+    return NULL;
+}
+
+void uring_destroy(struct uring *u)
+{
+    (void)u;
+}
+
+void uring_stat_batch(struct uring *u, struct data *d, struct node *nodes, size_t count,
+                      void (*ready)(struct data *d, struct node *n, void *arg), void *arg)
+{
+    (void)u;
+    for (size_t i = 0; i < count; i++)
+        ready(d, &nodes[i], arg);
+}
+
+#endif
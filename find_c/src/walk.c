@@ -0,0 +1,460 @@
+#include "walk.h"
+#include "content.h"
+#include "dirread.h"
+#include "lib/lib_str.h"
+#include "output.h"
+#include "stats.h"
+#include "uring.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// 有序输出时一次 writev 最多写出的段数（Linux 的 IOV_MAX）
+#define FLUSH_IOV 1024
+
+static void deque_init(struct deque *dq)
+{
+    dq->cap = 64;
+    dq->buf = calloc(dq->cap, sizeof(struct task *));
+    dq->head = 0;
+    dq->tail = 0;
+    pthread_mutex_init(&dq->lock, NULL);
+}
+
+static void deque_destroy(struct deque *dq)
+{
+    free(dq->buf);
+    pthread_mutex_destroy(&dq->lock);
+}
+
+// 所有者从尾部压入任务
+static void deque_push(struct deque *dq, struct task *t)
+{
+    pthread_mutex_lock(&dq->lock);
+    if (dq->tail - dq->head == dq->cap)
+    {
+        struct task **buf = calloc(dq->cap * 2, sizeof(struct task *));
+        size_t n = dq->tail - dq->head;
+        for (size_t i = 0; i < n; i++)
+            buf[i] = dq->buf[(dq->head + i) & (dq->cap - 1)];
+        free(dq->buf);
+        dq->buf = buf;
+        dq->cap *= 2;
+        dq->head = 0;
+        dq->tail = n;
+    }
+    dq->buf[dq->tail & (dq->cap - 1)] = t;
+    dq->tail++;
+    pthread_mutex_unlock(&dq->lock);
+}
+
+// 所有者从尾部弹出任务
+static struct task *deque_pop(struct deque *dq)
+{
+    struct task *t = NULL;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->tail != dq->head)
+    {
+        dq->tail--;
+        t = dq->buf[dq->tail & (dq->cap - 1)];
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return t;
+}
+
+// 其他线程从头部窃取任务
+static struct task *deque_steal(struct deque *dq)
+{
+    struct task *t = NULL;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->tail != dq->head)
+    {
+        t = dq->buf[dq->head & (dq->cap - 1)];
+        dq->head++;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return t;
+}
+
+static struct task *steal(struct worker *w)
+{
+    struct walk *wk = w->walk;
+    int start = rand_r(&w->seed) % wk->nworkers;
+    for (int i = 0; i < wk->nworkers; i++)
+    {
+        struct worker *victim = &wk->workers[(start + i) % wk->nworkers];
+        if (victim == w)
+            continue;
+        struct task *t = deque_steal(&victim->dq);
+        if (t)
+            return t;
+    }
+    return NULL;
+}
+
+static void push_task(struct worker *w, struct task *t)
+{
+    struct walk *wk = w->walk;
+    __atomic_add_fetch(&wk->outstanding, 1, __ATOMIC_ACQ_REL);
+    deque_push(&w->dq, t);
+    if (__atomic_load_n(&wk->idle, __ATOMIC_ACQUIRE))
+    {
+        pthread_mutex_lock(&wk->idle_lock);
+        pthread_cond_signal(&wk->idle_cond);
+        pthread_mutex_unlock(&wk->idle_lock);
+    }
+}
+
+static void free_task(struct task *t)
+{
+    for (size_t i = 0; i < t->it_size; i++)
+    {
+        free(t->items[i].buf);
+        if (t->items[i].child)
+            free_task(t->items[i].child);
+    }
+    free(t->items);
+    free(t->path);
+    free(t->name_wp);
+    free(t);
+}
+
+void task_append(struct task *t, const char *str, size_t len)
+{
+    if (t->it_size == 0 || t->items[t->it_size - 1].child)
+    {
+        if (t->it_size >= t->it_capacity)
+        {
+            t->it_capacity = t->it_capacity ? t->it_capacity * 2 : 4;
+            t->items = realloc(t->items, t->it_capacity * sizeof(struct out_item));
+        }
+        memset(&t->items[t->it_size], 0, sizeof(struct out_item));
+        t->it_size++;
+    }
+    struct out_item *it = &t->items[t->it_size - 1];
+    if (it->len + len > it->cap)
+    {
+        while (it->len + len > it->cap)
+            it->cap = it->cap ? it->cap * 2 : 256;
+        it->buf = realloc(it->buf, it->cap);
+    }
+    memcpy(it->buf + it->len, str, len);
+    it->len += len;
+}
+
+static void task_add_child(struct task *t, struct task *child)
+{
+    if (t->it_size >= t->it_capacity)
+    {
+        t->it_capacity = t->it_capacity ? t->it_capacity * 2 : 4;
+        t->items = realloc(t->items, t->it_capacity * sizeof(struct out_item));
+    }
+    memset(&t->items[t->it_size], 0, sizeof(struct out_item));
+    t->items[t->it_size].child = child;
+    t->it_size++;
+}
+
+// 按单线程遍历的顺序收集任务及其子任务的缓冲内容，攒满一组 iovec 后一次写出
+static void flush_task(struct out_buf *o, struct iovec *iov, int *count, struct task *t)
+{
+    for (size_t i = 0; i < t->it_size; i++)
+    {
+        if (t->items[i].child)
+            flush_task(o, iov, count, t->items[i].child);
+        else if (t->items[i].len)
+        {
+            iov[*count].iov_base = t->items[i].buf;
+            iov[*count].iov_len = t->items[i].len;
+            if (++*count == FLUSH_IOV)
+            {
+                out_writev(o, iov, *count);
+                *count = 0;
+            }
+        }
+    }
+}
+
+// 任务自身或其一个子任务完成；整棵子树完成时对目录本身求值（-d）并通知父任务
+static void task_finish(struct worker *w, struct task *t)
+{
+    while (t && __atomic_sub_fetch(&t->pending, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        struct task *parent = t->parent;
+        if (t->has_node)
+        {
+            struct node n = {t->path, t->name_wp, t->type, t->r_type, AT_FDCWD, t->flags};
+            w->d.task = t;
+            w->d.depth = t->depth;
+            eval_node(&w->d, &n);
+        }
+        if (!w->d.ordered && !t->is_root)
+            free_task(t);
+        t = parent;
+    }
+}
+
+// 处理当前任务目录中的一个目录项：求值，需要递归时创建子任务并复制一份路径
+static void visit_entry(struct worker *w, struct task *t, struct node *n)
+{
+    struct data *d = &w->d;
+    struct task *child;
+    int descend; // 记录是否需要递归解析该目录
+    d->task = t;
+    // 先序遍历时目录在入队之前求值，-prune 可以阻止入队
+    if (!d->d_checked)
+        eval_node(d, n);
+    descend = node_descend(d, n);
+    // 后序遍历时目录推迟到子树完成后求值
+    if (d->d_checked && !descend)
+        eval_node(d, n);
+    if (!descend)
+        return;
+    child = calloc(1, sizeof(struct task));
+    child->parent = t;
+    child->pending = 1;
+    child->depth = t->depth + 1;
+    // 目录项的路径在竞技场中，批次结束后失效，子任务需要自己的副本
+    child->path = my_strcp(n->name);
+    if (d->d_checked)
+    {
+        child->name_wp = my_strcp(n->name_wp);
+        child->type = n->type;
+        child->r_type = n->r_type;
+        child->flags = n->flags;
+        child->has_node = 1;
+    }
+    __atomic_add_fetch(&t->pending, 1, __ATOMIC_ACQ_REL);
+    if (d->ordered)
+        task_add_child(t, child);
+    push_task(w, child);
+}
+
+static void uring_ready(struct data *d, struct node *n, void *arg)
+{
+    struct worker *w = ((struct task *)arg)->walker;
+    (void)d;
+    visit_entry(w, arg, n);
+}
+
+// -L 模式下记录目录的 (st_dev, st_ino)，并沿父任务链检查目录是否是自己的祖先
+static int task_in_loop(struct task *t, int fd)
+{
+    struct stat sb;
+    if (fstat(fd, &sb) == -1)
+        return 0;
+    t->dev = sb.st_dev;
+    t->ino = sb.st_ino;
+    t->tracked = 1;
+    // 父任务在其所有子任务完成之前不会被释放，因此祖先链始终有效
+    for (struct task *a = t->parent; a; a = a->parent)
+        if (a->tracked && a->dev == t->dev && a->ino == t->ino)
+            return 1;
+    return 0;
+}
+
+static void process_task(struct worker *w, struct task *t)
+{
+    struct data *d = &w->d;
+    int fd;
+    struct dir_reader r;
+    struct dir_entry e;
+    struct node batch[URING_DEPTH]; // 当前批次的目录项，不使用 io_uring 时每批只有一项
+    size_t count;
+    size_t max = d->uring ? URING_DEPTH : 1;
+    size_t len = my_strlen(t->path);
+    size_t prefix = len;
+    struct arena_mark m = arena_mark(&d->arena);
+    // 已经请求结束遍历，剩余的任务不再读取目录
+    if (quit_requested())
+    {
+        task_finish(w, t);
+        return;
+    }
+    fd = t->is_root ? open(t->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC) : open_subdir(d, AT_FDCWD, t->path, t->path);
+    if (fd == -1 || dir_open(&r, fd, d->dirbuf) == -1)
+    {
+        // open_subdir 失败时已经输出了错误信息
+        if (fd != -1 || t->is_root)
+        {
+            fprintf(stderr, "\'%s\' : %s\n", t->path, strerror(errno));
+            d->return_value = 1;
+        }
+        task_finish(w, t);
+        return;
+    }
+    if (d->option == 2 && task_in_loop(t, fd))
+    {
+        fprintf(stderr, "\'%s\' : File system loop detected\n", t->path);
+        d->return_value = 1;
+        dir_close(&r);
+        task_finish(w, t);
+        return;
+    }
+    // arena_path 只在目录名不以 '/' 结尾时插入分隔符
+    if (prefix == 0 || t->path[prefix - 1] != '/')
+        prefix++;
+    t->walker = w;
+    d->depth = t->depth + 1;
+    do
+    {
+        for (count = 0; count < max && dir_next(&r, &e); count++)
+        {
+            // 名称在下一次 dir_next 之后失效，因此指向完整路径中的文件名部分
+            batch[count].name = arena_path(&d->arena, t->path, len, e.name);
+            batch[count].name_wp = batch[count].name + prefix;
+            batch[count].dirfd = fd;
+            batch[count].type = dtype_to_mode(e.type);
+            batch[count].flags = batch[count].type ? NODE_FTYPE : 0;
+        }
+        if (d->uring)
+            uring_stat_batch(d->uring, d, batch, count, uring_ready, t);
+        else if (count)
+            visit_entry(w, t, &batch[0]);
+        arena_release(&d->arena, m);
+    } while (count == max && !quit_requested());
+    dir_close(&r);
+    task_finish(w, t);
+}
+
+static void *worker_main(void *arg)
+{
+    struct worker *w = arg;
+    struct walk *wk = w->walk;
+    struct task *t;
+    struct timespec ts;
+    for (;;)
+    {
+        t = deque_pop(&w->dq);
+        if (!t)
+            t = steal(w);
+        if (t)
+        {
+            process_task(w, t);
+            if (__atomic_sub_fetch(&wk->outstanding, 1, __ATOMIC_ACQ_REL) == 0)
+            {
+                pthread_mutex_lock(&wk->idle_lock);
+                pthread_cond_broadcast(&wk->idle_cond);
+                pthread_mutex_unlock(&wk->idle_lock);
+            }
+            continue;
+        }
+        // 没有可执行或可窃取的任务，短暂等待新任务
+        pthread_mutex_lock(&wk->idle_lock);
+        if (__atomic_load_n(&wk->outstanding, __ATOMIC_ACQUIRE) == 0)
+        {
+            pthread_mutex_unlock(&wk->idle_lock);
+            break;
+        }
+        __atomic_add_fetch(&wk->idle, 1, __ATOMIC_ACQ_REL);
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += 1000000;
+        if (ts.tv_nsec >= 1000000000)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&wk->idle_cond, &wk->idle_lock, &ts);
+        __atomic_sub_fetch(&wk->idle, 1, __ATOMIC_ACQ_REL);
+        pthread_mutex_unlock(&wk->idle_lock);
+    }
+    // 线程局部的计数器和读取缓冲区在线程结束后失效
+    stats_merge();
+    content_release();
+    return NULL;
+}
+
+// 工作线程的数据副本：共享只读字段、字节码程序和子进程池，独立的批处理缓冲区
+static void init_worker_data(struct worker *w, struct data *d)
+{
+    w->d = *d;
+    w->d.return_value = 0;
+    iset_init(&w->d.ancestors);
+    init_batches(&w->d);
+    w->d.walk = w->walk;
+    w->d.task = NULL;
+    w->d.out = out_create(OUT_BUF_SIZE);
+    arena_init(&w->d.arena);
+    // 每个线程使用自己的 io_uring，创建失败时该线程退回同步路径
+    w->d.uring = d->uring ? uring_create(URING_DEPTH) : NULL;
+}
+
+static void free_worker_data(struct data *d)
+{
+    if (out_destroy(d->out))
+        d->walk->d->out->error = 1;
+    free_batches(d);
+    arena_free(&d->arena);
+    uring_destroy(d->uring);
+    iset_free(&d->ancestors);
+}
+
+void walk_root(struct data *d, struct node *n)
+{
+    struct walk wk;
+    wk.d = d;
+    wk.nworkers = d->jobs;
+    wk.outstanding = 1;
+    wk.idle = 0;
+    pthread_mutex_init(&wk.idle_lock, NULL);
+    pthread_cond_init(&wk.idle_cond, NULL);
+    wk.workers = calloc(wk.nworkers, sizeof(struct worker));
+
+    struct task *root = calloc(1, sizeof(struct task));
+    root->path = my_strcp(n->name);
+    root->is_root = 1;
+    root->pending = 1;
+    if (d->d_checked)
+    {
+        root->name_wp = my_strcp(n->name_wp);
+        root->type = n->type;
+        root->r_type = n->r_type;
+        root->flags = n->flags;
+        root->has_node = 1;
+    }
+    // 查找路径本身的输出先于工作线程的输出
+    out_flush(d->out);
+
+    for (int i = 0; i < wk.nworkers; i++)
+    {
+        struct worker *w = &wk.workers[i];
+        w->walk = &wk;
+        w->id = i;
+        w->seed = i + 1;
+        deque_init(&w->dq);
+        init_worker_data(w, d);
+    }
+    deque_push(&wk.workers[0].dq, root);
+    for (int i = 0; i < wk.nworkers; i++)
+        pthread_create(&wk.workers[i].tid, NULL, worker_main, &wk.workers[i]);
+    for (int i = 0; i < wk.nworkers; i++)
+        pthread_join(wk.workers[i].tid, NULL);
+
+    if (d->ordered)
+    {
+        struct iovec iov[FLUSH_IOV];
+        int count = 0;
+        flush_task(d->out, iov, &count, root);
+        out_writev(d->out, iov, count);
+    }
+    free_task(root);
+    for (int i = 0; i < wk.nworkers; i++)
+    {
+        struct worker *w = &wk.workers[i];
+        if (deal_batch_remaining(&w->d))
+            w->d.return_value = 1;
+        if (w->d.return_value)
+            d->return_value = w->d.return_value;
+        free_worker_data(&w->d);
+        deque_destroy(&w->dq);
+    }
+    free(wk.workers);
+    pthread_mutex_destroy(&wk.idle_lock);
+    pthread_cond_destroy(&wk.idle_cond);
+}
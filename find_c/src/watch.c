@@ -0,0 +1,193 @@
+#include "watch.h"
+#include "exec.h"
+#include "lib/lib_str.h"
+#include "output.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+struct watch *watch_create(void)
+{
+    struct watch *w;
+    int fd = inotify_init1(IN_CLOEXEC);
+    if (fd == -1)
+        return NULL;
+    w = calloc(1, sizeof(struct watch));
+    w->fd = fd;
+    return w;
+}
+
+void watch_destroy(struct watch *w)
+{
+    if (!w)
+        return;
+    close(w->fd);
+    for (size_t i = 0; i < w->capacity; i++)
+        free(w->dirs[i].path);
+    free(w->dirs);
+    free(w);
+}
+
+void watch_add(struct watch *w, char *path, int depth)
+{
+    size_t old;
+    int wd = inotify_add_watch(w->fd, path, WATCH_MASK);
+    if (wd == -1)
+    {
+        // 达到上限后其余目录都会失败，只提示一次
+        if (errno != ENOSPC)
+            fprintf(stderr, "warning: cannot watch \'%s\' : %s\n", path, strerror(errno));
+        else if (!w->full)
+            fprintf(stderr, "warning: inotify watch limit reached, raise fs.inotify.max_user_watches\n");
+        w->full |= errno == ENOSPC;
+        return;
+    }
+    if ((size_t)wd >= w->capacity)
+    {
+        old = w->capacity;
+        while ((size_t)wd >= w->capacity)
+            w->capacity = w->capacity ? w->capacity * 2 : 1024;
+        w->dirs = realloc(w->dirs, w->capacity * sizeof(struct watch_dir));
+        memset(w->dirs + old, 0, (w->capacity - old) * sizeof(struct watch_dir));
+    }
+    if (!w->dirs[wd].path)
+        w->count++;
+    free(w->dirs[wd].path);
+    w->dirs[wd].path = my_strcp(path);
+    w->dirs[wd].depth = depth;
+}
+
+// 停止监视 path 及其中所有的目录，用于移出监视范围的目录
+static void forget(struct watch *w, char *path)
+{
+    size_t len = my_strlen(path);
+    char *p;
+    for (size_t wd = 0; wd < w->capacity; wd++)
+    {
+        if (!(p = w->dirs[wd].path) || strncmp(p, path, len) != 0 || (p[len] != '\0' && p[len] != '/'))
+            continue;
+        inotify_rm_watch(w->fd, (int)wd);
+        free(p);
+        w->dirs[wd].path = NULL;
+        w->count--;
+    }
+}
+
+// 对目录 dir 中出现或变化的目录项 name 求值，新出现的目录按遍历的规则递归读取
+static void visit(struct data *d, struct watch_dir *dir, const struct inotify_event *ev)
+{
+    struct node n;
+    struct arena_mark m = arena_mark(&d->arena);
+    size_t nlen = my_strlen((char *)ev->name);
+    int sub;
+    n.name = arena_path(&d->arena, dir->path, my_strlen(dir->path), (char *)ev->name);
+    n.name_wp = n.name + my_strlen(n.name) - nlen;
+    n.dirfd = AT_FDCWD;
+    n.type = 0;
+    n.flags = 0;
+    // parse_dir 添加监视时 dirs 可能被重新分配，此后不再使用 dir
+    d->depth = dir->depth + 1;
+    if (!d->d_checked)
+        eval_node(d, &n);
+    if ((ev->mask & (IN_CREATE | IN_MOVED_TO)) && node_descend(d, &n) && (sub = open_subdir(d, AT_FDCWD, n.name, n.name)) != -1)
+        parse_dir(sub, n.name, d);
+    if (d->d_checked)
+        eval_node(d, &n);
+    arena_release(&d->arena, m);
+}
+
+static void handle_events(struct data *d, char *buf, size_t len)
+{
+    struct watch *w = d->watch;
+    const struct inotify_event *ev, *last = NULL;
+    struct arena_mark m;
+    for (char *p = buf; p < buf + len && !quit_requested(); p += sizeof(struct inotify_event) + ev->len)
+    {
+        ev = (const struct inotify_event *)p;
+        if (ev->mask & IN_Q_OVERFLOW)
+        {
+            fprintf(stderr, "warning: inotify event queue overflowed, some changes were missed\n");
+            continue;
+        }
+        if (ev->wd <= 0 || (size_t)ev->wd >= w->capacity || !w->dirs[ev->wd].path)
+            continue;
+        // 目录被删除或监视被移除
+        if (ev->mask & IN_IGNORED)
+        {
+            free(w->dirs[ev->wd].path);
+            w->dirs[ev->wd].path = NULL;
+            w->count--;
+            continue;
+        }
+        if (!ev->len)
+            continue;
+        // 移出的目录不再监视；如果移到了监视范围内的其他位置，IN_MOVED_TO 会重新遍历并监视它
+        if (ev->mask & IN_MOVED_FROM)
+        {
+            if (ev->mask & IN_ISDIR)
+            {
+                m = arena_mark(&d->arena);
+                forget(w, arena_path(&d->arena, w->dirs[ev->wd].path, my_strlen(w->dirs[ev->wd].path), (char *)ev->name));
+                arena_release(&d->arena, m);
+            }
+            last = NULL;
+            continue;
+        }
+        // 同一个目录项连续的多个事件（如创建、修改属性、写入后关闭）只求值一次
+        if (last && last->wd == ev->wd && strcmp(last->name, ev->name) == 0 && !(ev->mask & (IN_CREATE | IN_MOVED_TO)))
+            continue;
+        last = ev;
+        visit(d, &w->dirs[ev->wd], ev);
+    }
+}
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    request_quit();
+}
+
+void watch_run(struct data *d)
+{
+    struct watch *w = d->watch;
+    char buf[WATCH_BUF_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd pfd = {w->fd, POLLIN, 0};
+    struct sigaction sa;
+    ssize_t len, n;
+    // 不设置 SA_RESTART，收到信号时 read 返回 EINTR，照常写出输出并等待子进程后退出
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    // 初始遍历的输出先写出
+    out_flush(d->out);
+    while (!quit_requested() && w->count)
+    {
+        if ((len = read(w->fd, buf, sizeof(buf))) == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "inotify : %s\n", strerror(errno));
+            d->return_value = 1;
+            break;
+        }
+        // 例如 touch 会依次产生创建、属性变化和写入后关闭，稍等片刻让它们进入同一批
+        while ((size_t)len + sizeof(struct inotify_event) + NAME_MAX + 1 <= sizeof(buf) && poll(&pfd, 1, WATCH_DELAY_MS) > 0
+            && (n = read(w->fd, buf + len, sizeof(buf) - len)) > 0)
+            len += n;
+        handle_events(d, buf, len);
+        // 每批事件的结果立即可见
+        if (out_flush(d->out))
+            break;
+        for (size_t i = 0; i < d->nbatches; i++)
+            batch_flush(&d->batches[i], d->procs);
+    }
+}
@@ -1,5 +1,6 @@
 import inspect
 import logging
+import threading
 import time
 
 from typing import Optional, Callable
@@ -24,11 +25,24 @@ def execute_llm_code(code_str, globals):
 
 
 class FindContext:
-    def __init__(self, max_depth: int = -1):
+    def __init__(self, max_depth: int = -1, limit: Optional[int] = None):
         self.has_result = False
         self.max_depth = max_depth
         self.timeout_occurred = False
         self.allowed_functions = {'set_search_depth': set_search_depth}
+        # Stop the walk after `limit` matches (like myfind's -limit / -quit).
+        self.limit = limit
+        self.matches = 0
+        self.stopped = threading.Event()
+
+    def add_match(self):
+        self.has_result = True
+        self.matches += 1
+        if self.limit is not None and self.matches >= self.limit:
+            self.stop()
+
+    def stop(self):
+        self.stopped.set()
 
     def handle_timeout(self, agent_helper: Optional[Callable[[Optional[str]], str]]):
         print("Timeout")
@@ -41,6 +55,7 @@ class FindContext:
                     No Agent Helper provided.
                     Skipping!
                 ''')
+                self.stop()
                 return
             else:
                 if len(inspect.signature(agent_helper).parameters) > 0:
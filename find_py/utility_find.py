@@ -15,8 +15,10 @@ def out_put(message: str, op: int):
     if op == 0:
         print(message)
     elif op == 1:
+        if find_context.stopped.is_set():
+            return
         f.write(message + '\n')
-        find_context.has_result = True
+        find_context.add_match()
 
 def start_timer(timeout_seconds: int, callback: Callable):
     timer = threading.Timer(timeout_seconds, callback)
@@ -31,6 +33,9 @@ def walk_dir(
         context: FindContext,
         name_pattern: Optional[str] = None
 ):
+    if context.stopped.is_set():
+        return
+
     try:
         entries = os.listdir(directory)
     except (OSError, FileNotFoundError, PermissionError) as e:
@@ -43,6 +48,9 @@ def walk_dir(
             out_put(directory, 1)
 
     for entry in entries:
+        # -limit reached or timed out without an agent: bail out of the walk.
+        if context.stopped.is_set():
+            return
         entry_path = os.path.join(directory, entry)
         try:
             if os.path.islink(entry_path) and not follow_symlink_flag:
@@ -82,13 +90,14 @@ def find(
     name: Optional[str] = None,
     timeout: Optional[int] = None,
     search_depth: Optional[int] = -1,
-    agent_helper: Optional[Callable[[str], None]] = None
+    agent_helper: Optional[Callable[[str], None]] = None,
+    limit: Optional[int] = None
 ):
 
     visited = set()
 
     global find_context
-    find_context = FindContext()
+    find_context = FindContext(limit=limit)
     find_context.max_depth = search_depth
 
     follow_symlink_flag = follow_symlink_signal == 2
@@ -97,6 +106,9 @@ def find(
         timer = start_timer(timeout, lambda: find_context.handle_timeout(agent_helper))
 
     for folder in folders:
+        if find_context.stopped.is_set():
+            break
+
         folder = os.path.abspath(os.path.expanduser(folder))    # expanduser：handle cases like '~'
 
         if not os.path.exists(folder):
@@ -145,6 +157,10 @@ def main():
 
     parser.add_argument("-name", help="Filter results by file or directory name pattern.")
 
+    limit_group = parser.add_mutually_exclusive_group()
+    limit_group.add_argument("-limit", type=int, help="Stop after N matching results.")
+    limit_group.add_argument("-quit", action="store_true", help="Stop after the first matching result.")
+
     args = parser.parse_args()
 
     # Determine symlink behavior
@@ -159,7 +175,8 @@ def main():
         follow_symlink_signal=follow_symlink,
         process_dir_first=args.d,
         name=args.name,
-        timeout=1
+        timeout=1,
+        limit=1 if args.quit else args.limit
     )
 
 if __name__ == "__main__":